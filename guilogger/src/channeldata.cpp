@@ -26,12 +26,14 @@
 #include "channeldata.h"
 #include "stl_adds.h"
 #include <cstdio>
+#include <cstdint>
+#include <algorithm>
 #include <QString>
 #include <QStringList>
 #include <QRegularExpression>
 
 ChannelData::ChannelData(int buffersize)
-  : numchannels(0), buffersize(0), time(0), initialized(false){
+  : numchannels(0), buffersize(0), time(0), stored(0), initialized(false){
   setBufferSize(buffersize);
 
 }
@@ -43,15 +45,18 @@ int ChannelData::getBuffersize() const{
 void ChannelData::setBufferSize(int newBuffersize){
   buffersize=newBuffersize;
   if(initialized){
-    data.resize(buffersize);
-    for(int i=0; i<buffersize;++i){
-      data[i].resize(numchannels);
-    }
-    time = 0;
+    initBuffer();
     emit(update());
   }
 }
 
+void ChannelData::initBuffer(){
+  data.fill(0, numchannels*buffersize);
+  line.resize(numchannels);
+  time = 0;
+  stored = 0;
+}
+
 
 /// sets a new information about a channel (also works before initialization)
 void ChannelData::setChannelInfo(const ChannelInfo& info){
@@ -115,10 +120,7 @@ void ChannelData::setChannels(const QStringList& newchannels){
 
     multichannels.resize(nummulti); // cut down to the size of actual multichannels
     // initialize data buffer
-    data.resize(buffersize);
-    for(int i=0; i<buffersize;++i){
-      data[i].resize(numchannels);
-    }
+    initBuffer();
     initialized = true;
     emit channelsChanged();
     emit update();
@@ -282,22 +284,48 @@ void ChannelData::setData(const QVector<double>& newdata){
     fprintf(stderr,"Number of data entries (%lld) does not match number of channels (%i)",
             static_cast<long long>(newdata.size()),numchannels);
   }else{
-    ++time;
-    int index = time%buffersize;
-    data[index] = newdata;
+    appendData(newdata.constData());
   }
 }
 
+void ChannelData::appendData(const double* vals){
+  if(buffersize<=0) return;
+  ++time;
+  int index = time%buffersize;
+  double* d = data.data() + index; // detaches only if shared
+  for(int c=0; c<numchannels; ++c){
+    d[c*buffersize] = vals[c];
+  }
+  if(stored<buffersize) ++stored;
+}
+
+HistoryView ChannelData::getHistoryView(int channel, int history) const {
+  if(channel<0 || channel>=numchannels || stored==0) return HistoryView();
+  int len = (history<=0 || history>stored) ? stored : history;
+  const double* column = data.constData() + channel*buffersize;
+  // the newest entry is at time%buffersize
+  int begin = (time-len+1)%buffersize;
+  if(begin<0) begin+=buffersize;
+  int firstLen = std::min(len, buffersize-begin);
+  return HistoryView(column+begin, firstLen, column, len-firstLen);
+}
+
 /* returns the data of the given channels starting from history entries in the past.
     if history=0 then the entire history is given
 */
 QVector<ChannelVals> ChannelData::getHistory(const IndexList& channels, int history) const {
   QVector<ChannelVals> rv;
-  int start = history ==0 ? time-(buffersize-1) : time-history;
-  start = start < 0 ? 0 : start; // not below zero
-  rv.resize(time-start);
-  for(int i=start; i<time; ++i){
-    rv[i-start] = getData(channels,i%buffersize);
+  int k=0;
+  FOREACHC(IndexList, channels, c){
+    HistoryView v = getHistoryView(*c, history);
+    if(rv.isEmpty()) {
+      rv.resize(v.size());
+      for(int i=0; i<rv.size(); ++i) rv[i].resize(channels.size());
+    }
+    for(int i=0; i<v.size(); ++i){
+      rv[i][k] = v[i];
+    }
+    ++k;
   }
   return rv;
 }
@@ -306,14 +334,11 @@ QVector<ChannelVals> ChannelData::getHistory(const IndexList& channels, int hist
     if history=0 then the entire history is given
 */
 QVector<ChannelVals> ChannelData::getHistory(const QList<ChannelName>& channels, int history) const {
-  QVector<ChannelVals> rv;
-  int start = history ==0 ? time-buffersize : time-history;
-  start = start < 0 ? 0 : start; // not below zero
-  rv.resize(time-start);
-  for(int i=start; i<time; ++i){
-    rv[i-start] = getData(channels,i%buffersize);
+  IndexList indices;
+  FOREACHC(QList<ChannelName>, channels, c){
+    indices.push_back(channelindex.value(*c));
   }
-  return rv;
+  return getHistory(indices, history);
 }
 
 // returns the data of the given channel at the given index
@@ -321,7 +346,7 @@ ChannelVals ChannelData::getData(const IndexList& channels, int index) const {
   ChannelVals rv(channels.size());
   int i=0;
   FOREACHC(IndexList, channels, c){
-    rv[i] = data[index][*c];
+    rv[i] = data[*c*buffersize + index];
     ++i;
   }
   return rv;
@@ -333,14 +358,122 @@ ChannelVals ChannelData::getData(const QList<ChannelName>& channels, int index)
   int i=0;
   FOREACHC(QList<ChannelName>, channels, c){
     int k = channelindex[*c];
-    rv[i] = data[index][k];
+    rv[i] = data[k*buffersize + index];
     ++i;
   }
   return rv;
 }
 
 
+static const double powersOf10[] = {
+  1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static inline bool isSpace(ushort c){
+  return c==' ' || c=='\t' || c=='\r' || c=='\n';
+}
+
+/* Parses the number in [p,end). Decimal numbers with at most 19 significant digits,
+   whose mantissa fits into 53 bit and whose decimal exponent is at most 22, are
+   converted exactly by a single multiplication or division (both operands are exact).
+   Everything else (long mantissas, nan, inf, garbage) is given to QString::toDouble.
+ */
+static double parseNumber(const QChar* begin, const QChar* end){
+  const QChar* p = begin;
+  bool negative = false;
+  if(p<end && (p->unicode()=='-' || p->unicode()=='+')){
+    negative = p->unicode()=='-';
+    ++p;
+  }
+  uint64_t mantissa = 0;
+  int digits = 0;   // significant digits in the mantissa
+  int exponent = 0;
+  bool any = false;
+  bool exact = true;
+  for(; p<end; ++p){
+    unsigned d = p->unicode()-'0';
+    if(d>9) break;
+    any = true;
+    if(mantissa==0 && d==0) continue; // leading zeros
+    if(digits<19) { mantissa = mantissa*10+d; ++digits; }
+    else { ++exponent; exact = false; }
+  }
+  if(p<end && p->unicode()=='.'){
+    for(++p; p<end; ++p){
+      unsigned d = p->unicode()-'0';
+      if(d>9) break;
+      any = true;
+      if(mantissa==0 && d==0) { --exponent; continue; }
+      if(digits<19) { mantissa = mantissa*10+d; ++digits; --exponent; }
+      else exact = false;
+    }
+  }
+  if(any && p<end && (p->unicode()=='e' || p->unicode()=='E')){
+    ++p;
+    bool negexp = false;
+    if(p<end && (p->unicode()=='-' || p->unicode()=='+')){
+      negexp = p->unicode()=='-';
+      ++p;
+    }
+    int e = 0;
+    bool expdigits = false;
+    for(; p<end; ++p){
+      unsigned d = p->unicode()-'0';
+      if(d>9) break;
+      expdigits = true;
+      if(e<100000) e = e*10+d;
+    }
+    if(!expdigits) any = false;
+    exponent += negexp ? -e : e;
+  }
+  if(any && p==end && exact && mantissa <= (uint64_t(1)<<53)){
+    double v = static_cast<double>(mantissa);
+    if(mantissa==0) return negative ? -0.0 : 0.0;
+    if(exponent>=-22 && exponent<=22){
+      v = exponent<0 ? v/powersOf10[-exponent] : v*powersOf10[exponent];
+      return negative ? -v : v;
+    }
+  }
+  // rare cases: let Qt do it
+  return QString::fromRawData(begin, end-begin).toDouble();
+}
+
+int ChannelData::parseNumbers(const QChar* s, int len, double* out, int max){
+  const QChar* end = s+len;
+  int n=0;
+  while(true){
+    while(s<end && isSpace(s->unicode())) ++s;
+    if(s==end) break;
+    const QChar* tokenEnd = s;
+    while(tokenEnd<end && !isSpace(tokenEnd->unicode())) ++tokenEnd;
+    if(n<max) out[n] = parseNumber(s, tokenEnd);
+    ++n;
+    s = tokenEnd;
+  }
+  return n;
+}
+
+
 void ChannelData::receiveRawData(const QString& data){
+  // data lines are by far the most frequent ones: parse them without temporaries
+  const QChar* s = data.constData();
+  int len = data.size();
+  int start = 0;
+  while(start<len && isSpace(s[start].unicode())) ++start;
+  if(start==len) return;
+  if(s[start] != QLatin1Char('#')){
+    if(!initialized) return;
+    int n = parseNumbers(s+start, len-start, line.data(), numchannels);
+    if(n != numchannels) {
+      fprintf(stderr,"Number of data entries (%i) does not match number of channels (%i)",
+              n, numchannels);
+    }else{
+      appendData(line.constData());
+    }
+    return;
+  }
+
   QStringList parsedString = data.trimmed().split(' ');  //parse data string with Space as separator
   QString& first = *(parsedString.begin());
   if(first == "#C")   //Channels einlesen
@@ -395,16 +528,4 @@ void ChannelData::receiveRawData(const QString& data){
       printf("Guilogger: Received Quit\n");
       emit quit();
     }
-  else if( first[0] != '#')  // Daten einlesen
-    {
-      QVector<double> dat(parsedString.size());
-      int i=0;
-
-      FOREACH(QStringList, parsedString, s){
-        dat[i] = (*s).trimmed().toDouble();
-        ++i;
-      }
-      setData(dat);
-    }
 }
-
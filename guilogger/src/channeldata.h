@@ -67,6 +67,35 @@ typedef std::list<int> IndexList;
 
 typedef QVector<MultiChannel> MultiChannels;
 
+/** view on the history of one channel without copying the data.
+    The history lies in the ring buffer of the channel and is therefore split into
+    at most two contiguous parts. Index 0 is the oldest entry.
+    The view is only valid until new data arrives or the buffer size changes.
+ */
+class HistoryView {
+public:
+  HistoryView() : first(0), firstSize(0), second(0), secondSize(0) {}
+  HistoryView(const double* first, int firstSize, const double* second, int secondSize)
+    : first(first), firstSize(firstSize), second(second), secondSize(secondSize) {}
+
+  int size() const { return firstSize + secondSize; }
+  double operator[](int i) const {
+    return i < firstSize ? first[i] : second[i-firstSize];
+  }
+  /// older part of the history (contiguous)
+  const double* firstPart() const { return first; }
+  int firstPartSize() const { return firstSize; }
+  /// newer part of the history (contiguous, starts at the beginning of the ring buffer)
+  const double* secondPart() const { return second; }
+  int secondPartSize() const { return secondSize; }
+
+private:
+  const double* first;
+  int firstSize;
+  const double* second;
+  int secondSize;
+};
+
 class ChannelData : public QObject {
   Q_OBJECT
 public:
@@ -108,8 +137,14 @@ public:
   /// returns the data of the given channel at the given index
   ChannelVals getData(const QList<ChannelName>& channels, int i) const;
 
+  /** returns a view (no copy) on the last history entries of the given channel
+      (oldest first). If history=0 then the entire history is given
+   */
+  HistoryView getHistoryView(int channel, int history = 0) const;
+
   /** returns the data of the given channels starting from history entries in the past.
-      if history=0 then the entire history is given
+      if history=0 then the entire history is given.
+      Note: this copies the data, use getHistoryView() where possible
    */
   QVector<ChannelVals> getHistory(const IndexList& channels, int history = 0) const;
   /** returns the data of the given channels starting from history entries in the past.
@@ -117,17 +152,26 @@ public:
    */
   QVector<ChannelVals> getHistory(const QList<ChannelName>& channels, int history = 0) const;
 
-  const QVector<ChannelVals>& getData() const { return data; }
   const QVector<ChannelInfo>& getInfos() const { return channels; }
   int getNumChannels() const { return numchannels; }
   int getNumMultiChannels() const { return multichannels.size(); }
     const MultiChannels& getMultiChannels() const { return multichannels; }
   int getTime() const { return time; }
 
+  /** parses the whitespace separated numbers of a data line in place (no temporary strings).
+      At most max numbers are written to out (invalid numbers are 0 as with QString::toDouble).
+      @return the number of numbers in the line (can be larger than max)
+   */
+  static int parseNumbers(const QChar* line, int len, double* out, int max);
+
 public slots:
   void receiveRawData(const QString& line);
 
 protected:
+  /// (re)allocates the ring buffer for the current number of channels and buffersize
+  void initBuffer();
+  /// appends one entry (numchannels values) to the ring buffer
+  void appendData(const double* vals);
   /// extracts a multichannel from the channels starting from position i (i is advanced)
   MultiChannel extractMultiChannel(int* i);
   /// returns the name without the index specifiers e.g. for A[0][3] it returns A
@@ -139,9 +183,11 @@ signals:
   void rootNameUpdate(const QString& name);
 
 private:
-  /** first array is the ring buffer
-      second array if channels */
-  QVector<ChannelVals>  data;
+  /** ring buffer stored column-wise: the values of channel c are at
+      data[c*buffersize ... (c+1)*buffersize-1] and the entry of time t at t%buffersize */
+  QVector<double> data;
+  /// parsed values of the current line (reused)
+  QVector<double> line;
   /// names of channels
   QVector<ChannelInfo> channels;
   /// number of channels
@@ -161,6 +207,7 @@ private:
   QHash<ChannelName, ChannelInfo> preset;
 
   int time; ///< index for ringbuffer
+  int stored; ///< number of valid entries in the ringbuffer
   bool initialized;
 
   ChannelName emptyChannelName; // empty string
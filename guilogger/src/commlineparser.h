@@ -41,6 +41,7 @@ private:
   bool logg = false;    // Logging on/off
   bool help = false;    // display help or not
   int delay = 0;   // delay for pipe
+  int repeat = 1;  // number of replays in benchmark mode
 
   QMap<QString, QString> paramMap;
   bool mpparse = false;
@@ -64,6 +65,7 @@ public:
   bool    getLogg() const  {return logg;}
   bool    getHelp() const  {return help;}
   int     getDelay() const {return delay;}
+  int     getRepeat() const {return repeat;}
 
 
   // implementation for special use (read guilogger command line parameters)
@@ -77,6 +79,7 @@ public:
     if((i = ComLineParams.indexOf("-p")) != -1) port = ComLineParams[i+1];
     if((i = ComLineParams.indexOf("-f")) != -1) file = ComLineParams[i+1];
     if((i = ComLineParams.indexOf("-d")) != -1) delay = ComLineParams[i+1].toInt();
+    if((i = ComLineParams.indexOf("-n")) != -1) repeat = ComLineParams[i+1].toInt();
     if((i = ComLineParams.indexOf("-l")) != -1) logg = true;
     if((i = ComLineParams.indexOf("-h")) != -1) help = true;
     if((i = ComLineParams.indexOf("--help")) != -1) help = true;
@@ -4,9 +4,10 @@
 #include <cstdio>
 #include <locale.h> // need to set LC_NUMERIC to have a '.' in the numbers piped to gnuplot
 #include <list>
+#include <algorithm>
 
 Gnuplot::Gnuplot(const PlotInfo* plotInfo, int windowNumber)
-  : plotInfo(plotInfo), pipe(0), windowNumber(windowNumber) {
+  : plotInfo(plotInfo), pipe(0), windowNumber(windowNumber), width(400), lastPlotTime(-1), refMismatch(false) {
 };
 
 Gnuplot::~Gnuplot(){
@@ -23,6 +24,7 @@ bool Gnuplot::open(const QString& gnuplotcmd, int w,int h, int x, int y){
   (void)w; (void)h; (void)x; (void)y; // unused on Windows/macOS
 #endif
   char cmd[512];
+  width = w > 0 ? w : 400;
   setlocale(LC_NUMERIC,"C"); // set us type output
 //  setlocale(LC_NUMERIC,"en_US"); // set us type output
 #if defined(WIN32) || defined(_WIN32) || defined (__WIN32) || defined(__WIN32__) \
@@ -85,7 +87,7 @@ void plotDataSet(FILE* f, const ChannelVals& vals){
 
 
 /** make gnuplot plot selected content of data buffers */
-QString Gnuplot::plotCmd(const QString& file, int start, int end){
+QString Gnuplot::plotCmd(const QString& file, int start, int end, const QVector<int>& records){
   const std::list<int>& vc = plotInfo->getVisibleChannels();
   if(vc.size()== 0) return QString();  
   QStringList buffer;  
@@ -96,13 +98,18 @@ QString Gnuplot::plotCmd(const QString& file, int start, int end){
     range=QString(" every ::%1::%2 ").arg(start).arg(end); 
   }
   
+  int k=0;
   FOREACHC(std::list<int>, vc, i){    
     if(first){
       buffer << "plot '" << (file.isEmpty() ? "-" : file)  << "' ";    
       first=false;
     } else {
-      buffer << ", '' ";
+      buffer << (records.isEmpty() ? ", '' " : ", '-' ");
     }
+    if(file.isEmpty() && k < records.size()){
+      buffer << QString(" binary record=%1 format='%float64%float64' u 1:2 ").arg(records[k]);
+    }
+    ++k;
     buffer << range;
     if(!file.isEmpty()){
       if(plotInfo->getUseReference1()){    
@@ -121,6 +128,49 @@ QString Gnuplot::plotCmd(const QString& file, int start, int end){
 
 
 
+void Gnuplot::decimate(Decimation& d, const HistoryView& v, int time, int bucketWidth,
+                       QVector<int>& selected) const {
+  int oldest = time - v.size() + 1; // time step of v[0]
+  if(d.bucketWidth != bucketWidth || time < d.lastTime){ // new settings or buffer reset
+    d = Decimation();
+    d.bucketWidth = bucketWidth;
+    d.lastTime = oldest-1;
+  }
+  if(d.lastTime < oldest-1){ // we missed data: the current bucket is incomplete
+    d.minTime = d.maxTime = -1;
+    d.lastTime = oldest-1;
+  }
+  for(int t = d.lastTime+1; t <= time; ++t){
+    double val = v[t-oldest];
+    if(d.minTime >= 0 && t/bucketWidth != d.minTime/bucketWidth){ // bucket completed
+      d.times.push_back(std::min(d.minTime, d.maxTime));
+      if(d.minTime != d.maxTime) d.times.push_back(std::max(d.minTime, d.maxTime));
+      d.minTime = -1;
+    }
+    if(d.minTime < 0){
+      d.minTime = d.maxTime = t;
+      d.min = d.max = val;
+    } else if(val < d.min){
+      d.minTime = t; d.min = val;
+    } else if(val > d.max){
+      d.maxTime = t; d.max = val;
+    }
+  }
+  d.lastTime = time;
+  // forget what dropped out of the history
+  while(!d.times.empty() && d.times.front() < oldest) d.times.pop_front();
+
+  selected.resize(0);
+  for(std::deque<int>::const_iterator t = d.times.begin(); t != d.times.end(); ++t){
+    selected.push_back(*t);
+  }
+  if(d.minTime >= oldest){
+    selected.push_back(std::min(d.minTime, d.maxTime));
+    if(d.minTime != d.maxTime) selected.push_back(std::max(d.minTime, d.maxTime));
+  }
+}
+
+
 /** make gnuplot plot selected content of data buffers */
 void Gnuplot::plot(){
   // calculate real values for start and end
@@ -135,32 +185,48 @@ void Gnuplot::plot(){
   const ChannelData& cd      = plotInfo->getChannelData();
   const std::list<int>& vc = plotInfo->getVisibleChannels();
   // FILE* pipe = stderr; // test
-  if(vc.size()== 0) return;
-  
-  QString cmd = plotCmd();
-  // fprintf(stderr, "Guilogger: Sending plot command: %s\n", cmd.toLatin1().constData());
-  fprintf(pipe, "%s\n", cmd.toLatin1().constData());    
-  
-  if(plotInfo->getUseReference1()){    
-    std::list<int> visibles(vc.begin(), vc.end());
-    visibles.push_front(plotInfo->getReference1());        
-    const QVector<ChannelVals>& vals = cd.getHistory(visibles, 0); // full history    
-    int len = visibles.size();
-    for(int k=1; k< len; ++k){
-      FOREACHC(QVector<ChannelVals>, vals, v){
-        fprintf(pipe,"%f %f\n", (*v)[0], (*v)[k]);
-      }
-      fprintf(pipe,"e\n");
+  if(vc.size()== 0 || cd.getTime() == 0) return;
+
+  // the histories are read directly from the ring buffer (no copies) and
+  //  reduced to the min and max values per pixel column
+  int time = cd.getTime();
+  int bucketWidth = std::max(1, (cd.getBuffersize() + width - 1) / width);
+  bool useRef = plotInfo->getUseReference1();
+  HistoryView ref;
+  if(useRef) ref = cd.getHistoryView(plotInfo->getReference1());
+
+  QVector<int> records;
+  points.resize(0);
+  bool mismatch = false;
+  FOREACHC(std::list<int>, vc, k){
+    HistoryView v = cd.getHistoryView(*k);
+    // all histories share the buffer, so this should not happen; if it does
+    //  we plot the channel over time instead of dropping the whole plot
+    bool channelRef = useRef && ref.size() == v.size();
+    if(useRef && !channelRef && !refMismatch){
+      fprintf(stderr, "Guilogger: WARNING: reference has %i values but channel %s has %i,"
+              " plotting over time\n", ref.size(), cd.getInfos()[*k].name.toLatin1().constData(), v.size());
     }
-  } else {
-    const QVector<ChannelVals>& vals = cd.getHistory(vc, 0); // full history    
-    int len = vc.size();
-    for(int k=0; k< len; ++k){
-      FOREACHC(QVector<ChannelVals>, vals, v){
-        fprintf(pipe,"%f\n", (*v)[k]);
-      }
-      fprintf(pipe,"e\n");
+    mismatch |= useRef && !channelRef;
+    int oldest = time - v.size() + 1;
+    decimate(decimations[*k], v, time, bucketWidth, selected);
+    FOREACHC(QVector<int>, selected, t){
+      int i = *t - oldest;
+      points.push_back(channelRef ? ref[i] : i);
+      points.push_back(v[i]);
     }
+    records.push_back(selected.size());
   }
+  refMismatch = mismatch;
+
+  QString cmd = plotCmd(QString(), -1, -1, records);
+  // only send if something changed
+  if(time == lastPlotTime && cmd == lastPlotCmd) return;
+  lastPlotTime = time;
+  lastPlotCmd  = cmd;
+
+  // fprintf(stderr, "Guilogger: Sending plot command: %s\n", cmd.toLatin1().constData());
+  fprintf(pipe, "%s\n", cmd.toLatin1().constData());
+  fwrite(points.constData(), sizeof(double), points.size(), pipe);
   fflush(pipe);
-};    
+};
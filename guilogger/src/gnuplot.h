@@ -8,6 +8,9 @@
 #define GNUPLOT_H
 
 #include <QString>
+#include <QVector>
+#include <deque>
+#include <map>
 
 #include "plotinfo.h"
 
@@ -22,7 +25,7 @@
 
 class Gnuplot{
 public: 
-  Gnuplot() : plotInfo(0), windowNumber(0) {} 
+  Gnuplot() : plotInfo(0), pipe(0), windowNumber(0), width(400), lastPlotTime(-1), refMismatch(false) {}
   Gnuplot(const PlotInfo* plotinfo, int windowNumber = 0);
   
   ~Gnuplot();
@@ -39,13 +42,20 @@ public:
   void command(const QString& cmd);
 
 
-  /** make gnuplot plot channels */
-  void plot();    
+  /** make gnuplot plot channels.
+      The histories are decimated to the width of the window (min/max per pixel)
+      and send as binary inline data. Nothing is send if neither the data
+      nor the plot settings changed since the last call.
+   */
+  void plot();
 
   /** creates the plot command
-      if file is empty then the stdin is assumed ('-') and no using are given
+      if file is empty then the stdin is assumed ('-') and no using are given.
+      If records are given (one per visible channel) then binary inline data
+      (pairs of doubles) with the given number of records is expected
    */
-  QString plotCmd(const QString& file=QString(), int start=-1, int end=-1);
+  QString plotCmd(const QString& file=QString(), int start=-1, int end=-1,
+                  const QVector<int>& records = QVector<int>());
     
 //   /** make gnuplot XY plot content of x against y data buffers 
 //       use it as follow:
@@ -61,9 +71,35 @@ public:
 //   void plotXY(const T& x, const T& y);
 
 private:
+  /** min/max decimation of the history of one channel, updated incrementally.
+      The buckets are aligned to the time, such that completed buckets never change
+      and only the new data has to be scanned.
+   */
+  struct Decimation {
+    int bucketWidth = 0;
+    int lastTime = 0;      ///< last time step that was processed
+    std::deque<int> times; ///< selected time steps of the completed buckets (ascending)
+    int minTime = -1;      ///< time step of the minimum in the current bucket (-1: empty)
+    int maxTime = -1;      ///< time step of the maximum in the current bucket
+    double min = 0;
+    double max = 0;
+  };
+
+  /// processes the new data of the channel and returns the time steps to plot (ascending)
+  void decimate(Decimation& d, const HistoryView& v, int time, int bucketWidth,
+                QVector<int>& selected) const;
+
   const PlotInfo* plotInfo;
   FILE* pipe;
   int windowNumber;
+  int width; ///< width of the window in pixels
+
+  std::map<int, Decimation> decimations; ///< per channel
+  int lastPlotTime;  ///< time of the channel data at the last plot
+  QString lastPlotCmd;
+  bool refMismatch; ///< reference and a channel differed in size at the last plot
+  QVector<int> selected;  ///< time steps to plot (reused)
+  QVector<double> points; ///< binary data to send (reused)
 };
 
 #endif
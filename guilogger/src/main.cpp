@@ -25,6 +25,10 @@
 #define DEBUG
 
 #include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <QElapsedTimer>
+#include <QStringList>
 
 #include <QApplication>
 #include <QScreen>
@@ -34,6 +38,8 @@
 #include "qserialreader.h"
 #include "qpipereader.h"
 #include "commlineparser.h"
+#include "channeldata.h"
+#include "stl_adds.h"
 
 
 void signal_handler_exit(void){
@@ -60,15 +66,52 @@ void signal_handler_init(){
 
 void printUsage(){
   printf("guilogger parameter listing\n");
-  printf("   -m [mode]  mode = serial | pipe (def) | fpipe| file\n");
+  printf("   -m [mode]  mode = serial | pipe (def) | fpipe| file | bench\n");
   printf("   -p [port]  port = serial port to read from\n");
   printf("   -d [delay] delay = ms to wait between data (for fpipe)\n");
   printf("   -f [file]  input file\n");
   printf("      only viwewing, no streaming\n");
+  printf("   -n [num]   number of replays of the file (for bench)\n");
   printf("   -l turns logging on\n");
   printf("   --help displays this message.\n");
 }
 
+/**
+ * Replays the given log file through the channel data without any gui
+ * and reports the number of lines per second (parsing and storing).
+ */
+int benchmark(const CommLineParser& params){
+  FILE* f = fopen(params.getFile().toLatin1().constData(),"r");
+  if(!f){
+    fprintf(stderr, "Guilogger: Cannot open input file %s\n", params.getFile().toLatin1().constData());
+    return 1;
+  }
+  // read everything first to measure the parsing only
+  QStringList lines;
+  char* s = 0;
+  size_t size = 0;
+  while(getline(&s, &size, f) != -1){
+    lines.push_back(QString(s));
+  }
+  free(s);
+  fclose(f);
+
+  ChannelData cd(250);
+  long numLines=0;
+  QElapsedTimer timer;
+  timer.start();
+  for(int r=0; r<params.getRepeat(); ++r){
+    FOREACHC(QStringList, lines, l){
+      cd.receiveRawData(*l);
+    }
+    numLines += lines.size();
+  }
+  double secs = timer.nsecsElapsed()*1e-9;
+  printf("Guilogger benchmark: %li lines with %i channels in %.3f s: %.0f lines/s\n",
+         numLines, cd.getNumChannels(), secs, secs > 0 ? numLines/secs : 0.0);
+  return 0;
+}
+
 /**
   * \brief Main Programm
   * \author Dominic Schneider
@@ -82,6 +125,9 @@ int main( int argc, char ** argv ) {
      printUsage();
      return 1;
    }
+   if(params.getMode()=="bench") { // headless
+     return benchmark(params);
+   }
 
     QApplication a( argc, argv );
 
@@ -129,8 +129,8 @@ namespace lpzrobots {
     }
   }
 
-  void OdeAgent::step(double noise, double time){
-    Agent::step(noise, time);
+  void OdeAgent::applyStep(double time){
+    Agent::applyStep(time);
     // for the main trace we do not call track, this in done in agent
     // track the segments
     FOREACH(TraceDrawerList, segmentTracking, td){
@@ -93,7 +93,8 @@ namespace lpzrobots {
       return Agent::init(controller, robot, wiring, seed);
     }
 
-    virtual void step(double noise, double time) override;
+    /// sends the motor commands, plots and tracks the robot and its segments
+    virtual void applyStep(double time) override;
 
     /**
      * Returns a pointer to the robot.
@@ -46,6 +46,21 @@ namespace lpzrobots {
     addParameterDef("fps"              ,&fps,            25,0.0001,200, "frames per second");
     addParameterDef("logwhilerecording",&logWhileRecording, true,
                     "record log file and store agents while recording a video");
+    addParameterDef("stepmethod"       ,&stepMethod,     WorldStep, 0, 2,
+                    "physics integrator: 0: exact (dWorldStep), 1: iterative (QuickStep), "
+                    "2: auto (QuickStep above autostepjoints)");
+    addParameterDef("quickstepiterations",&quickStepIterations, 20, 1, 500,
+                    "number of iterations of QuickStep");
+    addParameterDef("quickstepsor"     ,&quickStepSOR,   1.3, 0.1, 2,
+                    "successive over-relaxation parameter of QuickStep");
+    addParameterDef("autostepjoints"   ,&autoStepJoints, 200, 1, 100000,
+                    "number of active joints above which QuickStep is used in auto mode");
+    addParameterDef("broadphase"       ,&broadPhase,     HashSpace, 0, 1,
+                    "top-level collision space: 0: hash space, 1: sweep and prune "
+                    "(for many slowly moving geoms; only used at the start)");
+    addParameterDef("islandthreads"    ,&islandThreads,  0, 0, 64,
+                    "number of threads stepping independent islands (groups of connected "
+                    "bodies) in parallel (0: one after the other)");
 
     drawInterval = calcDrawInterval(fps,realTimeFactor);
     // prepare name;
@@ -73,6 +88,16 @@ namespace lpzrobots {
       dWorldSetGravity ( odeHandle.world , 0 , 0 , gravity );
     } else if(key == "controlinterval") {
       controlInterval = std::max(1,controlInterval);
+    } else if(key == "quickstepiterations" || key == "quickstepsor") {
+      quickStepIterations = std::max(1,quickStepIterations);
+      setQuickStepParams();
+    } else if(key == "stepmethod") {
+      stepMethod = std::min(std::max(0,stepMethod),2);
+    } else if(key == "islandthreads") {
+      islandThreads = std::max(0,islandThreads);
+      setIslandThreads();
+    } else if(key == "broadphase") {
+      broadPhase = std::min(std::max(0,broadPhase),1);
     } else if(key == "randomseed") { // this is readonly!
       std::cerr << "randomseed is readonly" << std::endl;
       randomSeedCopy = randomSeed; // reset changes
@@ -81,6 +106,44 @@ namespace lpzrobots {
 
   void OdeConfig::setOdeHandle(const OdeHandle& odeHandle_){
     this->odeHandle = odeHandle_;
+    setQuickStepParams();
+    if(islandThreads > 0) // otherwise keep the default of ODE (ODE_ISLAND_THREADS)
+      setIslandThreads();
+  }
+
+  void OdeConfig::setQuickStepParams(){
+    if(odeHandle.world){
+      dWorldSetQuickStepNumIterations(odeHandle.world, quickStepIterations);
+      dWorldSetQuickStepW(odeHandle.world, quickStepSOR);
+    }
+  }
+
+  void OdeConfig::setIslandThreads(){
+    if(odeHandle.world){
+#ifdef dWORLD_ISLAND_THREADS
+      dWorldSetIslandThreads(odeHandle.world, islandThreads);
+#else
+      if(islandThreads > 0)
+        std::cerr << "islandthreads: not supported by this ODE library "
+                  << "(see opende/patches/ode-0.11_island_threads.patch)" << std::endl;
+#endif
+    }
+  }
+
+  bool OdeConfig::useQuickStep(int activeJoints){
+    switch(stepMethod){
+    case QuickStep:
+      return true;
+    case AutoStep:
+      // hysteresis of 20% to avoid switching back and forth
+      if(quickStepActive)
+        quickStepActive = activeJoints > autoStepJoints * 0.8;
+      else
+        quickStepActive = activeJoints > autoStepJoints;
+      return quickStepActive;
+    default:
+      return false;
+    }
   }
 
   void OdeConfig::setVideoRecordingMode(bool mode) {
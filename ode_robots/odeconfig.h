@@ -53,6 +53,11 @@ namespace lpzrobots {
 
     virtual void calcAndSetDrawInterval(double Hz, double rtf);
 
+    /** decides whether the next physics step uses dWorldQuickStep
+        (depending on stepMethod and for AutoStep on the number of active joints)
+    */
+    virtual bool useQuickStep(int activeJoints);
+
     /******** CONFIGURABLE ***********/
     virtual void notifyOnChange(const paramkey& key) override;
 
@@ -74,7 +79,31 @@ namespace lpzrobots {
 
     double realTimeFactor = 0;
     double fps = 0;
+
+    /// integrator of the physics (parameter "stepmethod")
+    enum StepMethod { WorldStep = 0, ///< dWorldStep: exact, O(n^3) in the number of joints
+                      QuickStep = 1, ///< dWorldQuickStep: iterative (SOR-LCP), O(n)
+                      AutoStep = 2   ///< QuickStep if there are more than autoStepJoints joints
+    };
+    int stepMethod = WorldStep;
+    int quickStepIterations = 0;
+    double quickStepSOR = 0;
+    int autoStepJoints = 0;
+
+    /// type of the top-level collision space (parameter "broadphase", used at the start)
+    enum BroadPhase { HashSpace = 0, ///< hash space, rebuilt in every step
+                      SAPSpace = 1   ///< persistent sweep and prune (dSweepAndPruneSpace)
+    };
+    int broadPhase = HashSpace;
+    /// threads stepping the islands in parallel (parameter "islandthreads", 0: serial)
+    int islandThreads = 0;
   protected:
+    /// applies the QuickStep parameters to the world
+    void setQuickStepParams();
+    /// applies islandThreads to the world
+    void setIslandThreads();
+    bool quickStepActive = false; // current choice in AutoStep mode
+
     long randomSeed = 0;
     double randomSeedCopy = 0;
   };
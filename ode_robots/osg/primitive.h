@@ -28,6 +28,7 @@
 #include <ode-dbl/common.h>
 #include <selforg/storeable.h>
 
+#include <cstdint>
 #include <vector>
 
 #include "pos.h"
@@ -212,6 +213,12 @@ protected:
   bool substanceManuallySet = false;
   int numVelocityViolations = 0; ///< number of times the maximal velocity was exceeded
 
+  friend class OdeHandle;
+  /// group in the exclusion table of ignored pairs (see OdeHandle::addIgnoredPair), -1: none
+  int filterGroup = -1;
+  int filterSlot = 0;          ///< slot within the group
+  uint64_t filterExclude = 0;  ///< bit i set: no collision with slot i of the same group
+
   // 20091023; guettler:
   // hack for tasked simulations; there are some problems if running in parallel mode,
   // if you do not destroy the geom, everything is fine (should be no problem because world is destroying geoms too)
@@ -686,8 +686,7 @@ namespace lpzrobots {
     }
 
      // Added sound sensors (3) // sense from environment
-    for(SoundSensor* sensor: soundsensors)
-      sensor->sense(globalData);
+    SoundSensor::senseAll(soundsensors, globalData);
 
   }
 
@@ -23,8 +23,13 @@
  ***************************************************************************/
 
 #include "opticalflow.h"
+#include "globaldata.h"
+#include <selforg/workstealingpool.h>
 #include <iostream>
 #include <iomanip>
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
 
 // #include <osgDB/WriteFile>
 
@@ -42,7 +47,7 @@ namespace lpzrobots {
   }
 
   OpticalFlow::OpticalFlow(OpticalFlowConf conf_) : conf(conf_), fields(), data(), lasts{}, cnt(4), avgerror(-1), 
-      maxShiftX(0), maxShiftY(0), width(0), height(0) {
+      maxShiftX(0), maxShiftY(0), width(0), height(0), levels(0) {
     num = conf.points.size() * (bool(conf.dims & Sensor::X) + bool(conf.dims & Sensor::Y));
     data.resize(num, 0);
     std::fill(lasts.begin(), lasts.end(), nullptr);
@@ -81,9 +86,15 @@ namespace lpzrobots {
     if(conf.fieldSize == 0)
       conf.fieldSize = max(width,height)/12;
     conf.fieldSize = min(conf.fieldSize, min(width, height)/4); // make sure it is not too large.
+    // the coarsest level should still have a reasonable field and shift
+    levels = 0;
+    while(levels < conf.pyramidLevels && (conf.fieldSize >> (levels+1)) >= 4
+          && (maxShiftX >> (levels+1)) >= 1 && (maxShiftY >> (levels+1)) >= 1)
+      ++levels;
     if(conf.verbose) std::cout << "Optical Flow (OF): Size " << conf.fieldSize 
                                 << ", maxShiftX " << maxShiftX 
-                                << ", maxShiftY " << maxShiftY << std::endl;
+                                << ", maxShiftY " << maxShiftY 
+                                << ", pyramid levels " << levels << std::endl;
     // calculate field positions
     FOREACHC(list<Pos>, conf.points, p){
       // the points are in coordinates -1 to 1
@@ -100,24 +111,48 @@ namespace lpzrobots {
 
     for(int i=0; i<4; ++i) {
       lasts[i] = new osg::Image(*img, osg::CopyOp::DEEP_COPY_IMAGES);
+      buildPyramid(img->data(), width, height, levels, lastPyrs[i]);
     }
 
     oldFlows.resize(fields.size());
+    matches.resize(fields.size());
   };
 
 
   /// Performs the calculations
   bool OpticalFlow::sense(const GlobalData& globaldata){
     const osg::Image* img = camera->getImage();
-    int k=0; // sensor buffer index
-    int i=0; // field index
-    // do not use quickmp here because the sense function is already in a quickmp loop.
-    FOREACHC(list<Vec2i>, fields, f){
-      FlowDelList flows;
+    if(levels>0) buildPyramid(img->data(), width, height, levels, currentPyr);
+
+    // matching of the fields in parallel (serial if sense is already called in parallel)
+    auto matchField = [this, img](std::size_t i){
+      matches[i].clear();
       // we do optical flow detection with a cascade of delays (1,2,4)
       for(int t=1; t<=4; t*=2) {
-        double minerror;
-        Vec2i flow = calcFieldTransRGB(*f, img, lasts[(cnt-t)%4], minerror);
+        Match m;
+        m.delay = t;
+        if(levels>0)
+          m.flow = calcFieldTransPyramid(fields[i], img, currentPyr, lasts[(cnt-t)%4],
+                                         lastPyrs[(cnt-t)%4], m.error);
+        else
+          m.flow = calcFieldTransRGB(fields[i], img, lasts[(cnt-t)%4], m.error);
+        matches[i].push_back(m);
+        // if the flow is too high, then do not continue
+        if(abs(m.flow.x) > maxShiftX/2  || abs(m.flow.y) > maxShiftY/2) break;
+      }
+    };
+    if(globaldata.workerPool && fields.size()>1)
+      globaldata.workerPool->parallelFor(0, fields.size(), matchField);
+    else
+      for(std::size_t i=0; i<fields.size(); ++i) matchField(i);
+
+    int k=0; // sensor buffer index
+    for(int i=0; i<static_cast<int>(fields.size()); ++i){
+      FlowDelList flows;
+      FOREACHC(std::vector<Match>, matches[i], m){
+        const Vec2i& flow = m->flow;
+        const int t = m->delay;
+        const double minerror = m->error;
         if(avgerror<0) avgerror = minerror;
         else avgerror = 0.99*avgerror + minerror*0.01;
         // if the flow is too high, then do not continue (at the end of the loop)
@@ -153,10 +188,10 @@ namespace lpzrobots {
       if(conf.dims & Sensor::X) data[k++] = flow.x/static_cast<double>(maxShiftX);
       if(conf.dims & Sensor::Y) data[k++] = flow.y/static_cast<double>(maxShiftY);
       oldFlows[i] = flow; // save the flow
-      ++i;
     }
     // copy image to memory
     memcpy(lasts[cnt%4]->data(), img->data(), img->getImageSizeInBytes());
+    if(levels>0) std::swap(lastPyrs[cnt%4], currentPyr);
     ++cnt;
     return true;
   }
@@ -168,31 +203,74 @@ namespace lpzrobots {
   }
 
 
+  /// sum of absolute differences of n bytes
+  static inline unsigned int sad(const unsigned char* p1, const unsigned char* p2, int n){
+    unsigned int sum = 0;
+    int k = 0;
+#ifdef __AVX2__
+    __m256i acc256 = _mm256_setzero_si256();
+    for (; k + 32 <= n; k += 32) {
+      acc256 = _mm256_add_epi64(acc256, _mm256_sad_epu8(
+                 _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p1 + k)),
+                 _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p2 + k))));
+    }
+    __m128i acc = _mm_add_epi64(_mm256_castsi256_si128(acc256),
+                                _mm256_extracti128_si256(acc256, 1));
+#elif defined(__SSE2__)
+    __m128i acc = _mm_setzero_si128();
+#endif
+#ifdef __SSE2__
+    for (; k + 16 <= n; k += 16) {
+      acc = _mm_add_epi64(acc, _mm_sad_epu8(
+              _mm_loadu_si128(reinterpret_cast<const __m128i*>(p1 + k)),
+              _mm_loadu_si128(reinterpret_cast<const __m128i*>(p2 + k))));
+    }
+    sum = _mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+#endif
+    for (; k < n; ++k) {
+      sum += abs(static_cast<int>(p1[k]) - static_cast<int>(p2[k]));
+    }
+    return sum;
+  }
+
   // this is taken from Georg's vid.stab video stabilization tool
   double OpticalFlow::compareSubImg(const unsigned char* const I1,
                                     const unsigned char* const I2,
                                     const Vec2i& field, int size,
                                     int width, int height, int bytesPerPixel,
-                                    int d_x, int d_y) {
-    int k, j;
+                                    int d_x, int d_y, double maxerror) {
     const unsigned char* p1 = nullptr;
     const unsigned char* p2 = nullptr;
     int s2 = size / 2;
-    double sum = 0;
+    unsigned int sum = 0;
+    const double norm = static_cast<double>(size *size* bytesPerPixel);
 
     p1=I1 + ((field.x - s2) + (field.y - s2)*width)*bytesPerPixel;
     p2=I2 + ((field.x - s2 + d_x) + (field.y - s2 + d_y)*width)*bytesPerPixel;
-    // TODO: use some mmx or sse stuff here
-    for (j = 0; j < size; ++j) {
-        for (k = 0; k < size * bytesPerPixel; ++k) {
-          sum += abs(static_cast<int>(*p1) - static_cast<int>(*p2));
-          ++p1;
-          ++p2;
+    for (int j = 0; j < size; ++j) {
+      sum += sad(p1, p2, size * bytesPerPixel);
+      // the error can only grow, so stop if it cannot be better than maxerror
+      if (sum/norm >= maxerror) break;
+      p1 += width * bytesPerPixel;
+      p2 += width * bytesPerPixel;
+    }
+    return sum/norm;
+  }
+
+  void OpticalFlow::searchRange(const unsigned char* I1, const unsigned char* I2,
+                                const Vec2i& field, int size, int width, int height,
+                                int x0, int x1, int y0, int y1, int step,
+                                Vec2i& t, double& minerror) {
+    for (int i = x0; i <= x1; i += step) {
+      for (int j = y0; j <= y1; j += step) {
+        double error = compareSubImg(I1, I2, field, size, width, height, 3, i, j, minerror);
+        if (error < minerror) {
+          minerror = error;
+          t.x = i;
+          t.y = j;
         }
-        p1 += (width - size) * bytesPerPixel;
-        p2 += (width - size) * bytesPerPixel;
+      }
     }
-    return sum/static_cast<double>(size *size* bytesPerPixel);
   }
 
   // this is taken from Georg's vid.stab video stabilization tool
@@ -202,31 +280,70 @@ namespace lpzrobots {
                                                     double& minerror) const {
     Vec2i t;
     const unsigned char *I_c = current->data(), *I_p = previous->data();
-    int i, j;
 
     minerror = 1e20;
     // check only every second step
-    for (i = -maxShiftX; i <= maxShiftX; i += 2) {
-      for (j=-maxShiftY; j <= maxShiftY; j += 2) {
-        double error = compareSubImg(I_c, I_p, field, conf.fieldSize,
-                                     width, height, 3, i, j);
-        if (error < minerror) {
-          minerror = error;
-          t.x = i;
-          t.y = j;
+    searchRange(I_c, I_p, field, conf.fieldSize, width, height,
+                -maxShiftX, maxShiftX, -maxShiftY, maxShiftY, 2, t, minerror);
+    // check around the best match of above
+    searchRange(I_c, I_p, field, conf.fieldSize, width, height,
+                t.x - 1, t.x + 1, t.y - 1, t.y + 1, 2, t, minerror);
+    return t;
+  }
+
+  void OpticalFlow::buildPyramid(const unsigned char* image, int width, int height,
+                                 int levels, Pyramid& pyramid) {
+    pyramid.resize(levels);
+    const unsigned char* src = image;
+    int w = width;
+    for (int l = 1; l <= levels; ++l) {
+      const int wl = width >> l, hl = height >> l;
+      std::vector<unsigned char>& dst = pyramid[l-1];
+      dst.resize(wl * hl * 3);
+      // every pixel is the average of 2x2 pixels of the finer level
+      for (int y = 0; y < hl; ++y) {
+        const unsigned char* r1 = src + (2*y*w)*3;
+        const unsigned char* r2 = r1 + w*3;
+        unsigned char* d = &dst[y*wl*3];
+        for (int x = 0; x < wl*3; x += 3) {
+          for (int c = 0; c < 3; ++c) {
+            d[x+c] = (r1[2*x+c] + r1[2*x+3+c] + r2[2*x+c] + r2[2*x+3+c] + 2) >> 2;
+          }
         }
       }
+      src = dst.data();
+      w = wl;
     }
-    // check around the best match of above
-    for (i = t.x - 1; i <= t.x + 1; i += 2) {
-      for (j = -t.y - 1; j <= t.y + 1; j += 2) {
-        double error = compareSubImg(I_c, I_p, field, conf.fieldSize,
-                                     width, height, 3, i, j);
-        if (error < minerror) {
-          minerror = error;
-          t.x = i;
-          t.y = j;
-        }
+  }
+
+  OpticalFlow::Vec2i OpticalFlow::calcFieldTransPyramid(const Vec2i& field,
+                                                        const osg::Image* current,
+                                                        const Pyramid& currentPyr,
+                                                        const osg::Image* previous,
+                                                        const Pyramid& previousPyr,
+                                                        double& minerror) const {
+    Vec2i t;
+    for (int l = levels; l >= 0; --l) {
+      const unsigned char* I_c = l==0 ? current->data()  : currentPyr[l-1].data();
+      const unsigned char* I_p = l==0 ? previous->data() : previousPyr[l-1].data();
+      const int wl = width >> l, hl = height >> l;
+      const int size = conf.fieldSize >> l;
+      const int s2 = size / 2;
+      const Vec2i f(field.x >> l, field.y >> l);
+      // allowed shifts on this level (the field has to stay inside the image)
+      const int xmin = max(-(maxShiftX >> l), s2 - f.x);
+      const int xmax = min(maxShiftX >> l, wl - size - f.x + s2);
+      const int ymin = max(-(maxShiftY >> l), s2 - f.y);
+      const int ymax = min(maxShiftY >> l, hl - size - f.y + s2);
+      minerror = 1e20;
+      if (l == levels) { // full search on the coarsest level
+        searchRange(I_c, I_p, f, size, wl, hl, xmin, xmax, ymin, ymax, 1, t, minerror);
+      } else { // refine the flow of the coarser level
+        const Vec2i c = t*2;
+        t = c;
+        searchRange(I_c, I_p, f, size, wl, hl,
+                    max(c.x - 1, xmin), min(c.x + 1, xmax),
+                    max(c.y - 1, ymin), min(c.y + 1, ymax), 1, t, minerror);
       }
     }
     return t;
@@ -47,6 +47,11 @@ namespace lpzrobots {
     /** size (edge length) of the measurement field (block) in pixel 
         (if 0 then 1/12th of width) */
     int fieldSize;
+    /** number of image pyramid levels (each with half the resolution) for a 
+        coarse-to-fine search: the full search is done on the coarsest level and the
+        flow is refined on the finer levels. 0 means a full search on the original image.
+        The number of levels is reduced if the field on the coarsest level gets too small.*/
+    int pyramidLevels;
     /** verbosity level 
         (0: quite, 1: initialization values, 2: warnings, 3: info, 4: debug) */
     int verbose;
@@ -91,6 +96,7 @@ namespace lpzrobots {
       c.points  = getDefaultPoints(2);
       c.fieldSize = 24; 
       c.maxFlow = 0.15;
+      c.pyramidLevels = 0;
       c.verbose = 1;
       return c;
     }
@@ -117,11 +123,14 @@ namespace lpzrobots {
        \param size specifies the size of the field edged in pixels
        \param d_x shift in x direction
        \param d_y shift in y direction   
+       \param maxerror if the error reaches this value the comparison is stopped 
+         and a value >= maxerror is returned
     */    
     static double compareSubImg(const unsigned char* const I1, 
                                 const unsigned char* const I2, 
                                 const Vec2i& field, int size, int width, int height, 
-                                int bytesPerPixel, int d_x,int d_y);
+                                int bytesPerPixel, int d_x,int d_y, 
+                                double maxerror = 1e20);
 
     /** calculates the optimal transformation for one field in RGB 
      *   using all three color channels
@@ -130,10 +139,32 @@ namespace lpzrobots {
     Vec2i calcFieldTransRGB(const Vec2i& field, const osg::Image* current, 
                             const osg::Image* last, double& minerror) const;
 
+    /// images of the pyramid levels 1..levels (level 0 is the image itself)
+    typedef std::vector< std::vector<unsigned char> > Pyramid;
+
+    /// calculates the pyramid levels of an RGB image
+    static void buildPyramid(const unsigned char* image, int width, int height, 
+                             int levels, Pyramid& pyramid);
+
+    /** like calcFieldTransRGB() but with a coarse-to-fine search on the image pyramids
+     */
+    Vec2i calcFieldTransPyramid(const Vec2i& field, 
+                                const osg::Image* current, const Pyramid& currentPyr,
+                                const osg::Image* last, const Pyramid& lastPyr,
+                                double& minerror) const;
+
+    /** tests all shifts in the given range (with step size step) and updates
+        the best shift t and its error minerror
+     */
+    static void searchRange(const unsigned char* I1, const unsigned char* I2,
+                            const Vec2i& field, int size, int width, int height,
+                            int x0, int x1, int y0, int y1, int step,
+                            Vec2i& t, double& minerror);
+
   protected:
     OpticalFlowConf conf;
     int num;
-    std::list<Vec2i> fields; // fields in image coordinates
+    std::vector<Vec2i> fields; // fields in image coordinates
     std::vector<sensor> data;
     std::array<osg::Image*, 4> lasts;
     std::vector<Vec2i> oldFlows;
@@ -143,6 +174,15 @@ namespace lpzrobots {
     int height;
     int cnt;
     double avgerror; // average minimum matching error
+    int levels; // number of pyramid levels used
+    Pyramid currentPyr;
+    std::array<Pyramid, 4> lastPyrs;
+    struct Match {
+      Vec2i flow;
+      int delay;
+      double error;
+    };
+    std::vector< std::vector<Match> > matches; // per field, calculated in parallel
   }; 
 
 
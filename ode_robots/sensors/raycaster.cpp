@@ -0,0 +1,107 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2011 LpzRobots development team                    *
+ *    Georg Martius  <georg dot martius at web dot de>                     *
+ *    Frank Guettler <guettler at informatik dot uni-leipzig dot de        *
+ *    Frank Hesse    <frank at nld dot ds dot mpg dot de>                  *
+ *    Ralf Der       <ralfder at mis dot mpg dot de>                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <algorithm>
+#include <ode-dbl/ode.h>
+
+#include "raycaster.h"
+#include "raysensorbank.h"
+#include "primitive.h"
+
+namespace lpzrobots {
+
+  namespace {
+    // a ray through a trimesh can have several intersections
+    const int maxRayContacts = 8;
+  }
+
+  void RayCaster::cast(const OdeHandle& odeHandle, long int step){
+    if(!odeHandle.raySpace || dSpaceGetNumGeoms(odeHandle.raySpace) == 0)
+      return;
+    this->odeHandle = &odeHandle;
+    usedChains = 0;
+    candidates.clear();
+    // broad phase: all rays at once against the top-level space
+    dSpaceClean(odeHandle.raySpace);
+    dSpaceCollide2(reinterpret_cast<dGeomID>(odeHandle.raySpace),
+                   reinterpret_cast<dGeomID>(odeHandle.space), this, &nearCallback);
+
+    // narrow phase: closest intersection per ray
+    dContactGeom contacts[maxRayContacts];
+    for(const Candidate& c : candidates){
+      int n = dCollide(c.ray, c.geom, maxRayContacts, contacts, sizeof(dContactGeom));
+      if(n <= 0) continue;
+      double depth = contacts[0].depth;
+      for(int i = 1; i < n; ++i)
+        depth = std::min(depth, static_cast<double>(contacts[i].depth));
+      // the ray is wrapped by the transform primitive, its userdata is the sensor
+      const Primitive* p = static_cast<const Primitive*>(dGeomGetData(c.ray));
+      static_cast<RaySensor*>(p->substance.userdata)->setLength(depth, step);
+    }
+  }
+
+  const RayCaster::OwnerChain& RayCaster::chainOf(const RaySensorBank* bank){
+    for(int i = 0; i < usedChains; ++i){
+      if(chains[i].bank == bank) return chains[i];
+    }
+    if(usedChains == static_cast<int>(chains.size()))
+      chains.push_back(OwnerChain());
+    OwnerChain& chain = chains[usedChains++];
+    chain.bank = bank;
+    chain.spaces.clear();
+    chain.collided.clear();
+    for(dSpaceID s = bank->getOwnerSpace(); s != 0;
+        s = dGeomGetSpace(reinterpret_cast<dGeomID>(s))){
+      chain.spaces.push_back(s);
+      chain.collided.push_back(odeHandle->isCollidedSpace(s));
+    }
+    return chain;
+  }
+
+  void RayCaster::nearCallback(void* data, dGeomID o1, dGeomID o2){
+    RayCaster* me = static_cast<RayCaster*>(data);
+    // o1 is on the side of the rays: a bank space or a ray within it
+    dSpaceID bankSpace = dGeomIsSpace(o1) ? reinterpret_cast<dSpaceID>(o1) : dGeomGetSpace(o1);
+    const RaySensorBank* bank =
+      static_cast<const RaySensorBank*>(dGeomGetData(reinterpret_cast<dGeomID>(bankSpace)));
+    const OwnerChain& chain = me->chainOf(bank);
+
+    // o2 is in the world. Its pair with the ray was collided before only if the lowest
+    //  space containing both is collided inside. Spaces on the chain are always entered.
+    dSpaceID parent = dGeomGetSpace(o2);
+    bool onChain = std::find(chain.spaces.begin(), chain.spaces.end(),
+                             reinterpret_cast<dSpaceID>(o2)) != chain.spaces.end();
+    if(!onChain){
+      for(size_t i = 0; i < chain.spaces.size(); ++i){
+        if(chain.spaces[i] == parent && !chain.collided[i]) return;
+      }
+    }
+    if(dGeomIsSpace(o1) || dGeomIsSpace(o2)){
+      dSpaceCollide2(o1, o2, data, &nearCallback);
+    } else {
+      me->candidates.push_back(Candidate{o1, o2});
+    }
+  }
+
+}
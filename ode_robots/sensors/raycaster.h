@@ -0,0 +1,86 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2011 LpzRobots development team                    *
+ *    Georg Martius  <georg dot martius at web dot de>                     *
+ *    Frank Guettler <guettler at informatik dot uni-leipzig dot de        *
+ *    Frank Hesse    <frank at nld dot ds dot mpg dot de>                  *
+ *    Ralf Der       <ralfder at mis dot mpg dot de>                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __RAYCASTER_H
+#define __RAYCASTER_H
+
+#include <vector>
+#include <ode-dbl/common.h>
+#include "odehandle.h"
+
+namespace lpzrobots {
+
+  class RaySensorBank;
+
+  /**
+     Casts the rays of all RaySensorBanks in one batched pass.
+
+     The banks keep their rays in OdeHandle::raySpace, which is not part of the
+     collision space of the simulation, so the rays do not enter the broad phase,
+     the nearCallback and the substance callbacks.
+     cast() collides the whole ray space once against the top-level space (using
+     its acceleration structure), computes the intersections and writes the closest
+     distance of every ray directly into its RaySensor.
+
+     A ray sees the same geoms as before: geoms of other robots and obstacles and
+     the geoms of its own robot if the robot space collides internally,
+     but never the body it is attached to.
+   */
+  class RayCaster {
+  public:
+    RayCaster() {}
+
+    /** casts all rays of odeHandle.raySpace against the top-level space odeHandle.space
+        @param step simulation step (passed to RaySensor::setLength())
+     */
+    void cast(const OdeHandle& odeHandle, long int step);
+
+    /// number of ray-geom pairs tested in the last cast()
+    int getCandidates() const { return static_cast<int>(candidates.size()); }
+
+  protected:
+    static void nearCallback(void* data, dGeomID o1, dGeomID o2);
+
+    /// spaces containing the robot of a bank (owner space up to the top-level space)
+    struct OwnerChain {
+      const RaySensorBank* bank;
+      std::vector<dSpaceID> spaces;
+      std::vector<bool> collided; ///< the inside of the space is collided
+    };
+    /// returns the chain of the bank, builds it on first use in a cast
+    const OwnerChain& chainOf(const RaySensorBank* bank);
+
+    struct Candidate {
+      dGeomID ray; ///< geom transform containing the ray
+      dGeomID geom;
+    };
+
+    const OdeHandle* odeHandle = 0;
+    std::vector<Candidate> candidates;
+    std::vector<OwnerChain> chains;
+    int usedChains = 0;
+  };
+
+}
+
+#endif
@@ -41,6 +41,9 @@ namespace lpzrobots {
 
     // if (initialized)
       //      this->odeHandle.deleteSpace(); this is automatically done if the parent space is deleted
+    // the space in the ray space has no robot space as parent
+    if (inRaySpace)
+      this->odeHandle.deleteSpace();
 
     initialized = false;
   };
@@ -49,7 +52,15 @@ namespace lpzrobots {
                                   const OsgHandle& osgHandle,
                                   const osg::Matrix& pose) {
     PhysicalSensor::setInitData(odeHandle, osgHandle, pose);
-    this->odeHandle.createNewSimpleSpace(odeHandle.space, true);
+    ownerSpace = odeHandle.space;
+    if(odeHandle.raySpace){
+      // the rays are kept out of the collision space and cast in a batch by the RayCaster
+      this->odeHandle.createNewSimpleSpace(odeHandle.raySpace, true);
+      dGeomSetData(reinterpret_cast<dGeomID>(this->odeHandle.space), this);
+      inRaySpace = true;
+    } else {
+      this->odeHandle.createNewSimpleSpace(odeHandle.space, true);
+    }
   }
 
 
@@ -88,6 +88,11 @@ namespace lpzrobots {
      */
     virtual dSpaceID getSpaceID() const;
 
+    /** returns the space the bank belongs to (the space of the odeHandle given in setInitData()).
+        The rays themselves are in a space in OdeHandle::raySpace (@see RayCaster)
+     */
+    virtual dSpaceID getOwnerSpace() const { return ownerSpace; }
+
 
     // delete all registered sensors.
     virtual void clear();
@@ -98,6 +103,8 @@ namespace lpzrobots {
   protected:
     std::vector<RaySensor*> bank;
     bool initialized = false;
+    dSpaceID ownerSpace = 0;
+    bool inRaySpace = false; ///< the rays are cast by the RayCaster
   };
 
 }
@@ -38,8 +38,18 @@ namespace lpzrobots {
   {
     int len = getSensorNumber();
     val.resize(len, 0.0);
+    cnt.resize(len, 0);
     oldangle.resize(levels, 0.0);
     setBaseInfo(SensorMotorInfo("Sound").changequantity(SensorMotorInfo::Other));
+    // sensors can be created in parallel simulations
+    double largest = largestMaxDistance.load();
+    while(maxDistance > largest && !largestMaxDistance.compare_exchange_weak(largest, maxDistance));
+  }
+
+  std::atomic<double> SoundSensor::largestMaxDistance(0);
+
+  double SoundSensor::getLargestMaxDistance(){
+    return largestMaxDistance.load();
   }
 
   SoundSensor::~SoundSensor() {
@@ -51,70 +61,114 @@ namespace lpzrobots {
   }
 
   bool SoundSensor::sense(const GlobalData& globaldata){
-    int len = getSensorNumber();
-    std::fill(val.begin(), val.end(), 0.0);
-    std::vector<int> cnt(len, 0);
+    SoundSensor* self = this;
+    senseAll(&self, 1, globaldata);
+    return true;
+  }
+
+  void SoundSensor::senseAll(SoundSensor* const* sensors, int number,
+                             const GlobalData& globaldata){
+    for(int k=0; k<number; ++k){
+      std::fill(sensors[k]->val.begin(), sensors[k]->val.end(), 0.0);
+      std::fill(sensors[k]->cnt.begin(), sensors[k]->cnt.end(), 0);
+    }
 
     if(!globaldata.sounds.empty()){
-      // multiple signal are simply averaged combined
-      FOREACHC(SoundList, globaldata.sounds, s){
-        Pos relpos = Pos(own->toLocal(s->pos));
-        // we have to look at the right dimension because sometimes the
-        // robot's coordinate system has Z not looking to the sky
-        double x = (dim == X) ? relpos.z() : relpos.x();
-        double y = (dim == Y) ? relpos.z() : relpos.y();
-
-        float dist = relpos.length();
-        // close enough and not from us.
-        if(dist<maxDistance && s->sender != static_cast<void*>(own)){
-          int l = clip(static_cast<int>(s->frequency/2.0+0.5)*levels,0,levels-1);
-          // normalise
-          double len = sqrt(x*x + y*y);
-          if(len>0){ x/=len, y/=len; }
-
-          double angle = atan2(y, x);
-          double intens = distanceDependency(*s, dist);
-          if(intens<=0) continue;
-          // add noise to angle, the more the lower the intensity maximal noisestrength*360Deg
-          angle += random_minusone_to_one()*2*M_PI*(1-pow(intens,0.25))*noisestrength;
-          intens += random_minusone_to_one()*noisestrength;
-          intens=clip(intens,0.0,1.0);
-          switch (measure){
-          case Segments:
-            {
-              int segm = clip(static_cast<int>((angle+M_PI)/(2*M_PI)*segments),0,segments-1);
-              val[segm*levels+l]= intens;
-              cnt[segm*levels+l]++;
-            }
-            break;
-          case Angle:
-            val[3*l]   += intens;
-            val[3*l+1] += sin(angle);
-            val[3*l+2] += cos(angle);
-            cnt[3*l]++; cnt[3*l+1]++; cnt[3*l+2]++;
-            break;
-          case AngleVel:
-            {   // calc derivatives of angle values
-              double d = angle - oldangle[l];
-              double scale = 10;
-              if(d>M_PI)  d-=2*M_PI;
-              if(d<-M_PI)  d+=2*M_PI;
-
-              oldangle[l]= angle;
-              val[2*l]   = intens;
-              val[2*l+1] = scale*d;
-              cnt[3*l]++; cnt[3*l+1]++;
-            }
-            break;
+      const SoundIndex& index = globaldata.soundIndex;
+      if(index.isValid(globaldata.sim_step)){
+        // region around all sensors
+        Pos lo, hi;
+        for(int k=0; k<number; ++k){
+          Pos p = sensors[k]->own->getPosition();
+          double d = sensors[k]->maxDistance;
+          for(int i=0; i<3; ++i){
+            if(k==0 || p[i]-d < lo[i]) lo[i] = p[i]-d;
+            if(k==0 || p[i]+d > hi[i]) hi[i] = p[i]+d;
+          }
+        }
+        static thread_local std::vector<int> candidates; // keeps its memory
+        candidates.clear();
+        index.query(lo, hi, candidates);
+        for(int k=0; k<number; ++k){
+          for(int i : candidates){
+            const SoundIndex::Entry& e = index[i];
+            sensors[k]->evaluate(Sound(e.time, e.pos, e.intensity, e.frequency, e.sender));
+          }
+          // sounds emitted after the index was built (by agents stepped before)
+          for(SoundList::const_iterator s = index.unindexedBegin(globaldata.sounds);
+              s != globaldata.sounds.end(); ++s)
+            sensors[k]->evaluate(*s);
+        }
+      } else {
+        for(int k=0; k<number; ++k){
+          FOREACHC(SoundList, globaldata.sounds, s){
+            sensors[k]->evaluate(*s);
           }
         }
       }
     }
+    for(int k=0; k<number; ++k)
+      sensors[k]->finish();
+  }
+
+  void SoundSensor::evaluate(const Sound& s){
+    Pos relpos = Pos(own->toLocal(s.pos));
+    // we have to look at the right dimension because sometimes the
+    // robot's coordinate system has Z not looking to the sky
+    double x = (dim == X) ? relpos.z() : relpos.x();
+    double y = (dim == Y) ? relpos.z() : relpos.y();
+
+    float dist = relpos.length();
+    // close enough and not from us.
+    if(dist<maxDistance && s.sender != static_cast<void*>(own)){
+      int l = clip(static_cast<int>(s.frequency/2.0+0.5)*levels,0,levels-1);
+      // normalise
+      double len = sqrt(x*x + y*y);
+      if(len>0){ x/=len, y/=len; }
+
+      double angle = atan2(y, x);
+      double intens = distanceDependency(s, dist);
+      if(intens<=0) return;
+      // add noise to angle, the more the lower the intensity maximal noisestrength*360Deg
+      angle += (randGen.rand()*2-1)*2*M_PI*(1-pow(intens,0.25))*noisestrength;
+      intens += (randGen.rand()*2-1)*noisestrength;
+      intens=clip(intens,0.0,1.0);
+      switch (measure){
+      case Segments:
+        {
+          int segm = clip(static_cast<int>((angle+M_PI)/(2*M_PI)*segments),0,segments-1);
+          val[segm*levels+l]= intens;
+          cnt[segm*levels+l]++;
+        }
+        break;
+      case Angle:
+        val[3*l]   += intens;
+        val[3*l+1] += sin(angle);
+        val[3*l+2] += cos(angle);
+        cnt[3*l]++; cnt[3*l+1]++; cnt[3*l+2]++;
+        break;
+      case AngleVel:
+        {   // calc derivatives of angle values
+          double d = angle - oldangle[l];
+          double scale = 10;
+          if(d>M_PI)  d-=2*M_PI;
+          if(d<-M_PI)  d+=2*M_PI;
+
+          oldangle[l]= angle;
+          val[2*l]   = intens;
+          val[2*l+1] = scale*d;
+          cnt[2*l]++; cnt[2*l+1]++;
+        }
+        break;
+      }
+    }
+  }
+
+  void SoundSensor::finish(){
+    int len = getSensorNumber();
     for(int k=0; k<len; ++k) {
       if(cnt[k]>0) val[k]/=cnt[k];
     }
-    // cnt vector automatically cleaned up
-    return true;
   }
 
   int SoundSensor::getSensorNumber() const{
@@ -25,6 +25,8 @@
 # define           SOUNDSENSOR_H_
 
 #include "sensor.h"
+#include <selforg/randomgenerator.h>
+#include <atomic>
 #include <vector>
 
 namespace lpzrobots {
@@ -57,6 +59,19 @@ namespace lpzrobots {
 
     virtual bool sense(const GlobalData& globaldata) override;
 
+    /** senses all given sound sensors in one go: the sound index of globaldata
+        (@see SoundIndex) is queried once for the region around all sensors.
+        Equivalent to calling sense() of each sensor.
+    */
+    static void senseAll(SoundSensor* const* sensors, int number, const GlobalData& globaldata);
+    static void senseAll(const std::vector<SoundSensor*>& sensors, const GlobalData& globaldata){
+      if(!sensors.empty()) senseAll(sensors.data(), static_cast<int>(sensors.size()), globaldata);
+    }
+
+    /** the largest maxDistance of all sound sensors created so far
+        (used as cell size of the SoundIndex, @see GlobalData::updateSoundIndex()) */
+    static double getLargestMaxDistance();
+
     /// default implementation is a linear decrease in intensity until it is 0 at maxDistance
     virtual float distanceDependency(const Sound& s, double distance);
 
@@ -67,6 +82,11 @@ namespace lpzrobots {
     virtual int get(sensor* sensors, int length) const override;
 
   private:
+    /// takes the sound into account if it is in range
+    void evaluate(const Sound& s);
+    /// averages the values of multiple sounds
+    void finish();
+
     short dim = 0; ///< the axis in which the sensor is selective around
     Measure measure; ///< how to measure
     int segments = 0;
@@ -75,10 +95,14 @@ namespace lpzrobots {
     double noisestrength = 0;
 
     std::vector<double> val;
+    std::vector<int> cnt; ///< number of sounds per value
     std::vector<double> oldangle;
+    RandGen randGen; ///< for the noise (own generator to be usable in parallel agents)
 
     Primitive* own;
 
+    static std::atomic<double> largestMaxDistance;
+
   };
 
 
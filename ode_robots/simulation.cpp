@@ -21,6 +21,7 @@
  *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
  *                                                                         *
  ***************************************************************************/
+#include <algorithm>
 #include <cstdlib>
 #include <csignal>
 #include <iostream>
@@ -303,6 +304,10 @@ namespace lpzrobots {
     }
     // process cmdline (possibly overwrite values from cfg file
     if(!processCmdLine(argc, argv)) return false;
+    if(globalData.odeConfig.broadPhase == OdeConfig::SAPSpace){
+      odeHandle.setTopLevelSpace(dSweepAndPruneSpaceCreate(0, dSAP_AXES_XYZ));
+      globalData.odeConfig.setOdeHandle(odeHandle);
+    }
     globalData.odeConfig.fps=defaultFPS;
 
     osgHandle.setup(windowWidth, windowHeight);
@@ -689,6 +694,8 @@ namespace lpzrobots {
          // for all agents: robots internal stuff and control step if at controlInterval
 //         PARALLEL VERSION
         if ( (globalData.sim_step % globalData.odeConfig.controlInterval ) == 0) {
+          // spatial index of the sounds for the sound sensors of all agents
+          globalData.updateSoundIndex();
           // render offscreen cameras (robot sensor cameras) (does not work in nographics mode)
           if(!noGraphics && viewer->needForOffScreenRendering()){
             QP(PROFILER.beginBlock("offScreenRendering           "));
@@ -698,23 +705,19 @@ namespace lpzrobots {
           }
 
           QP(PROFILER.beginBlock("controller                   "));
-          // QMP parallel version temporarily disabled due to compilation issues
-          if (false && useQMPThreads)
-          {
-            // PARALLEL VERSION (QMP) - DISABLED
-           } else {
-             // SEQUENTIAL VERSION(const NO& QMP)
-            // there is a problem with the useOdeThread in the loop (not static)
-            if (useOdeThread) {
-              FOREACH(OdeAgentList, globalData.agents, i) {
-                // (*i)->beforeStep(globalData); // beforeStep not available in OdeAgent
-                (*i)->step(globalData.odeConfig.noise, globalData.time); // stepOnlyWiredController doesn't exist
-              }
-            } else {
-              FOREACH(OdeAgentList, globalData.agents, i) {
-                // (*i)->beforeStep(globalData); // beforeStep not available in OdeAgent
-                (*i)->step(globalData.odeConfig.noise, globalData.time);
-              }
+          if (useQMPThreads && workerPool.getNumThreads() > 1 && globalData.agents.size() > 1) {
+            // PARALLEL VERSION: sensors and controllers of all agents in parallel,
+            //  plotting, callbacks and motor commands afterwards in agent order
+            workerPool.parallelFor(0, globalData.agents.size(), [this](std::size_t k) {
+                globalData.agents[k]->computeStep(globalData.odeConfig.noise);
+              });
+            FOREACH(OdeAgentList, globalData.agents, i) {
+              (*i)->applyStep(globalData.time);
+            }
+          } else {
+            // SEQUENTIAL VERSION
+            FOREACH(OdeAgentList, globalData.agents, i) {
+              (*i)->step(globalData.odeConfig.noise, globalData.time);
             }
           }
           QP(PROFILER.endBlock("controller                   "));
@@ -1285,6 +1288,27 @@ namespace lpzrobots {
       plotoptions.push_back(::PlotOption(::PlotMode::File, filelogginginterval, parameter, filter));
     }
 
+    // logging to binary file (-fbm: memory mapped)
+    for (bool memoryMapped : {false, true}) {
+      index = contains(argv, argc, memoryMapped ? "-fbm" : "-fb");
+      if(index) {
+        int interval=5;
+        if(argc > index)
+          interval=atoi(argv[index]);
+        if (interval<1) // no negative/zero intervals allowed
+          interval=5; // default value
+        std::string parameter="";
+        ++index;
+        std::string filter=getListOption(argc,argv,index);
+        if(!filter.empty()) index++;
+        if(index<argc && argv[index][0]!='-')
+          parameter=argv[index];
+        ::PlotOption po(::PlotMode::BinaryFile, interval, parameter, filter);
+        po.setMemoryMapped(memoryMapped);
+        plotoptions.push_back(po);
+      }
+    }
+
     // start configurator
     startConfigurator = contains(argv, argc, "-conf")!= 0;
 
@@ -1386,6 +1410,24 @@ namespace lpzrobots {
 
     useKeyHandler = contains(argv, argc, "-allkeys")!= 0;
 
+    index = contains(argv, argc, "-quickstep");
+    if(index) {
+      globalData.odeConfig.setParam("stepmethod", OdeConfig::QuickStep);
+      if(argc > index && atoi(argv[index]) > 0)
+        globalData.odeConfig.setParam("quickstepiterations", atoi(argv[index]));
+      printf("using QuickStep with %i iterations\n", globalData.odeConfig.quickStepIterations);
+    }
+    index = contains(argv, argc, "-autostep");
+    if(index) {
+      globalData.odeConfig.setParam("stepmethod", OdeConfig::AutoStep);
+      if(argc > index && atoi(argv[index]) > 0)
+        globalData.odeConfig.setParam("autostepjoints", atoi(argv[index]));
+      printf("using QuickStep above %i joints\n", globalData.odeConfig.autoStepJoints);
+    }
+    if(contains(argv, argc, "-sap")) {
+      globalData.odeConfig.setParam("broadphase", OdeConfig::SAPSpace);
+    }
+
 
     index = contains(argv, argc, "-rtf");
     if(index && (argc > index)) {
@@ -1405,23 +1447,30 @@ namespace lpzrobots {
       drawContacts=true;
     }
 
-    // initialize QuickMP with the number of processors
-    QMP_SET_NUM_THREADS(0);
+    if (contains(argv, argc, "-rawvideo")) {
+      videostream->setFormat(VideoFrameWriter::RAW);
+    }
+
+    // initialize QuickMP and the worker threads with the number of processors
+    int threads = 0;
     index = contains(argv, argc, "-threads");
     if (index) {
       if(argc > index){
-        int threads = atoi(argv[index]);
+        threads = std::max(0, atoi(argv[index]));
         if (threads==1)
-        { // if set to 1, disable use of QMP
+        { // if set to 1, disable multithreading
           useQMPThreads=false;
-          printf("Disabling QuickMP multithreading.\n");
+          printf("Disabling multithreading.\n");
         } else {
           useQMPThreads=true;
-          QMP_SET_NUM_THREADS(threads);
-          printf("Number of QuickMP threads=%i\n", QMP_GET_MAX_THREADS());
         }
       }
     }
+    QMP_SET_NUM_THREADS(threads);
+    workerPool.setNumThreads(threads);
+    globalData.workerPool = &workerPool;
+    if (index && threads != 1)
+      printf("Number of threads=%u\n", workerPool.getNumThreads());
 
     if (contains(argv, argc, "-odethread")) {
       useOdeThread=true;
@@ -1469,64 +1518,134 @@ namespace lpzrobots {
       // The collision of the geoms internal to the space(s)
       //  is done separately in odeStep() (for each space that is not ignored once)
     } else {
-      // colliding two non-space geoms, so generate contact
-      // points between o1 and o2
-      /// use the new method with substances
-      dSurfaceParameters surfParams;
+      // colliding two non-space geoms: only remember the pair,
+      // the contact points are generated in parallel in collidePairs()
+      me->collisionStats.candidatePairs++;
       // check whether ignored pair (e.g. connected by joint)
       if(me->odeHandle.isIgnoredPair(o1, o2 )) {
-        //cerr << "ign:  " << o1  << " " << o2  << "\t " << me->odeHandle.ignoredPairs->size()<< endl;
-        return;
-      }
-      //cerr << "col:  " << o1  << " " << o2  << "\t " << me->odeHandle.ignoredPairs->size()<< endl;
-      //      Primitive* p1 = static_cast<Primitive*>(dGeomGetData) (o1);
-      //      Primitive* p2 = static_cast<Primitive*>(dGeomGetData) (o2);
-      Primitive* p1 = dynamic_cast<Primitive*>(static_cast<Primitive*>(dGeomGetData(o1)));
-      Primitive* p2 = dynamic_cast<Primitive*>(static_cast<Primitive*>(dGeomGetData(o2)));
-      if(!p1 || !p2) {
-        cerr << "collision detected without primitive\n";
+        me->collisionStats.ignoredPairs++;
         return;
       }
+      me->collisionPairs.push_back(CollisionPair{o1, o2});
+    } // if geoms
+  }
 
 
-      const int N = 80;
-      dContact contact[N];
-      int n = dCollide (o1,o2,N,&contact[0].geom,sizeof(dContact));
-      if(n>0) {
-        const Substance& s1 = p1->substance;
-        const Substance& s2 = p2->substance;
-        int callbackrv = 1;
-        if(s1.callback) {
-          callbackrv = s1.callback(surfParams, me->globalData, s1.userdata, contact, n,
-                                   o1, o2, s1, s2);
-        }
-        if(s2.callback && callbackrv==1) {
-          callbackrv = s2.callback(surfParams, me->globalData, s2.userdata, contact, n,
-                                   o2, o1, s2, s1 );
-        }
-        if(callbackrv==1) {
-          Substance::getSurfaceParams(surfParams, s1,s2, me->globalData.odeConfig.simStepSize);
-          //Substance::printSurfaceParams(surfParams);
-        }
-        if(callbackrv== 0)
-          return;
-        for (int i=0; i < n; ++i) {
-          contact[i].surface = surfParams;
-          dJointID c = dJointCreateContact (me->odeHandle.world,
-                                            me->odeHandle.jointGroup,&contact[i]);
-          dJointAttach ( c , dGeomGetBody(contact[i].geom.g1) , dGeomGetBody(contact[i].geom.g2));
+  namespace {
+    const int maxContactsPerPair = 80;
+    const std::size_t pairsPerTask = 16;
+
+    /* trimeshes and heightfields keep collision caches in the geom and
+       dCollideTransform temporarily moves the encapsulated geom to the pose
+       of the transform, so these must not be collided by several threads at
+       the same time */
+    bool needsSerialCollide(dGeomID o1, dGeomID o2) {
+      const int c1 = dGeomGetClass(o1);
+      const int c2 = dGeomGetClass(o2);
+      return c1 == dTriMeshClass || c2 == dTriMeshClass ||
+        c1 == dHeightfieldClass || c2 == dHeightfieldClass ||
+        c1 == dGeomTransformClass || c2 == dGeomTransformClass;
+    }
+  }
+
+  void Simulation::collidePairs() {
+    const std::size_t numPairs = collisionPairs.size();
+    const std::size_t chunks = (numPairs + pairsPerTask - 1) / pairsPerTask;
+    if (contactBuffers.size() < chunks)
+      contactBuffers.resize(chunks);
+    contactCounts.resize(numPairs);
+    contactOffsets.resize(numPairs);
+
+    // narrow phase: each chunk of pairs writes into its own buffer
+    workerPool.parallelFor(0, chunks, [this, numPairs](std::size_t c) {
+        static thread_local bool odeThreadData = false;
+        if (!odeThreadData) { // collision caches of ODE are per thread
+          dAllocateODEDataForThread(dAllocateMaskAll);
+          odeThreadData = true;
         }
-        if(me->drawContacts){
-          for (int i=0; i < n; ++i) {
-            me->globalData.addTmpObject(new TmpPrimitive(new Box(0.02f,0.02f,0.02f),
-                                                         'g', 0,
-                                                         TRANSM(Pos(contact[i].geom.pos)),
-                                                         Color(1.0,0,0)),
-                                        0.5);
+        std::vector<dContactGeom>& buffer = contactBuffers[c];
+        buffer.clear();
+        dContactGeom geoms[maxContactsPerPair];
+        const std::size_t end = std::min(numPairs, (c + 1) * pairsPerTask);
+        for (std::size_t k = c * pairsPerTask; k < end; ++k) {
+          const CollisionPair& p = collisionPairs[k];
+          contactOffsets[k] = buffer.size();
+          if (needsSerialCollide(p.o1, p.o2)) {
+            contactCounts[k] = -1;
+            continue;
           }
+          const int n = dCollide(p.o1, p.o2, maxContactsPerPair, geoms, sizeof(dContactGeom));
+          contactCounts[k] = n;
+          buffer.insert(buffer.end(), geoms, geoms + n);
         }
-      } // if contact points
-    } // if geoms
+      });
+
+    // merge: contact joints are created in the order of the broad phase,
+    //  so the result does not depend on the number of threads
+    dContactGeom serialGeoms[maxContactsPerPair];
+    for (std::size_t k = 0; k < numPairs; ++k) {
+      const CollisionPair& p = collisionPairs[k];
+      int n = contactCounts[k];
+      dContactGeom* geoms = serialGeoms;
+      if (n < 0)
+        n = dCollide(p.o1, p.o2, maxContactsPerPair, serialGeoms, sizeof(dContactGeom));
+      else if (n > 0)
+        geoms = &contactBuffers[k / pairsPerTask][contactOffsets[k]];
+      if (n > 0) {
+        collisionStats.touchingPairs++;
+        createContacts(p.o1, p.o2, geoms, n);
+      }
+    }
+    collisionPairs.clear();
+  }
+
+  void Simulation::createContacts(dGeomID o1, dGeomID o2, dContactGeom* geoms, int n) {
+    /// use the new method with substances
+    dSurfaceParameters surfParams;
+    Primitive* p1 = dynamic_cast<Primitive*>(static_cast<Primitive*>(dGeomGetData(o1)));
+    Primitive* p2 = dynamic_cast<Primitive*>(static_cast<Primitive*>(dGeomGetData(o2)));
+    if(!p1 || !p2) {
+      cerr << "collision detected without primitive\n";
+      return;
+    }
+
+    dContact contact[maxContactsPerPair];
+    for (int i=0; i < n; ++i) {
+      contact[i].geom = geoms[i];
+    }
+    const Substance& s1 = p1->substance;
+    const Substance& s2 = p2->substance;
+    int callbackrv = 1;
+    if(s1.callback) {
+      callbackrv = s1.callback(surfParams, globalData, s1.userdata, contact, n,
+                               o1, o2, s1, s2);
+    }
+    if(s2.callback && callbackrv==1) {
+      callbackrv = s2.callback(surfParams, globalData, s2.userdata, contact, n,
+                               o2, o1, s2, s1 );
+    }
+    if(callbackrv==1) {
+      Substance::getSurfaceParams(surfParams, s1,s2, globalData.odeConfig.simStepSize);
+      //Substance::printSurfaceParams(surfParams);
+    }
+    if(callbackrv== 0)
+      return;
+    contactJoints += n;
+    for (int i=0; i < n; ++i) {
+      contact[i].surface = surfParams;
+      dJointID c = dJointCreateContact (odeHandle.world,
+                                        odeHandle.jointGroup,&contact[i]);
+      dJointAttach ( c , dGeomGetBody(contact[i].geom.g1) , dGeomGetBody(contact[i].geom.g2));
+    }
+    if(drawContacts){
+      for (int i=0; i < n; ++i) {
+        globalData.addTmpObject(new TmpPrimitive(new Box(0.02f,0.02f,0.02f),
+                                                 'g', 0,
+                                                 TRANSM(Pos(contact[i].geom.pos)),
+                                                 Color(1.0,0,0)),
+                                0.5);
+      }
+    }
   }
 
 
@@ -1609,15 +1728,18 @@ namespace lpzrobots {
 
 
   void Simulation::main_usage(const char* progname) {
-    printf("Usage: %s [-f [interval] [filter] [name]] [-{g|m} [interval] [filter]]\n", progname);
-    printf("    \t [-r seed] [-x WxH] [-fs] [-allkeys] [-video NAME]\n");
+    printf("Usage: %s [-{f|fb|fbm} [interval] [filter] [name]] [-{g|m} [interval] [filter]]\n", progname);
+    printf("    \t [-r seed] [-x WxH] [-fs] [-allkeys] [-video NAME] [-rawvideo]\n");
     printf("    \t [-pause] [-shadow N] [-noshadow] [-drawboundings] [-simtime [min]] [-rtf X]\n");
+    printf("    \t [-quickstep [N]] [-autostep [J]] [-sap]\n");
     printf("    \t [-threads N] [-odethread] [-osgthread] [-savecfg] [-set keyvaluespairs] [-h|--help] ...\n");
     printf("    -conf\t\tuse Configurator\n");
     printf("    -g interval filter\t\tuse guilogger (default interval 1)\n");
     printf("    \t\t filter: \"{+substr -substr}\"\n");
     printf("    -f interval filter name\twrite logging file (default interval 5),\n");
     printf("    \t\t\tname: instead of the timestamp the name is attached to logfile name\n");
+    printf("    -fb interval filter name\twrite binary logging file (.blog), see binlog2log.pl\n");
+    printf("    -fbm interval filter name\tas -fb but using a memory mapped file\n");
     printf("    -m interval  filter\t\tuse matrixviz (default interval 10)\n");
     printf("    -s \"-disc|ampl|freq val\"\n    \t\t\tuse soundMan \n");
     printf("    -r seed\t\trandom number seed\n");
@@ -1644,7 +1766,11 @@ namespace lpzrobots {
     printf("    -drawcontacts\tenables the drawing of the contact points for collision detection\n");
     printf("    -simtime min\tlimited simulation time in minutes\n");
     printf("    -video NAME\tstart video recording with given name\n");
+    printf("    -rawvideo\t\trecord the video uncompressed into one file (frame.ppm)\n");
     printf("    -savecfg\t\tsafe the configuration file with the values given by the cmd line\n");
+    printf("    -quickstep [N]\titerative physics solver (QuickStep) with N iterations (default 20)\n");
+    printf("    -autostep [J]\tQuickStep if more than J joints are active (default 200)\n");
+    printf("    -sap\t\tpersistent sweep and prune as top-level collision space (instead of hash space)\n");
     printf("    -threads N\t\tnumber of threads to use (0: number of processors (default))\n");
     printf("    -odethread\t\t* if given the ODE runs in its own thread. -> Sensors are delayed by 1\n");
     printf("    -osgthread\t\t* if given the OSG runs in its own thread (recommended)\n");
@@ -1711,18 +1837,29 @@ namespace lpzrobots {
   void Simulation::odeStep() {
 
     QP(PROFILER.beginBlock("collision                    "));
-    // for parallelising the collision detection
-    // we would need distinct jointgroups for each thread
-    // also the most time is required by the global collision callback which is one block
-    // so it makes no sense to is quickmp here
+    contactJoints = 0;
+    // broad phase (serial): collects the candidate pairs
     dSpaceCollide ( odeHandle.space , this , &nearCallback_TopLevel );
     FOREACHC(vector<dSpaceID>, odeHandle.getSpaces(), i) {
       dSpaceCollide ( *i , this , &nearCallback );
     }
+    // narrow phase (parallel) and creation of the contact joints
+    collidePairs();
+    // rays of the ray sensor banks in one batch
+    rayCaster.cast(odeHandle, globalData.sim_step);
     QP(PROFILER.endBlock("collision                    "));
 
     QP(PROFILER.beginBlock("ODEstep                      "));
-    dWorldStep ( odeHandle.world , globalData.odeConfig.simStepSize );
+    int activeJoints = contactJoints;
+    if (globalData.odeConfig.stepMethod == OdeConfig::AutoStep) {
+      FOREACH(OdeAgentList, globalData.agents, i) {
+        activeJoints += (*i)->getRobot()->getAllJoints().size();
+      }
+    }
+    if (globalData.odeConfig.useQuickStep(activeJoints))
+      dWorldQuickStep ( odeHandle.world , globalData.odeConfig.simStepSize );
+    else
+      dWorldStep ( odeHandle.world , globalData.odeConfig.simStepSize );
     dJointGroupEmpty (odeHandle.jointGroup);
     QP(PROFILER.endBlock("ODEstep                      "));
   }
@@ -33,8 +33,10 @@
 #include <list>
 #include <vector>
 #include <string>
+#include <selforg/workstealingpool.h>
 #include "utils/globaldata.h"
 #include "osg/base.h"
+#include "raycaster.h"
 
 // forward declarations
 namespace osgViewer {
@@ -171,6 +173,14 @@ namespace lpzrobots {
     /// returns the watched agent (or 0)
     const OdeAgent* getWatchedAgent() const;
 
+    /// statistics of the collision detection (summed up since the start)
+    struct CollisionStats {
+      unsigned long candidatePairs = 0; ///< pairs of geoms reported by the broad phase
+      unsigned long ignoredPairs = 0;   ///< candidates rejected as ignored pairs
+      unsigned long touchingPairs = 0;  ///< candidates with contact points
+    };
+    const CollisionStats& getCollisionStats() const { return collisionStats; }
+
     static void nearCallback_TopLevel(void *data, dGeomID o1, dGeomID o2);
     static void nearCallback(void *data, dGeomID o1, dGeomID o2);
     bool control_c_pressed();
@@ -256,7 +266,7 @@ namespace lpzrobots {
 
     bool useOdeThread;
     bool useOsgThread;
-    bool useQMPThreads; // decides if quick mp is used in this simulation
+    bool useQMPThreads; // decides if the agents are stepped in parallel (see workerPool)
     bool inTaskedMode;
 
     std::string windowName;
@@ -283,6 +293,29 @@ namespace lpzrobots {
     pthread_t osgThread;
     bool odeThreadCreated = false;
     bool osgThreadCreated = false;
+    /// persistent threads for the parallel agent steps and collisions (-threads N)
+    WorkStealingPool workerPool;
+
+    /** computes the contacts of all candidate pairs of the broad phase in parallel
+        and creates the contact joints in the order of the pairs */
+    void collidePairs();
+    /// handles the substances and creates the contact joints for one pair of geoms
+    void createContacts(dGeomID o1, dGeomID o2, dContactGeom* geoms, int n);
+
+    /// candidate pair of geoms found by the broad phase (nearCallback)
+    struct CollisionPair {
+      dGeomID o1;
+      dGeomID o2;
+    };
+    std::vector<CollisionPair> collisionPairs;
+    /// contacts of the pairs: every chunk of pairs has its own buffer
+    std::vector<std::vector<dContactGeom> > contactBuffers;
+    std::vector<int> contactCounts;           // per pair, -1: collided in the merge
+    std::vector<unsigned int> contactOffsets; // per pair, index into the buffer of its chunk
+    int contactJoints = 0; // number of contact joints created in the current step
+    CollisionStats collisionStats;
+    /// casts the rays of all ray sensor banks (they are not in the collision space)
+    RayCaster rayCaster;
 
   private:
     bool commandline_param_dummy = false;
@@ -0,0 +1,118 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Robot Group Leipzig                             *
+ *    martius@informatik.uni-leipzig.de                                    *
+ *    fhesse@informatik.uni-leipzig.de                                     *
+ *    der@informatik.uni-leipzig.de                                        *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ *                                                                         *
+ *                                                                         *
+ *   Benchmark of the collision filter: many robots with many segments     *
+ *   (snakes and hexapods). Prints how many candidate pairs reach the      *
+ *   collision callback, how many of them are still rejected as ignored    *
+ *   pairs there (the others are culled by the category bits) and how      *
+ *   many touch.                                                           *
+ *   Run e.g. with: ./start -nographics -simtime 2 -threads 1             *
+ *                                                                         *
+ ***************************************************************************/
+#include <cstdio>
+
+#include <ode_robots/simulation.h>
+#include <ode_robots/odeagent.h>
+#include <ode_robots/playground.h>
+
+#include <selforg/one2onewiring.h>
+#include <selforg/sox.h>
+#include <selforg/noisegenerator.h>
+
+#include <ode_robots/schlangeservo2.h>
+#include <ode_robots/hexapod.h>
+
+using namespace lpzrobots;
+using namespace std;
+
+class ThisSim : public Simulation {
+public:
+  int numSnakes   = 8;
+  int numHexapods = 8;
+
+  void start(const OdeHandle& odeHandle, const OsgHandle& osgHandle, GlobalData& global) override
+  {
+    setCameraHomePos(Pos(-19.0, 17.0, 12.0),  Pos(-135.0, -25.0, 0));
+    global.odeConfig.setParam("noise", 0.05);
+
+    Playground* playground = new Playground(odeHandle, osgHandle, osg::Vec3(20, 0.2, 1.0));
+    playground->setPosition(osg::Vec3(0,0,0.05));
+    global.obstacles.push_back(playground);
+
+    for(int i=0; i < numSnakes; ++i){
+      SchlangeConf conf = SchlangeServo2::getDefaultConf();
+      conf.segmNumber   = 20;
+      conf.motorPower   = 5;
+      OdeRobot* robot = new SchlangeServo2(odeHandle, osgHandle.changeColorSet(i),
+                                           conf, "Snake_" + itos(i));
+      robot->place(osg::Matrix::translate(-6 + 1.5*i, -4, 0.3));
+      addAgent(global, robot, new Sox(1.2));
+    }
+    for(int i=0; i < numHexapods; ++i){
+      HexapodConf conf = Hexapod::getDefaultConf();
+      conf.tarsus            = true;
+      conf.numTarsusSections = 2;
+      conf.useTarsusJoints   = true;
+      OdeRobot* robot = new Hexapod(odeHandle, osgHandle.changeColorSet(i),
+                                    conf, "Hexapod_" + itos(i));
+      robot->place(osg::Matrix::translate(-6 + 1.5*i, 4, 0.5));
+      addAgent(global, robot, new Sox(1.2, false));
+    }
+  }
+
+  void addAgent(GlobalData& global, OdeRobot* robot, AbstractController* controller){
+    OdeAgent* agent = new OdeAgent(global, PlotOption(NoPlot));
+    agent->init(controller, robot, new One2OneWiring(new ColorUniformNoise(0.1)));
+    global.agents.push_back(agent);
+    global.configs.push_back(agent);
+  }
+
+  void addCallback(const GlobalData& global, bool draw, bool pause, bool control) override {
+    if(global.sim_step % 1000 == 0)
+      printStats(global);
+  }
+
+  void end(const GlobalData& global) override {
+    printf("total ");
+    printStats(global);
+  }
+
+  void printStats(const GlobalData& global) {
+    const CollisionStats& s = getCollisionStats();
+    if(s.candidatePairs == 0 || global.sim_step == 0) return;
+    printf("step %li: candidates %lu (%.0f per step), ignored %lu (%.1f%%), "
+           "touching %lu (%.1f%%), narrow phase rejection %.1f%%\n",
+           global.sim_step, s.candidatePairs,
+           double(s.candidatePairs) / global.sim_step,
+           s.ignoredPairs, 100.0 * s.ignoredPairs / s.candidatePairs,
+           s.touchingPairs, 100.0 * s.touchingPairs / s.candidatePairs,
+           100.0 * (s.candidatePairs - s.ignoredPairs - s.touchingPairs)
+           / max(1ul, s.candidatePairs - s.ignoredPairs));
+  }
+};
+
+
+int main (int argc, char **argv)
+{
+  ThisSim sim;
+  return sim.run(argc, argv) ? 0 : 1;
+}
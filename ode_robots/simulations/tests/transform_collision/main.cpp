@@ -0,0 +1,128 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by Robot Group Leipzig                             *
+ *    martius@informatik.uni-leipzig.de                                    *
+ *    fhesse@informatik.uni-leipzig.de                                     *
+ *    der@informatik.uni-leipzig.de                                        *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ *                                                                         *
+ *                                                                         *
+ *   Test of the parallel narrow phase with a Transform geom: a plate      *
+ *   (Transform of a Box) is collided against many spheres at once         *
+ *   through collidePairs(). The contacts must match a serial dCollide     *
+ *   and the encapsulated geom must be restored afterwards.               *
+ *   Run e.g. with: ./start -nographics -simtime 1 -threads 4             *
+ *                                                                         *
+ ***************************************************************************/
+#include <cstdio>
+
+#include <ode_robots/simulation.h>
+#include <ode_robots/primitive.h>
+#include <ode_robots/passivesphere.h>
+
+using namespace lpzrobots;
+using namespace std;
+
+class ThisSim : public Simulation {
+public:
+  Primitive* body  = nullptr;
+  Primitive* plate = nullptr;
+  vector<PassiveSphere*> spheres;
+  long checkedSteps = 0;
+  long errors = 0;
+
+  void start(const OdeHandle& odeHandle, const OsgHandle& osgHandle, GlobalData& global) override
+  {
+    setCameraHomePos(Pos(-5.0, 5.0, 4.0),  Pos(-135.0, -25.0, 0));
+    global.odeConfig.setParam("noise", 0);
+    // the narrow phase must run on several threads for this test
+    if(workerPool.getNumThreads() < 2)
+      workerPool.setNumThreads(4);
+
+    body = new Box(0.2, 0.2, 0.2);
+    body->init(odeHandle, 1, osgHandle);
+    body->setPosition(Pos(0, 0, 1));
+    // the plate is a transform of a box fixed below the body
+    plate = new Transform(body, new Box(4, 4, 0.1), osg::Matrix::translate(0, 0, -0.15));
+    plate->init(odeHandle, 5, osgHandle);
+
+    // spheres slightly penetrating the top of the plate (at z = 0.9)
+    for(int i=0; i < 10; ++i){
+      for(int j=0; j < 10; ++j){
+        PassiveSphere* s = new PassiveSphere(odeHandle, osgHandle.changeColor(Color(1,1,0)), 0.1, 0.1);
+        s->setPosition(Pos(-1.6 + 0.35*i, -1.6 + 0.35*j, 0.99));
+        global.obstacles.push_back(s);
+        spheres.push_back(s);
+      }
+    }
+  }
+
+  void addCallback(const GlobalData& global, bool draw, bool pause, bool control) override {
+    if(!plate) return;
+    dGeomID t = plate->getGeom();
+    dGeomID child = dGeomTransformGetGeom(t);
+    const dReal* childPos = dGeomGetPosition(child);
+    dVector3 childPosBefore = { childPos[0], childPos[1], childPos[2] };
+
+    // every sphere several times and on both sides of the pair,
+    //  so that the same transform is collided in all chunks
+    dContactGeom geoms[16];
+    int expected = 0;
+    for(int r=0; r < 4; ++r){
+      for(PassiveSphere* s : spheres){
+        dGeomID o = s->getMainPrimitive()->getGeom();
+        if(r % 2 == 0){
+          expected += dCollide(t, o, 16, geoms, sizeof(dContactGeom));
+          collisionPairs.push_back(CollisionPair{t, o});
+        } else {
+          expected += dCollide(o, t, 16, geoms, sizeof(dContactGeom));
+          collisionPairs.push_back(CollisionPair{o, t});
+        }
+      }
+    }
+    contactJoints = 0;
+    collidePairs();
+    // remove our contact joints again (the group is empty before the step)
+    dJointGroupEmpty(odeHandle.jointGroup);
+
+    childPos = dGeomGetPosition(child);
+    bool restored = dGeomGetBody(child) == 0 && childPos[0] == childPosBefore[0] &&
+      childPos[1] == childPosBefore[1] && childPos[2] == childPosBefore[2];
+    if(contactJoints != expected || !restored){
+      printf("step %li: %i contacts (expected %i), encapsulated geom %s\n",
+             global.sim_step, contactJoints, expected, restored ? "restored" : "NOT restored");
+      errors++;
+    }
+    checkedSteps++;
+  }
+
+  void end(const GlobalData& global) override {
+    printf("transform collisions with %u threads: %li steps checked, %li errors\n",
+           workerPool.getNumThreads(), checkedSteps, errors);
+    delete plate;
+    delete body;
+    plate = nullptr;
+    body  = nullptr;
+  }
+};
+
+
+int main (int argc, char **argv)
+{
+  ThisSim sim;
+  return sim.run(argc, argv) ? 0 : 1;
+}
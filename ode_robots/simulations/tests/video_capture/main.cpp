@@ -0,0 +1,154 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2011 LpzRobots development team                    *
+ *    Georg Martius  <georg dot martius at web dot de>                     *
+ *    Frank Guettler <guettler at informatik dot uni-leipzig dot de        *
+ *    Frank Hesse    <frank at nld dot ds dot mpg dot de>                  *
+ *    Ralf Der       <ralfder at mis dot mpg dot de>                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ *                                                                         *
+ ***************************************************************************/
+
+// Headless test of the video frame pipeline (VideoFrameWriter): no window or
+//  OpenGL context is needed. Frames with a known pattern are written into a raw
+//  file (read back and compared) and as jpg files (checked for existence).
+//  Usage: ./start [directory]   (default /tmp), returns 0 on success
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <ode_robots/grabframe.h>
+
+using namespace std;
+using namespace lpzrobots;
+
+static const int W = 101; // odd width: rows are not 4 byte aligned
+static const int H = 37;
+
+static unsigned char pattern(int frame, int x, int y, int c){
+  return static_cast<unsigned char>(frame*7 + y*3 + x*3 + c);
+}
+
+static unique_ptr<VideoFrameWriter::Frame> makeFrame(VideoFrameWriter& writer, int frame){
+  unique_ptr<VideoFrameWriter::Frame> f = writer.getFrame();
+  f->width = W;
+  f->height = H;
+  f->index = frame;
+  f->pixels.resize(W*H*3);
+  for(int y=0; y<H; ++y)
+    for(int x=0; x<W; ++x)
+      for(int c=0; c<3; ++c)
+        f->pixels[(y*W + x)*3 + c] = pattern(frame, x, y, c);
+  return f;
+}
+
+/// writes n frames into a raw file (dropping every 7th) and checks the file
+static int testRaw(const string& dir, int threads, int n){
+  int errors = 0;
+  string name = dir + "/video_capture_test.ppm";
+  vector<int> expected;
+  {
+    VideoFrameWriter writer(threads, 3);
+    shared_ptr<VideoFrameWriter::RawFile> raw = VideoFrameWriter::openRawFile(name);
+    if(!raw){ fprintf(stderr, "cannot open %s\n", name.c_str()); return 1; }
+    for(int k=0; k<n; ++k){
+      unique_ptr<VideoFrameWriter::Frame> f = makeFrame(writer, k);
+      f->raw = raw;
+      if(k % 7 == 3) {
+        writer.drop(std::move(f)); // must not block the following frames
+      } else {
+        writer.write(std::move(f));
+        expected.push_back(k);
+      }
+    }
+    raw.reset();
+    writer.flush();
+    if(writer.checkFailure()) { fprintf(stderr, "raw: write failure\n"); ++errors; }
+  }
+  FILE* f = fopen(name.c_str(), "rb");
+  if(!f){ fprintf(stderr, "cannot read %s\n", name.c_str()); return errors+1; }
+  int w, h, maxval;
+  size_t k = 0;
+  vector<unsigned char> row(W*3);
+  while(fscanf(f, "P6\n%d %d\n%d", &w, &h, &maxval) == 3){
+    fgetc(f);
+    if(w != W || h != H || k >= expected.size()) { ++errors; break; }
+    for(int y=H-1; y>=0; --y){ // PPM starts with the top row
+      if(fread(row.data(), row.size(), 1, f) != 1) { ++errors; break; }
+      for(int x=0; x<W; ++x)
+        for(int c=0; c<3; ++c)
+          if(row[x*3+c] != pattern(expected[k], x, y, c)) { ++errors; y=-1; x=W; break; }
+    }
+    ++k;
+  }
+  fclose(f);
+  remove(name.c_str());
+  if(k != expected.size()) ++errors;
+  printf("raw (%i threads): %zu of %zu frames, %s\n", threads, k, expected.size(),
+         errors ? "FAILED" : "ok");
+  return errors;
+}
+
+/// writes n jpg files and checks that they exist and are not empty
+static int testJpeg(const string& dir, int threads, int n){
+  int errors = 0;
+  {
+    VideoFrameWriter writer(threads);
+    for(int k=0; k<n; ++k){
+      unique_ptr<VideoFrameWriter::Frame> f = makeFrame(writer, k);
+      char name[1024];
+      snprintf(name, sizeof(name), "%s/video_capture_test_%06i.jpg", dir.c_str(), k);
+      f->filename = name;
+      writer.write(std::move(f));
+    }
+  } // the destructor writes all queued frames
+  for(int k=0; k<n; ++k){
+    char name[1024];
+    snprintf(name, sizeof(name), "%s/video_capture_test_%06i.jpg", dir.c_str(), k);
+    FILE* f = fopen(name, "rb");
+    if(!f || fseek(f, 0, SEEK_END) != 0 || ftell(f) <= 0) ++errors;
+    if(f) fclose(f);
+    remove(name);
+  }
+  printf("jpg (%i threads): %i frames, %s\n", threads, n, errors ? "FAILED" : "ok");
+  return errors;
+}
+
+/// a failing frame is reported by checkFailure()
+static int testFailure(){
+  VideoFrameWriter writer(1);
+  unique_ptr<VideoFrameWriter::Frame> f = makeFrame(writer, 0);
+  f->filename = "/nonexisting/directory/frame.jpg";
+  writer.write(std::move(f));
+  writer.flush();
+  bool failed = writer.checkFailure();
+  printf("failure detection: %s\n", failed ? "ok" : "FAILED");
+  return failed ? 0 : 1;
+}
+
+int main (int argc, char **argv)
+{
+  string dir = argc > 1 ? argv[1] : "/tmp";
+  int errors = 0;
+  errors += testRaw(dir, 1, 100);
+  errors += testRaw(dir, 4, 300);
+  errors += testJpeg(dir, 4, 20);
+  errors += testFailure();
+  printf("%s\n", errors ? "FAILED" : "all tests passed");
+  return errors ? 1 : 0;
+}
@@ -0,0 +1,32 @@
+#!/usr/bin/perl -w
+
+# converts a binary log file (-fb option, PlotMode BinaryFile) into a normal log file
+# (see also PlotOption::convertBinaryLog)
+
+if (scalar @ARGV > 1 || (scalar @ARGV == 1 && $ARGV[0] =~ /^-/)) {
+    print "Usage: binlog2log.pl [binlogfile] > logfile \n";
+    print "\t reads from stdin if no file is given\n";
+    exit;
+}
+my $in = \*STDIN;
+if (scalar @ARGV == 1) {
+    open($in, "<", $ARGV[0]) or die "cannot open $ARGV[0]: $!\n";
+}
+binmode($in);
+my $channels = 0;
+while (my $line = <$in>) {
+    if ($line =~ /^#B\s+(\S+)\s+(\S+)\s+(\d+)/) {
+        die "unsupported value type $1\n" if $1 ne "float64";
+        my $host = unpack("C", pack("S", 1)) == 1 ? "le" : "be";
+        die "byte order $2 of the file is not supported\n" if $2 ne $host;
+        $channels = $3;
+        last;
+    }
+    print $line; # comment lines
+}
+die "no binary records found\n" if $channels < 1;
+my $size = 8 * $channels;
+my $record;
+while (read($in, $record, $size) == $size) {
+    print join(" ", map { sprintf("%f", $_) } unpack("d$channels", $record)) . "\n";
+}
@@ -25,6 +25,7 @@
 #include <algorithm>
 #include "odeagent.h"
 #include "osgprimitive.h"
+#include "soundsensor.h"
 
 namespace lpzrobots {
 
@@ -90,8 +91,17 @@ namespace lpzrobots {
     }
 
     // remove old signals from sound list
-    if(!sounds.empty())
+    if(!sounds.empty()){
       sounds.remove_if(Sound::older_than(time));
+      soundIndex.invalidate();
+    }
+  }
+
+  void GlobalData::updateSoundIndex(){
+    // with cells of the size of the sensor range a query visits only a few cells
+    double range = SoundSensor::getLargestMaxDistance();
+    if(range > 0) soundIndex.setCellSize(range);
+    soundIndex.build(sounds, sim_step);
   }
 
 
@@ -30,11 +30,14 @@
 #include "odehandle.h"
 #include "odeconfig.h"
 #include "sound.h"
+#include "soundindex.h"
 #include "tmpobject.h"
 #include <selforg/plotoption.h>
 #include <selforg/globaldatabase.h>
 #include <selforg/backcallervector.h>
 
+class WorkStealingPool;
+
 namespace lpzrobots {
 
   class OdeAgent;
@@ -68,6 +71,10 @@ namespace lpzrobots {
 
       // Todo: the sound visualization could be done with the new TmpObjects
       SoundList sounds; ///< sound space
+      SoundIndex soundIndex; ///< spatial hash of the sounds, @see updateSoundIndex()
+
+      /// thread pool of the simulation for sensors with data parallel work (may be 0)
+      WorkStealingPool* workerPool = nullptr;
 
       PlotOptionList plotoptions; ///< plotoptions used for new agents
       std::list<::Configurable*> globalconfigurables; ///< global configurables plotted by all agents
@@ -93,6 +100,10 @@ namespace lpzrobots {
       */
       virtual void removeExpiredObjects(double time = -1);
 
+      /** called by Simulation before the sensors are read to rebuild
+          the spatial index of the sounds (soundIndex) */
+      virtual void updateSoundIndex();
+
       /** removes a particular temporary display item even if it is not yet expired
           @return true if it was deleted (found) */
       virtual bool removeTmpObject(TmpObject* i);
@@ -21,15 +21,167 @@
  *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
  *                                                                         *
  ***************************************************************************/
+#include <algorithm>
 #include <cassert>
 #include <cstdio>
-// #include <cstring>
+#include <cstring>
+#include <osg/Version>
+#include <osg/BufferObject>
+#if OSG_VERSION_GREATER_OR_EQUAL(3,4,0)
+#include <osg/GLExtensions>
+#endif
 #include <osgDB/WriteFile>
 #include "grabframe.h"
 
 namespace lpzrobots {
 
-  // bool getGLFrameBuffer( unsigned char *buf, int w, int h);
+  /************************ VideoFrameWriter ******************************/
+
+  struct VideoFrameWriter::RawFile {
+    FILE* file = nullptr;
+    std::mutex mutex;
+    std::condition_variable written;
+    long int next = 0; // the frames are appended in the order of their index
+    std::vector<long int> dropped; // frames after next that will not come
+    ~RawFile() { if(file) fclose(file); }
+    /// the frame next is done, skips the dropped ones (call with mutex locked)
+    void advance() {
+      ++next;
+      std::vector<long int>::iterator d;
+      while((d = std::find(dropped.begin(), dropped.end(), next)) != dropped.end()){
+        dropped.erase(d);
+        ++next;
+      }
+      written.notify_all();
+    }
+  };
+
+  VideoFrameWriter::VideoFrameWriter(unsigned int threads, size_t queueSize)
+    : numThreads(threads), queueSize(std::max<size_t>(queueSize, 1)) {
+    if(numThreads == 0) {
+      unsigned int n = std::thread::hardware_concurrency();
+      numThreads = n > 2 ? n - 1 : 1;
+    }
+  }
+
+  VideoFrameWriter::~VideoFrameWriter(){
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    queued.notify_all();
+    for(auto& t : threads) t.join(); // the queue is emptied before the threads stop
+  }
+
+  std::shared_ptr<VideoFrameWriter::RawFile> VideoFrameWriter::openRawFile(const std::string& filename){
+    std::shared_ptr<RawFile> raw = std::make_shared<RawFile>();
+    raw->file = fopen(filename.c_str(), "wb");
+    if(!raw->file) return std::shared_ptr<RawFile>();
+    return raw;
+  }
+
+  std::unique_ptr<VideoFrameWriter::Frame> VideoFrameWriter::getFrame(){
+    std::lock_guard<std::mutex> lock(mutex);
+    if(unused.empty()) return std::unique_ptr<Frame>(new Frame());
+    std::unique_ptr<Frame> f = std::move(unused.back());
+    unused.pop_back();
+    return f;
+  }
+
+  void VideoFrameWriter::write(std::unique_ptr<Frame> frame){
+    std::unique_lock<std::mutex> lock(mutex);
+    if(threads.empty()) start(); // threads are only created if something is recorded
+    finished.wait(lock, [this]{ return queue.size() < queueSize; });
+    queue.push_back(std::move(frame));
+    lock.unlock();
+    queued.notify_one();
+  }
+
+  void VideoFrameWriter::drop(std::unique_ptr<Frame> frame){
+    std::shared_ptr<RawFile> raw = std::move(frame->raw); // keeps the file until unlocked
+    if(raw){
+      std::lock_guard<std::mutex> lock(raw->mutex);
+      if(raw->next == frame->index) raw->advance();
+      else raw->dropped.push_back(frame->index);
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    unused.push_back(std::move(frame));
+  }
+
+  void VideoFrameWriter::flush(){
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this]{ return queue.empty() && busy == 0; });
+  }
+
+  bool VideoFrameWriter::checkFailure(){
+    std::lock_guard<std::mutex> lock(mutex);
+    bool f = failed;
+    failed = false;
+    return f;
+  }
+
+  void VideoFrameWriter::start(){
+    for(unsigned int i=0; i<numThreads; ++i)
+      threads.emplace_back(&VideoFrameWriter::run, this);
+  }
+
+  void VideoFrameWriter::run(){
+    std::unique_lock<std::mutex> lock(mutex);
+    while(true){
+      queued.wait(lock, [this]{ return !queue.empty() || stopping; });
+      if(queue.empty()) return; // stopping
+      std::unique_ptr<Frame> f = std::move(queue.front());
+      queue.pop_front();
+      ++busy;
+      finished.notify_all(); // space in the queue
+      lock.unlock();
+      bool ok = writeFrame(*f);
+      f->raw.reset();
+      lock.lock();
+      if(!ok) failed = true;
+      unused.push_back(std::move(f));
+      --busy;
+      finished.notify_all();
+    }
+  }
+
+  bool VideoFrameWriter::writeFrame(const Frame& f){
+    const int rowSize = f.width * 3;
+    if(f.raw){
+      RawFile& raw = *f.raw;
+      // the frames are taken in order from the queue, so the one we wait for is in work
+      std::unique_lock<std::mutex> lock(raw.mutex);
+      raw.written.wait(lock, [&]{ return raw.next == f.index; });
+      bool ok = fprintf(raw.file, "P6\n%i %i\n255\n", f.width, f.height) > 0;
+      for(int y = f.height - 1; y >= 0 && ok; --y) // PPM starts with the top row
+        ok = fwrite(f.pixels.data() + y * rowSize, rowSize, 1, raw.file) == 1;
+      raw.advance();
+      if(!ok) fprintf(stderr, "VideoStream: Cannot write frame %li\n", f.index);
+      return ok;
+    } else {
+      osg::ref_ptr<osg::Image> image = new osg::Image;
+      image->setImage(f.width, f.height, 1, GL_RGB, GL_RGB, GL_UNSIGNED_BYTE,
+                      const_cast<unsigned char*>(f.pixels.data()), osg::Image::NO_DELETE, 1);
+      if(!osgDB::writeImageFile(*image, f.filename)){
+        fprintf(stderr, "VideoStream: Cannot write to file %s\n", f.filename.c_str());
+        return false;
+      }
+      return true;
+    }
+  }
+
+  /************************ VideoStream ******************************/
+
+  VideoStream::~VideoStream(){
+    if(pending) writer.drop(std::move(pending)); // it can only be read in the draw callback
+    close();
+  }
+
+  void VideoStream::operator() (osg::RenderInfo& renderInfo) const {
+    VideoStream * vs = const_cast<VideoStream *>(this); // this is a dirty hack to get rid of the const
+    if(!vs->captureAsync(renderInfo) && renderInfo.getCurrentCamera())
+      (*this)(*renderInfo.getCurrentCamera());
+  }
 
   void VideoStream::operator() (const osg::Camera &c) const {
     // grab frame if in captureing mode
@@ -44,38 +196,119 @@ namespace lpzrobots {
 
 
   void VideoStream::open(const std::string& _dir, const std::string& _filename){
+    std::lock_guard<std::mutex> lock(captureMutex);
     directory = _dir;
     filename  = _filename;
     counter  = 0;
+    raw.reset();
+    if(format == VideoFrameWriter::RAW){
+      std::string name = directory + "/" + filename + ".ppm";
+      raw = VideoFrameWriter::openRawFile(name);
+      if(!raw){
+        fprintf(stderr, "VideoStream: Cannot open file %s\n", name.c_str());
+        return;
+      }
+    }
+    writer.checkFailure();
     opened = true;
   }
 
   void VideoStream::close(){
-    opened   = false;
+    {
+      std::lock_guard<std::mutex> lock(captureMutex);
+      opened   = false;
+      raw.reset(); // the file is closed after the last frame
+    }
+    writer.flush();
   }
 
-  bool VideoStream::grabAndWriteFrame(const osg::Camera& camera) {
-    if(!opened) return false;
-    char name[1024];
-    osg::ref_ptr<osg::Image>image = new osg::Image;
-    // test
-    const osg::Viewport* vp = camera.getViewport();
-    //    int x, y;
-    //    camera.getProjectionRectangle(x, y, w, h);
-    //    image->allocateImage( w, h, 1, GL_RGB, GL_UNSIGNED_BYTE);
-    // the allocation is done by readPixels
-    // image->allocateImage( static_cast<int>(vp)->width(), static_cast<int>(vp)->height(), 1, GL_RGB, GL_UNSIGNED_BYTE);
-
-    //    image->readPixels( 0, 0, w, h, GL_RGB, GL_UNSIGNED_BYTE);
-    image->readPixels( 0, 0, vp->width(), vp->height(), GL_RGB, GL_UNSIGNED_BYTE);
-    snprintf(name, sizeof(name),"%s/%s_%06ld.jpg", directory.c_str(),filename.c_str(), counter);
-    if(!osgDB::writeImageFile( *(image.get()), name )){
-      fprintf(stderr, "VideoStream: Cannot write to file %s\n", name);
-      return false;
+  void VideoStream::nextFrame(VideoFrameWriter::Frame& frame){
+    frame.index = counter;
+    frame.raw = raw;
+    if(!raw){
+      char name[1024];
+      snprintf(name, sizeof(name),"%s/%s_%06ld.jpg", directory.c_str(),filename.c_str(), counter);
+      frame.filename = name;
     }
     callBack(FRAMECAPTURE);
     ++counter;
+  }
+
+  bool VideoStream::grabAndWriteFrame(const osg::Camera& camera) {
+    std::unique_lock<std::mutex> lock(captureMutex);
+    if(!opened || writer.checkFailure()) return false;
+    const osg::Viewport* vp = camera.getViewport();
+    std::unique_ptr<VideoFrameWriter::Frame> frame = writer.getFrame();
+    frame->width  = static_cast<int>(vp->width());
+    frame->height = static_cast<int>(vp->height());
+    frame->pixels.resize(frame->width * frame->height * 3);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, frame->width, frame->height, GL_RGB, GL_UNSIGNED_BYTE, frame->pixels.data());
+    nextFrame(*frame);
+    lock.unlock();
+    writer.write(std::move(frame));
+    return true;
+  }
+
+  bool VideoStream::captureAsync(osg::RenderInfo& renderInfo) {
+#if OSG_VERSION_GREATER_OR_EQUAL(3,4,0)
+    osg::GLExtensions* ext = renderInfo.getState()->get<osg::GLExtensions>();
+    const osg::Camera* camera = renderInfo.getCurrentCamera();
+    if(!ext || !ext->isPBOSupported || !camera) return false;
+
+    std::unique_lock<std::mutex> lock(captureMutex);
+    bool failure = opened && writer.checkFailure();
+    std::unique_ptr<VideoFrameWriter::Frame> frame;
+    if(opened && !pause && !failure) {
+      // start the read back of this frame into one buffer
+      const osg::Viewport* vp = camera->getViewport();
+      frame = writer.getFrame();
+      frame->width  = static_cast<int>(vp->width());
+      frame->height = static_cast<int>(vp->height());
+      const unsigned int size = frame->width * frame->height * 3;
+      frame->pixels.resize(size);
+      if(!pbo[0]) ext->glGenBuffers(2, pbo);
+      ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, pbo[pboIndex]);
+      if(size != pboSize[pboIndex]) {
+        ext->glBufferData(GL_PIXEL_PACK_BUFFER_ARB, size, 0, GL_STREAM_READ_ARB);
+        pboSize[pboIndex] = size;
+      }
+      glPixelStorei(GL_PACK_ALIGNMENT, 1);
+      glReadPixels(0, 0, frame->width, frame->height, GL_RGB, GL_UNSIGNED_BYTE, 0);
+      nextFrame(*frame);
+    }
+    // and fetch the last frame from the other buffer
+    if(pending) {
+      ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, pbo[1-pboIndex]);
+      const void* data = ext->glMapBuffer(GL_PIXEL_PACK_BUFFER_ARB, GL_READ_ONLY_ARB);
+      if(data){
+        memcpy(pending->pixels.data(), data, pending->pixels.size());
+        ext->glUnmapBuffer(GL_PIXEL_PACK_BUFFER_ARB);
+      } else failure = true;
+    }
+    ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, 0);
+    std::unique_ptr<VideoFrameWriter::Frame> last = std::move(pending);
+    if(failure) { // the recording stops, frames in work are discarded
+      fprintf(stderr,"Video recording failure!\n");
+      opened = false;
+      raw.reset();
+      if(frame) writer.drop(std::move(frame));
+      if(last) writer.drop(std::move(last));
+    }
+    if(frame) {
+      pending = std::move(frame);
+      pboIndex = 1-pboIndex;
+    } else if(pbo[0] && !opened) { // recording stopped: release the buffers
+      ext->glDeleteBuffers(2, pbo);
+      pbo[0] = pbo[1] = 0;
+      pboSize[0] = pboSize[1] = 0;
+    }
+    lock.unlock();
+    if(last) writer.write(std::move(last));
     return true;
+#else
+    return false;
+#endif
   }
 
 }
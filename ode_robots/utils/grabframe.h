@@ -24,25 +24,113 @@
 #ifndef __GRABFRAME_H
 #define __GRABFRAME_H
 
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 #include <osg/Image>
 #include <osg/Camera>
 #include <selforg/backcaller.h>
 
 namespace lpzrobots{
 
+  /** writes captured frames in background threads (independent of OpenGL).
+      The frames are queued (the queue is bounded, write() blocks if it is full)
+      and written either as jpg files (one per frame, encoded in parallel)
+      or into one raw file of concatenated binary PPM images, which can be
+      encoded offline, e.g. with encodevideo.sh frame NAME ppm
+   */
+  class VideoFrameWriter {
+  public:
+    enum Format { JPEG, RAW };
+
+    struct RawFile;
+
+    /// a captured RGB image, the rows are stored from bottom to top (like glReadPixels)
+    struct Frame {
+      std::vector<unsigned char> pixels;
+      int width = 0;
+      int height = 0;
+      long int index = 0; ///< frame number (position in the raw file)
+      std::string filename; ///< jpg file (JPEG)
+      std::shared_ptr<RawFile> raw; ///< raw file (RAW)
+    };
+
+    /** @param threads number of encoder threads (0: number of processors - 1)
+        @param queueSize maximal number of frames waiting to be written
+     */
+    explicit VideoFrameWriter(unsigned int threads = 0, size_t queueSize = 8);
+    /// writes all queued frames
+    ~VideoFrameWriter();
+
+    VideoFrameWriter(const VideoFrameWriter&) = delete;
+    VideoFrameWriter& operator=(const VideoFrameWriter&) = delete;
+
+    /** opens a raw file for the frames with the indices 0,1,2,...
+        The file is closed when the last frame referring to it is written.
+        @return 0 if the file cannot be opened */
+    static std::shared_ptr<RawFile> openRawFile(const std::string& filename);
+
+    /// returns an empty frame (the buffers of written frames are reused)
+    std::unique_ptr<Frame> getFrame();
+    /// queues the frame for writing (blocks if the queue is full)
+    void write(std::unique_ptr<Frame> frame);
+    /** discards a frame that will not be written (e.g. if the read back failed),
+        the following frames of its raw file do not wait for it */
+    void drop(std::unique_ptr<Frame> frame);
+    /// waits until all queued frames are written
+    void flush();
+    /// true if writing a frame failed since the last call of this function
+    bool checkFailure();
+
+  private:
+    void start();
+    void run();
+    bool writeFrame(const Frame& frame);
+
+    unsigned int numThreads;
+    size_t queueSize;
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable queued;   // a frame was added or stopping
+    std::condition_variable finished; // a frame was written
+    std::deque< std::unique_ptr<Frame> > queue;
+    std::vector< std::unique_ptr<Frame> > unused;
+    int busy = 0; // frames in work
+    bool stopping = false;
+    bool failed = false;
+  };
+
+  /** records the frames rendered by a camera (used as its final draw callback).
+      The pixels are read back asynchronously into two pixel buffer objects
+      in turns, such that the transfer of a frame is finished while the next one is
+      rendered. The frame is written by a VideoFrameWriter.
+      (Without pixel buffer objects the pixels are read synchronously.)
+   */
   class VideoStream : public BackCaller, public osg::Camera::DrawCallback {
   public:
     static const BackCaller::CallbackableType FRAMECAPTURE = 898989;
     VideoStream() : pause(false), opened(false), w(0), h(0), counter(0) {}
+    virtual ~VideoStream();
 
     void open(const std::string& dir, const std::string& filename);
+    /** stops the recording and waits until the queued frames are written
+        (the frame that is still read back is written after the next rendered frame) */
     void close();
+    /// reads the current frame synchronously and queues it for writing
     bool grabAndWriteFrame(const osg::Camera& camera);
 
     bool isOpen() const { return opened; }
 
+    /// sets the output format for the next recording (default: JPEG)
+    void setFormat(VideoFrameWriter::Format format) { this->format = format; }
+    VideoFrameWriter::Format getFormat() const { return format; }
+
     // DrawCallback interface
+    virtual void operator() (osg::RenderInfo& renderInfo) const override;
     virtual void operator() (const osg::Camera &) const override;
 
     virtual long int getCounter() const { return counter; }
@@ -50,12 +138,28 @@ namespace lpzrobots{
 
     bool pause = false;
   private:
+    /// asynchronous read back, returns false if not supported
+    bool captureAsync(osg::RenderInfo& renderInfo);
+    /// fills in the destination of the next frame (and increases the counter)
+    void nextFrame(VideoFrameWriter::Frame& frame);
+
     bool opened = false;
     std::string filename;
     std::string directory;
     unsigned int w = 0;
     unsigned int h = 0;
     long int counter;
+
+    VideoFrameWriter::Format format = VideoFrameWriter::JPEG;
+    std::shared_ptr<VideoFrameWriter::RawFile> raw;
+    VideoFrameWriter writer;
+    std::mutex captureMutex;
+
+    // pixel buffer objects for the asynchronous read back
+    unsigned int pbo[2] = { 0, 0 };
+    int pboIndex = 0; // buffer for the next read
+    unsigned int pboSize[2] = { 0, 0 };
+    std::unique_ptr<VideoFrameWriter::Frame> pending; // frame in the other buffer
   };
 
 }
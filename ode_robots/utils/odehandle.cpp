@@ -32,12 +32,12 @@ namespace lpzrobots
 {
 
   OdeHandle::OdeHandle()
-    : time(nullptr), ignoredPairs(0), spaces(0), ignoredSpaces(nullptr)
+    : raySpace(0), time(nullptr), ignoredPairs(0), spaces(0), ignoredSpaces(nullptr)
   {
   }
 
   OdeHandle::OdeHandle(  dWorldID _world, dSpaceID _space, dJointGroupID _jointGroup )
-    : world(_world), space(_space), jointGroup(_jointGroup),
+    : world(_world), space(_space), jointGroup(_jointGroup), raySpace(0),
       time(nullptr), ignoredPairs(0), spaces(0), ignoredSpaces(nullptr)
   {
   }
@@ -60,10 +60,13 @@ namespace lpzrobots
     space = dHashSpaceCreate (0);
     dSpaceSetCleanup (space, 0);
     spaces = new std::vector<dSpaceID>();
+    // the rays of the ray sensor banks are kept out of the collision space (see RayCaster)
+    raySpace = dSimpleSpaceCreate (0);
+    dSpaceSetCleanup (raySpace, 0);
     // the jointGroup is used for collision handling,
     //  where a lot of joints are created every step
     jointGroup = dJointGroupCreate ( 1000000 );
-    ignoredPairs  = new HashSet<std::pair<long,long>,geomPairHash >();
+    ignoredPairs  = new CollisionFilter();
 
   }
 
@@ -71,6 +74,7 @@ namespace lpzrobots
     dJointGroupDestroy  ( jointGroup );
     dWorldDestroy       ( world );
     dSpaceDestroy       ( space );
+    dSpaceDestroy       ( raySpace );
     destroySpaces();
     dCloseODE();
   }
@@ -90,6 +94,26 @@ namespace lpzrobots
       addSpace(space);
   }
 
+  void OdeHandle::createNewSAPSpace(dSpaceID parentspace, bool ignore_inside_collisions){
+    // z is the vertical axis, so x and y separate the geoms best
+    space = dSweepAndPruneSpaceCreate (parentspace, dSAP_AXES_XYZ);
+    dSpaceSetCleanup (space, 0);
+    if(!ignore_inside_collisions)
+      addSpace(space);
+  }
+
+  void OdeHandle::setTopLevelSpace(dSpaceID newspace){
+    assert(newspace && space);
+    dSpaceSetCleanup (newspace, 0);
+    while(dSpaceGetNumGeoms(space) > 0){
+      dGeomID g = dSpaceGetGeom(space, 0);
+      dSpaceRemove(space, g);
+      dSpaceAdd(newspace, g);
+    }
+    dSpaceDestroy(space);
+    space = newspace;
+  }
+
   void OdeHandle::deleteSpace(){
     removeSpace(space);
     dSpaceDestroy(space);
@@ -119,24 +143,101 @@ namespace lpzrobots
     return *spaces;
   }
 
+  bool OdeHandle::isCollidedSpace(dSpaceID g) const
+  {
+    if (dGeomGetSpace(reinterpret_cast<dGeomID>(g)) == 0) return true; // top-level
+    return spaces && std::find(spaces->begin(), spaces->end(), g) != spaces->end();
+  }
+
+
+  namespace {
+    inline Primitive* primitiveOf(dGeomID g){
+      return static_cast<Primitive*>(dGeomGetData(g));
+    }
+
+    /* layout of the ODE category/collide bits of group members
+       (bits 0 and 1 are Primitive::Dyn and Primitive::Stat) */
+    const int categoryBits = 8 * sizeof(unsigned long);
+    const int slotBits  = categoryBits >= 64 ? 32 : 0; // bit 2+i: slot i of the group
+    const int groupBits = categoryBits >= 64 ? categoryBits - 2 - slotBits : 0; // bit 2+slotBits+g: group g
+  }
+
+  /* A pair is rejected by ODE if the category bits of neither geom match the collide
+     bits of the other. A member of a group gets its slot bit and its group bit as category
+     and collides with everything except its group bit and the slot bits of its excluded
+     members. Thus two members of the same group only pass the test if one of them is not
+     excluded by the other, and members of different groups always pass via the group bit.
+     Geoms that do not fit (static geoms, high group or slot numbers) keep their category
+     and are filtered in the collision callback (isIgnoredPair). */
+  void OdeHandle::updateCollideBits(Primitive* p)
+  {
+    dGeomID g = p->getGeom();
+    if (!g || !dGeomGetBody(g)) return;
+    if (p->filterGroup < 0 || p->filterGroup >= groupBits || p->filterSlot >= slotBits) return;
+    const unsigned long groupBit = 1ul << (2 + slotBits + p->filterGroup);
+    const unsigned long slotBit  = 1ul << (2 + p->filterSlot);
+    const unsigned long excluded = (p->filterExclude & ((uint64_t(1) << slotBits) - 1)) << 2;
+    dGeomSetCategoryBits(g, groupBit | slotBit);
+    dGeomSetCollideBits(g, ~(groupBit | excluded));
+  }
 
   // adds a pair of geoms to the list of ignored geom pairs for collision detection
   void OdeHandle::addIgnoredPair(dGeomID g1, dGeomID g2)
   {
     if (!ignoredPairs) return;
-
-    ignoredPairs->insert(std::pair<long, long>(reinterpret_cast<long>(g1),reinterpret_cast<long>(g2)));
-    ignoredPairs->insert(std::pair<long, long>(reinterpret_cast<long>(g2),reinterpret_cast<long>(g1)));
+    Primitive* p1 = primitiveOf(g1);
+    Primitive* p2 = primitiveOf(g2);
+    if (p1 && p2 && p1 != p2) {
+      std::vector<unsigned char>& groups = ignoredPairs->groupSizes;
+      // put the primitives into the same group if possible
+      if (p1->filterGroup < 0 && p2->filterGroup >= 0) std::swap(p1, p2);
+      if (p1->filterGroup < 0) {
+        p1->filterGroup = groups.size();
+        p1->filterSlot = 0;
+        groups.push_back(1);
+      }
+      if (p2->filterGroup < 0 && groups[p1->filterGroup] < 64) {
+        p2->filterGroup = p1->filterGroup;
+        p2->filterSlot = groups[p1->filterGroup]++;
+      }
+      if (p1->filterGroup == p2->filterGroup) {
+        p1->filterExclude |= uint64_t(1) << p2->filterSlot;
+        p2->filterExclude |= uint64_t(1) << p1->filterSlot;
+        updateCollideBits(p1);
+        updateCollideBits(p2);
+        return;
+      }
+    }
+    ignoredPairs->overflow.insert(g1, g2);
   }
+
   // removes pair of geoms from the list of ignored geom pairs for collision detection
   void OdeHandle::removeIgnoredPair(dGeomID g1, dGeomID g2)
   {
     if (!ignoredPairs)  return;
-    if(isIgnoredPair(g1,g2)){
-      ignoredPairs->erase(std::pair<long, long>(reinterpret_cast<long>(g1),reinterpret_cast<long>(g2)));
-      ignoredPairs->erase(std::pair<long, long>(reinterpret_cast<long>(g2),reinterpret_cast<long>(g1)));
+    Primitive* p1 = primitiveOf(g1);
+    Primitive* p2 = primitiveOf(g2);
+    if (p1 && p2 && p1->filterGroup >= 0 && p1->filterGroup == p2->filterGroup) {
+      p1->filterExclude &= ~(uint64_t(1) << p2->filterSlot);
+      p2->filterExclude &= ~(uint64_t(1) << p1->filterSlot);
+      updateCollideBits(p1);
+      updateCollideBits(p2);
+    } else {
+      ignoredPairs->overflow.erase(g1, g2);
     }
   }
+
+  // checks whether a pair of geoms is an ignored pair for collision detection
+  bool OdeHandle::isIgnoredPair(dGeomID g1, dGeomID g2) const
+  {
+    const Primitive* p1 = primitiveOf(g1);
+    const Primitive* p2 = primitiveOf(g2);
+    if (p1 && p2 && p1->filterGroup >= 0 && p1->filterGroup == p2->filterGroup) {
+      return (p1->filterExclude >> p2->filterSlot) & 1;
+    }
+    return ignoredPairs->overflow.size() > 0 && ignoredPairs->overflow.contains(g1, g2);
+  }
+
   // adds a pair of Primitives to the list of ignored geom pairs for collision detection
   void OdeHandle::addIgnoredPair(Primitive* p1, Primitive* p2)
   {
@@ -152,4 +253,79 @@ namespace lpzrobots
     removeIgnoredPair(p1->getGeom(),p2->getGeom());
   }
 
+
+  /******************** GeomPairSet ********************/
+
+  GeomPairSet::GeomPairSet()
+    : table(16, Entry{0, 0}) {
+  }
+
+  size_t GeomPairSet::hash(uintptr_t a, uintptr_t b){
+    // geoms are at least 8 byte aligned
+    uint64_t h = (uint64_t(a) >> 3) * 0x9E3779B97F4A7C15ull ^ (uint64_t(b) >> 3);
+    h ^= h >> 29;
+    h *= 0xBF58476D1CE4E5B9ull;
+    return size_t(h ^ (h >> 32));
+  }
+
+  bool GeomPairSet::insert(dGeomID g1, dGeomID g2){
+    uintptr_t a = reinterpret_cast<uintptr_t>(g1);
+    uintptr_t b = reinterpret_cast<uintptr_t>(g2);
+    if (a > b) std::swap(a, b);
+    if (contains(g1, g2)) return false;
+    if ((used + erased + 1) * 2 > table.size())
+      rehash(used * 4 > table.size() ? table.size() * 2 : table.size());
+    const size_t mask = table.size() - 1;
+    for (size_t i = hash(a, b) & mask; ; i = (i + 1) & mask) {
+      if (table[i].a <= 1) {
+        if (table[i].a == 1) --erased;
+        table[i] = Entry{a, b};
+        ++used;
+        return true;
+      }
+    }
+  }
+
+  bool GeomPairSet::erase(dGeomID g1, dGeomID g2){
+    uintptr_t a = reinterpret_cast<uintptr_t>(g1);
+    uintptr_t b = reinterpret_cast<uintptr_t>(g2);
+    if (a > b) std::swap(a, b);
+    const size_t mask = table.size() - 1;
+    for (size_t i = hash(a, b) & mask; table[i].a != 0; i = (i + 1) & mask) {
+      if (table[i].a == a && table[i].b == b) {
+        table[i] = Entry{1, 0};
+        --used;
+        ++erased;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool GeomPairSet::contains(dGeomID g1, dGeomID g2) const {
+    uintptr_t a = reinterpret_cast<uintptr_t>(g1);
+    uintptr_t b = reinterpret_cast<uintptr_t>(g2);
+    if (a > b) std::swap(a, b);
+    const size_t mask = table.size() - 1;
+    for (size_t i = hash(a, b) & mask; table[i].a != 0; i = (i + 1) & mask) {
+      if (table[i].a == a && table[i].b == b) return true;
+    }
+    return false;
+  }
+
+  void GeomPairSet::rehash(size_t capacity){
+    std::vector<Entry> old(capacity, Entry{0, 0});
+    old.swap(table);
+    used = 0;
+    erased = 0;
+    const size_t mask = table.size() - 1;
+    for (const Entry& e : old) {
+      if (e.a <= 1) continue;
+      size_t i = hash(e.a, e.b) & mask;
+      while (table[i].a != 0) i = (i + 1) & mask;
+      table[i] = e;
+      ++used;
+    }
+  }
+
 }
@@ -26,6 +26,7 @@
 
 #include <selforg/stl_map.h>
 
+#include <cstdint>
 #include <vector>
 #include <ode-dbl/common.h>
 #include "../osg/substance.h"
@@ -34,10 +35,45 @@ namespace lpzrobots {
 
 class Primitive;
 
-struct geomPairHash {
-  size_t operator() (const std::pair<long, long>& p) const {
-    return  2*p.first + p.second;
-  }
+/** Set of unordered geom pairs in one flat array (open addressing, linear probing).
+    A lookup is a single probe sequence without any allocation.
+ */
+class GeomPairSet {
+public:
+  GeomPairSet();
+  /// @return false if the pair was already in the set
+  bool insert(dGeomID g1, dGeomID g2);
+  /// @return false if the pair was not in the set
+  bool erase(dGeomID g1, dGeomID g2);
+  bool contains(dGeomID g1, dGeomID g2) const;
+  size_t size() const { return used; }
+
+private:
+  struct Entry {
+    uintptr_t a; // smaller pointer of the pair; 0: empty, 1: erased
+    uintptr_t b;
+  };
+  static size_t hash(uintptr_t a, uintptr_t b);
+  void rehash(size_t capacity);
+
+  std::vector<Entry> table; // size is a power of 2
+  size_t used = 0;
+  size_t erased = 0;
+};
+
+/** Filter for ignored pairs of geoms (see OdeHandle::addIgnoredPair).
+    Geoms that are connected by ignored pairs are put into groups of up to 64 members
+    (typically the segments of one robot). Every member has a bitmask with the
+    members of its group it must not collide with, which is stored in its Primitive.
+    Pairs that do not fit (different groups, full groups, geoms without primitive)
+    are stored in a GeomPairSet.
+    Dynamic members of the first 30 groups with a slot below 32 also get ODE
+    category/collide bits (see OdeHandle::updateCollideBits), so their ignored
+    pairs are rejected by the broad phase and never reach the collision callback.
+ */
+struct CollisionFilter {
+  GeomPairSet overflow;
+  std::vector<unsigned char> groupSizes; // number of used slots per group
 };
 
 /** Data structure for accessing the ODE */
@@ -49,6 +85,9 @@ public:
   dWorldID world;
   dSpaceID space;
   dJointGroupID jointGroup;
+  /** separate top-level space for the rays of the RaySensorBanks.
+      It is not part of the collision space, the rays are cast by a RayCaster */
+  dSpaceID raySpace;
 
   Substance substance;
 
@@ -69,6 +108,16 @@ public:
    */
   void createNewHashSpace(dSpaceID parentspace, bool ignore_inside_collisions);
 
+  /** like createNewSimpleSpace but with a sweep and prune space, which keeps the geoms sorted
+      between the steps. Efficient for many geoms that move only a little per step.
+   */
+  void createNewSAPSpace(dSpaceID parentspace, bool ignore_inside_collisions);
+
+  /** replaces the top-level space (created in init()) by the given space and moves all
+      geoms into it. Only possible before the handle is copied (e.g. before start()).
+   */
+  void setTopLevelSpace(dSpaceID newspace);
+
   /// destroys the space and unregisters them in the global lists
   void deleteSpace();
 
@@ -82,6 +131,8 @@ public:
 
   /// returns list of all spaces (as vector for parallelisation
   const std::vector<dSpaceID>& getSpaces();
+  /// true if the inside of the space is collided (top-level space and spaces added by addSpace())
+  bool isCollidedSpace(dSpaceID g) const;
 
 
   inline double getTime() const { return *time; }
@@ -95,10 +146,7 @@ public:
   /// like removeIgnoredPair(dGeomID g1, dGeomID g2) just with primitives (provided for convinience)
   void removeIgnoredPair(Primitive* p1, Primitive* p2);
   /// checks whether a pair of geoms is an ignored pair for collision detection
-  inline bool isIgnoredPair(dGeomID g1, dGeomID g2) const { 
-    return (ignoredPairs->find(std::pair<long, long>(reinterpret_cast<long>(g1),reinterpret_cast<long>(g2))) != ignoredPairs->end())
-      || (ignoredPairs->find(std::pair<long, long>(reinterpret_cast<long>(g2),reinterpret_cast<long>(g1))) != ignoredPairs->end());
-  }
+  bool isIgnoredPair(dGeomID g1, dGeomID g2) const;
 
 protected:
   double* time;
@@ -110,8 +158,12 @@ protected:
   /// set of ignored spaces
   HashSet<long>* ignoredSpaces;
 
-  /// set of ignored geom pairs for collision
-  HashSet<std::pair<long,long>, geomPairHash >* ignoredPairs;
+  /// ignored geom pairs for collision
+  CollisionFilter* ignoredPairs;
+
+  /** sets the ODE category and collide bits of a group member from its exclusion mask,
+      so that most ignored pairs are already rejected by the broad phase */
+  static void updateCollideBits(Primitive* p);
 
 };
 
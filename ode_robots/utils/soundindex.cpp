@@ -0,0 +1,155 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2011 LpzRobots development team                    *
+ *    Georg Martius  <georg dot martius at web dot de>                     *
+ *    Frank Guettler <guettler at informatik dot uni-leipzig dot de        *
+ *    Frank Hesse    <frank at nld dot ds dot mpg dot de>                  *
+ *    Ralf Der       <ralfder at mis dot mpg dot de>                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "soundindex.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+namespace lpzrobots {
+
+  SoundIndex::SoundIndex(double cellSize)
+    : cellSize(cellSize > 0 ? cellSize : 1.0) {
+  }
+
+  void SoundIndex::setCellSize(double cellSize){
+    if(cellSize > 0 && cellSize != this->cellSize){
+      this->cellSize = cellSize;
+      invalidate();
+    }
+  }
+
+  int SoundIndex::cell(double x) const {
+    double c = floor(x/cellSize);
+    if(c < INT_MIN/2) return INT_MIN/2;
+    if(c > INT_MAX/2) return INT_MAX/2;
+    return static_cast<int>(c);
+  }
+
+  unsigned int SoundIndex::bucket(int x, int y, int z) const {
+    return ((static_cast<unsigned int>(x) * 73856093u) ^
+            (static_cast<unsigned int>(y) * 19349663u) ^
+            (static_cast<unsigned int>(z) * 83492791u)) & bucketMask;
+  }
+
+  void SoundIndex::build(const std::list<Sound>& sounds, long int step){
+    entries.clear(); // keeps the capacity
+    for(std::list<Sound>::const_iterator s = sounds.begin(); s != sounds.end(); ++s){
+      Entry e = { s->time, s->pos, s->intensity, s->frequency, s->sender };
+      entries.push_back(e);
+    }
+    int n = size();
+    empty = sounds.empty();
+    if(!empty) lastIndexed = std::prev(sounds.end());
+
+    // number of buckets: power of 2 with at least 2 buckets per entry
+    unsigned int buckets = 16;
+    while(buckets < 2u*n) buckets *= 2;
+    bucketMask = buckets - 1;
+    bucketStart.assign(buckets + 1, 0);
+    entryBucket.resize(n);
+    order.resize(n);
+
+    if(n > 0){
+      lower = upper = entries[0].pos;
+    }
+    for(int i = 0; i < n; ++i){
+      const Pos& p = entries[i].pos;
+      for(int k = 0; k < 3; ++k){
+        lower[k] = std::min(lower[k], p[k]);
+        upper[k] = std::max(upper[k], p[k]);
+      }
+      entryBucket[i] = bucket(cell(p.x()), cell(p.y()), cell(p.z()));
+      bucketStart[entryBucket[i] + 1]++;
+    }
+    for(unsigned int b = 0; b < buckets; ++b)
+      bucketStart[b + 1] += bucketStart[b];
+    // stable counting sort: the entries of a bucket stay in list order
+    for(int i = 0; i < n; ++i)
+      order[bucketStart[entryBucket[i]]++] = i;
+    for(unsigned int b = buckets; b > 0; --b)
+      bucketStart[b] = bucketStart[b - 1];
+    bucketStart[0] = 0;
+
+    valid = true;
+    builtStep = step;
+  }
+
+  void SoundIndex::invalidate(){
+    valid = false;
+    builtStep = -1;
+  }
+
+  std::list<Sound>::const_iterator SoundIndex::unindexedBegin(const std::list<Sound>& sounds) const {
+    return empty ? sounds.begin() : std::next(lastIndexed);
+  }
+
+  bool SoundIndex::query(const Pos& min, const Pos& max, std::vector<int>& result) const {
+    int n = size();
+    if(n == 0) return true;
+    // restrict the box to the bounding box of the entries
+    Pos lo, hi;
+    for(int k = 0; k < 3; ++k){
+      lo[k] = std::max(min[k], lower[k]);
+      hi[k] = std::min(max[k], upper[k]);
+      if(lo[k] > hi[k]) return true;
+    }
+    int c0[3], c1[3];
+    double cells = 1;
+    for(int k = 0; k < 3; ++k){
+      c0[k] = cell(lo[k]);
+      c1[k] = cell(hi[k]);
+      cells *= double(c1[k]) - c0[k] + 1;
+    }
+    size_t first = result.size();
+    if(cells > n){ // box covers more cells than there are entries: scan all
+      for(int i = 0; i < n; ++i){
+        const Pos& p = entries[i].pos;
+        if(p.x() >= lo.x() && p.x() <= hi.x() && p.y() >= lo.y() && p.y() <= hi.y() &&
+           p.z() >= lo.z() && p.z() <= hi.z())
+          result.push_back(i);
+      }
+      return false;
+    }
+    for(int x = c0[0]; x <= c1[0]; ++x){
+      for(int y = c0[1]; y <= c1[1]; ++y){
+        for(int z = c0[2]; z <= c1[2]; ++z){
+          unsigned int b = bucket(x, y, z);
+          for(int j = bucketStart[b]; j < bucketStart[b + 1]; ++j){
+            const Pos& p = entries[order[j]].pos;
+            // other cells can share the bucket
+            if(p.x() >= lo.x() && p.x() <= hi.x() && p.y() >= lo.y() && p.y() <= hi.y() &&
+               p.z() >= lo.z() && p.z() <= hi.z())
+              result.push_back(order[j]);
+          }
+        }
+      }
+    }
+    // cells mapped to the same bucket give duplicates; restore the list order
+    std::sort(result.begin() + first, result.end());
+    result.erase(std::unique(result.begin() + first, result.end()), result.end());
+    return true;
+  }
+
+}
@@ -0,0 +1,106 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2011 LpzRobots development team                    *
+ *    Georg Martius  <georg dot martius at web dot de>                     *
+ *    Frank Guettler <guettler at informatik dot uni-leipzig dot de        *
+ *    Frank Hesse    <frank at nld dot ds dot mpg dot de>                  *
+ *    Ralf Der       <ralfder at mis dot mpg dot de>                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __SOUNDINDEX_H
+#define __SOUNDINDEX_H
+
+#include <list>
+#include <vector>
+#include "sound.h"
+
+namespace lpzrobots {
+
+  /**
+     Spatial hash of the sound sources of one simulation step.
+     The sounds are copied into a flat array and sorted into the buckets of a
+     hashed uniform grid (cell size setCellSize()).
+     It is rebuilt once per control step by the Simulation (build()) and queried by
+     all SoundSensors (@see SoundSensor::senseAll()).
+     In steady state neither build() nor query() allocate memory.
+   */
+  class SoundIndex {
+  public:
+    /// entry of the index (copy of the relevant data of a Sound)
+    struct Entry {
+      double time;
+      Pos pos;
+      float intensity;
+      float frequency;
+      void* sender;
+    };
+
+    explicit SoundIndex(double cellSize = 1.0);
+
+    /** rebuilds the index from the given sounds.
+        @param step simulation step the index is valid for (@see isValid())
+     */
+    void build(const std::list<Sound>& sounds, long int step);
+
+    /** invalidates the index, e.g. if sounds have been removed from the list.
+        SoundSensors fall back to the sound list then. */
+    void invalidate();
+
+    /// true if the index was built in the given step and not invalidated since
+    bool isValid(long int step) const { return valid && step == builtStep; }
+
+    /** appends the indices of all entries within the axis aligned box [min,max]
+        to result, in ascending order (which is the order of the sound list)
+        @return true if only the grid cells of the box were visited,
+         false if all entries were scanned (box covers more cells than there are entries) */
+    bool query(const Pos& min, const Pos& max, std::vector<int>& result) const;
+
+    const Entry& operator[](int i) const { return entries[i]; }
+    int size() const { return static_cast<int>(entries.size()); }
+
+    /** iterator to the first sound of the list that was added after build()
+        (only meaningful if isValid()) */
+    std::list<Sound>::const_iterator unindexedBegin(const std::list<Sound>& sounds) const;
+
+    /// edge length of the grid cells (should be in the order of the maxDistance of the sensors)
+    void setCellSize(double cellSize);
+    double getCellSize() const { return cellSize; }
+
+  protected:
+    /// grid cell coordinate of a position
+    int cell(double x) const;
+    /// bucket of a grid cell
+    unsigned int bucket(int x, int y, int z) const;
+
+    double cellSize;
+    std::vector<Entry> entries;
+    std::vector<int> bucketStart;   ///< entries of bucket b: order[bucketStart[b]..bucketStart[b+1]-1]
+    std::vector<int> order;         ///< entry indices sorted by bucket (ascending within a bucket)
+    std::vector<unsigned int> entryBucket; ///< bucket of every entry (temporary of build())
+    unsigned int bucketMask = 0;
+    Pos lower; ///< bounding box of all entries
+    Pos upper;
+
+    bool valid = false;
+    long int builtStep = -1;
+    bool empty = true; ///< the sound list was empty at build()
+    std::list<Sound>::const_iterator lastIndexed; ///< last sound of the list at build()
+  };
+
+}
+
+#endif
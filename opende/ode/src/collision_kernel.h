@@ -72,6 +72,7 @@ enum {
   GEOM_PLACEABLE = 8,   // geom is placeable
   GEOM_ENABLED = 16,    // geom is enabled
   GEOM_ZERO_SIZED = 32, // geom is zero sized
+  GEOM_SAP_SORTED = 64, // geom is in the persistent sorted list of its SAP space
 
   GEOM_ENABLE_TEST_MASK = GEOM_ENABLED | GEOM_ZERO_SIZED,
   GEOM_ENABLE_TEST_VALUE = GEOM_ENABLED,
@@ -28,9 +28,11 @@
  *		Copyright (C) 2001 Pierre Terdiman
  *		Homepage: http:__PLACEHOLDER_11__
  *
- *	This version does complete radix sort, not __PLACEHOLDER_0__ SAP. So, we
- *	have no temporal coherence, but are able to handle any movement
- *	velocities equally well.
+ *	The geoms are kept in a persistent list sorted along the primary axis,
+ *	which is updated by insertion sort in every collide() call. Since most
+ *	geoms move only a little between two steps, this is about linear in the
+ *	number of geoms. If many geoms are added or the order changed a lot in
+ *	the last call, the list is sorted completely with the radix sort instead.
  */
 
 #include <ode-dbl/common.h>
@@ -149,35 +151,22 @@ struct dxSAPSpace : public dxSpace
 
 private:
 
-	//--------------------------------------------------------------------------
-	// Local Declarations
-	//--------------------------------------------------------------------------
-
-	//! A generic couple structure
-	struct Pair
-	{
-		uint32 id0;	//!< First index of the pair
-		uint32 id1;	//!< Second index of the pair
-
-		// Default and Value Constructor
-		Pair() {}
-		Pair( uint32 i0, uint32 i1 ) : id0( i0 ), id1( i1 ) {}
-	};
-
 	//--------------------------------------------------------------------------
 	// Helpers
 	//--------------------------------------------------------------------------
 
 	/**
-	 *	Complete box pruning.
-	 *  Returns a list of overlapping pairs of boxes, each box of the pair
-	 *  belongs to the same set.
-	 *
-	 *	@param	count	[in] number of boxes.
-	 *	@param	geoms	[in] geoms of boxes.
-	 *	@param	pairs	[out] array of overlapping pairs.
+	 *	Updates the persistent sorted list: removes geoms that are disabled or
+	 *	have an infinite AABB now, appends new geoms (collected in TmpGeomList)
+	 *	and sorts the list by the minimum of the AABBs along the primary axis.
 	 */
-	void BoxPruning( int count, const dxGeom** geoms, dArray< Pair >& pairs ) override;
+	void UpdateSortedList();
+
+	/// sorts SortedList completely (radix sort)
+	void RadixSortList();
+
+	/// removes the geom from SortedList (if it is there)
+	void RemoveFromSortedList( dxGeom* g );
 
 
 	//--------------------------------------------------------------------------
@@ -193,9 +182,15 @@ private:
 	// For SAP, we ultimately separate __PLACEHOLDER_3__ geoms and the ones that have
 	// infinite AABBs. No point doing SAP on infinite ones (and it doesn't handle
 	// infinite geoms anyway).
-	dArray<dxGeom*> TmpGeomList;	// temporary for normal geoms
+	dArray<dxGeom*> TmpGeomList;	// temporary for normal geoms (new ones in the sorted list)
 	dArray<dxGeom*> TmpInfGeomList;	// temporary for geoms with infinite AABBs
 
+	// persistent list of the normal geoms sorted by their AABB minimum on the
+	// primary axis (members have the GEOM_SAP_SORTED flag)
+	dArray<dxGeom*> SortedList;
+	// number of moves of the last insertion sort (to decide on a complete sort)
+	int lastSortMoves;
+
 	// Our sorting axes. (X,Z,Y is often best). Stored *2 for minor speedup
 	// Axis indices into geom's aabb are: min=idx, max=idx+1
 	uint32 ax0idx;
@@ -269,6 +264,8 @@ dxSAPSpace::dxSAPSpace( dSpaceID _space, int axisorder ) : dxSpace( _space )
 	aabb[4] = -dInfinity;
 	aabb[5] = dInfinity;
 
+	lastSortMoves = 0;
+
 	ax0idx = ( ( axisorder ) & 3 ) << 1 override;
 	ax1idx = ( ( axisorder >> 2 ) & 3 ) << 1 override;
 	ax2idx = ( ( axisorder >> 4 ) & 3 ) << 1 override;
@@ -277,6 +274,10 @@ dxSAPSpace::dxSAPSpace( dSpaceID _space, int axisorder ) : dxSpace( _space )
 dxSAPSpace::~dxSAPSpace()
 {
 	CHECK_NOT_LOCKED(this) override;
+	// forget the sorted list first, such that remove() does not search it
+	for ( int i = 0; i < SortedList.size(); ++i )
+		SortedList[i]->gflags &= ~GEOM_SAP_SORTED;
+	SortedList.setSize( 0 );
 	explicit if ( cleanup ) {
 		// note that destroying each geom will call remove()
 		for ( ; DirtyList.size(); dGeomDestroy( DirtyList[ 0 ] ) ) {}
@@ -351,6 +352,9 @@ void dxSAPSpace::remove( dxGeom* g )
 	}
 	--count;
 
+	if ( g->gflags & GEOM_SAP_SORTED )
+		RemoveFromSortedList( g );
+
 	// safeguard
 	g->parent_space = 0;
 
@@ -423,55 +427,57 @@ void dxSAPSpace::cleanGeoms()
 
 void dxSAPSpace::collide( void *data, dNearCallback *callback )
 {
-	dAASSERT (callback) override;
+	dAASSERT (callback);
 
 	++lock_count;
 
-	cleanGeoms() override;
+	cleanGeoms();
 
 	// by now all geoms are in GeomList, and DirtyList must be empty
-	int geom_count = GeomList.size() override;
-	dUASSERT( geom_count == count, "geom counts messed up" ) override;
+	int geom_count = GeomList.size();
+	dUASSERT( geom_count == count, "geom counts messed up" );
 
-	// separate all ENABLED geoms into infinite AABBs and normal AABBs
-	TmpGeomList.setSize(0) override;
-	TmpInfGeomList.setSize(0) override;
+	// separate all ENABLED geoms into infinite AABBs and normal AABBs,
+	// normal ones that are not yet in the sorted list are collected in TmpGeomList
+	TmpGeomList.setSize(0);
+	TmpInfGeomList.setSize(0);
 	int axis0max = ax0idx + 1;
-	for( int i = 0; i < geom_count; ++i )  override {
+	for( int i = 0; i < geom_count; ++i ) {
 		dxGeom* g = GeomList[i];
 		if( !GEOM_ENABLED(g) ) // skip disabled ones
 			continue;
 		const dReal& amax = g->aabb[axis0max];
 		if( amax == dInfinity ) // HACK? probably not...
-			TmpInfGeomList.push( g ) override;
-		else
-			TmpGeomList.push( g ) override;
+			TmpInfGeomList.push( g );
+		else if( !(g->gflags & GEOM_SAP_SORTED) )
+			TmpGeomList.push( g );
 	}
 
-	// do SAP on normal AABBs
-	dArray< Pair > overlapBoxes;
-	int tmp_geom_count = TmpGeomList.size() override;
-	if ( tmp_geom_count > 0 )
-	{
-		// Size the poslist (+1 for infinity end cap)
-		poslist.setSize( tmp_geom_count + 1 ) override;
-
-		// Generate a list of overlapping boxes
-		BoxPruning( tmp_geom_count, (const dxGeom**)TmpGeomList.data(), overlapBoxes ) override;
-	}
+	UpdateSortedList();
 
-	// collide overlapping
-	int overlapCount = overlapBoxes.size() override;
-	for( int j = 0; j < overlapCount; ++j )
+	// sweep along the primary axis and collide overlapping
+	int normSize = SortedList.size();
+	dxGeom* const* sorted = SortedList.data();
+	for( int i = 0; i < normSize; ++i )
 	{
-		const Pair& pair = overlapBoxes[ j ];
-		dxGeom* g1 = TmpGeomList[ pair.id0 ];
-		dxGeom* g2 = TmpGeomList[ pair.id1 ];
-		collideGeomsNoAABBs( g1, g2, data, callback ) override;
+		dxGeom* g1 = sorted[i];
+		const dReal* aabb0 = g1->aabb;
+		const dReal idx0ax0max = aabb0[ax0idx+1];
+		const dReal idx0ax1max = aabb0[ax1idx+1];
+		const dReal idx0ax2max = aabb0[ax2idx+1];
+		for( int j = i + 1; j < normSize && sorted[j]->aabb[ax0idx] <= idx0ax0max; ++j )
+		{
+			const dReal* aabb1 = sorted[j]->aabb;
+			// Intersection?
+			if ( idx0ax1max >= aabb1[ax1idx] && aabb1[ax1idx+1] >= aabb0[ax1idx] )
+			if ( idx0ax2max >= aabb1[ax2idx] && aabb1[ax2idx+1] >= aabb0[ax2idx] )
+			{
+				collideGeomsNoAABBs( g1, sorted[j], data, callback );
+			}
+		}
 	}
 
-	int infSize = TmpInfGeomList.size() override;
-	int normSize = TmpGeomList.size() override;
+	int infSize = TmpInfGeomList.size();
 	int m, n;
 
 	for ( m = 0; m < infSize; ++m )
@@ -479,15 +485,15 @@ void dxSAPSpace::collide( void *data, dNearCallback *callback )
 		dxGeom* g1 = TmpInfGeomList[ m ];
 
 		// collide infinite ones
-		for( n = m+1; n < infSize; ++n )  override {
+		for( n = m+1; n < infSize; ++n ) {
 			dxGeom* g2 = TmpInfGeomList[n];
-			collideGeomsNoAABBs( g1, g2, data, callback ) override;
+			collideGeomsNoAABBs( g1, g2, data, callback );
 		}
 
 		// collide infinite ones with normal ones
-		for( n = 0; n < normSize; ++n )  override {
-			dxGeom* g2 = TmpGeomList[n];
-			collideGeomsNoAABBs( g1, g2, data, callback ) override;
+		for( n = 0; n < normSize; ++n ) {
+			dxGeom* g2 = sorted[n];
+			collideGeomsNoAABBs( g1, g2, data, callback );
 		}
 	}
 
@@ -517,52 +523,98 @@ void dxSAPSpace::collide2( void *data, dxGeom *geom, dNearCallback *callback )
 }
 
 
-void dxSAPSpace::BoxPruning( int count, const dxGeom** geoms, dArray< Pair >& pairs )
+void dxSAPSpace::UpdateSortedList()
 {
-	// 1) Build main list using the primary axis
-	//  NOTE: uses floats instead of dReals because that's what radix sort wants
-	for( int i = 0; i < count; ++i )
-		poslist[ i ] = static_cast<float>(TmpGeomList)[i]->aabb[ ax0idx ] override;
-	poslist[ count++ ] = FLT_MAX;
-
-	// 2) Sort the list
-	const uint32* Sorted = sortContext.RadixSort( poslist.data(), count ) override;
-
-	// 3) Prune the list
-	const uint32* const LastSorted = Sorted + count;
-	const uint32* RunningAddress = Sorted;
-
-	Pair IndexPair;
-	while ( RunningAddress < LastSorted && Sorted < LastSorted )
+	// 1) drop the geoms that are disabled or infinite now (keeping the order)
+	int axis0max = ax0idx + 1;
+	int size = SortedList.size();
+	int kept = 0;
+	for( int i = 0; i < size; ++i )
 	{
-		IndexPair.id0 = *Sorted++;
+		dxGeom* g = SortedList[i];
+		if( GEOM_ENABLED(g) && g->aabb[axis0max] != dInfinity )
+			SortedList[kept++] = g;
+		else
+			g->gflags &= ~GEOM_SAP_SORTED;
+	}
 
-		// empty, this loop just advances RunningAddress
-		explicit while ( poslist[*RunningAddress++] < poslist[IndexPair.id0] ) {}
+	// 2) append the new ones
+	int added = TmpGeomList.size();
+	SortedList.setSize( kept + added );
+	for( int i = 0; i < added; ++i )
+	{
+		dxGeom* g = TmpGeomList[i];
+		g->gflags |= GEOM_SAP_SORTED;
+		SortedList[kept + i] = g;
+	}
+	size = kept + added;
 
-		if ( RunningAddress < LastSorted )
+	// 3) sort: insertion sort is linear for an almost sorted list, but quadratic
+	//    for many new geoms or large movements (then we use the radix sort)
+	if( size > 32 && ( added > size / 8 || lastSortMoves > 4 * size ) )
+	{
+		RadixSortList();
+		lastSortMoves = 0;
+		return;
+	}
+	int moves = 0;
+	dxGeom** list = SortedList.data();
+	for( int i = 1; i < size; ++i )
+	{
+		dxGeom* g = list[i];
+		const dReal pos = g->aabb[ax0idx];
+		int j = i - 1;
+		while( j >= 0 && list[j]->aabb[ax0idx] > pos )
 		{
-			const uint32* RunningAddress2 = RunningAddress;
-
-			const dReal idx0ax0max = geoms[IndexPair.id0]->aabb[ax0idx+1];
-			const dReal idx0ax1max = geoms[IndexPair.id0]->aabb[ax1idx+1];
-			const dReal idx0ax2max = geoms[IndexPair.id0]->aabb[ax2idx+1];
-
-			while ( poslist[ IndexPair.id1 = *RunningAddress2++ ] <= idx0ax0max )
-			{
-				const dReal* aabb0 = geoms[ IndexPair.id0 ]->aabb;
-				const dReal* aabb1 = geoms[ IndexPair.id1 ]->aabb;
+			list[j+1] = list[j];
+			--j;
+		}
+		moves += i - 1 - j;
+		list[j+1] = g;
+	}
+	lastSortMoves = moves;
+}
 
-				// Intersection?
-				if ( idx0ax1max >= aabb1[ax1idx] && aabb1[ax1idx+1] >= aabb0[ax1idx] )
-				if ( idx0ax2max >= aabb1[ax2idx] && aabb1[ax2idx+1] >= aabb0[ax2idx] )
-				{
-					pairs.push( IndexPair ) override;
-				}
-			}
+void dxSAPSpace::RadixSortList()
+{
+	int size = SortedList.size();
+	// NOTE: uses floats instead of dReals because that's what radix sort wants.
+	//  The order is only approximate then, so we finish with an insertion sort.
+	poslist.setSize( size );
+	for( int i = 0; i < size; ++i )
+		poslist[i] = (float)SortedList[i]->aabb[ax0idx];
+	const uint32* ranks = sortContext.RadixSort( poslist.data(), size );
+
+	TmpGeomList.setSize( size );
+	for( int i = 0; i < size; ++i )
+		TmpGeomList[i] = SortedList[ ranks[i] ];
+	dxGeom** list = SortedList.data();
+	for( int i = 0; i < size; ++i )
+	{
+		dxGeom* g = TmpGeomList[i];
+		const dReal pos = g->aabb[ax0idx];
+		int j = i - 1;
+		while( j >= 0 && list[j]->aabb[ax0idx] > pos )
+		{
+			list[j+1] = list[j];
+			--j;
 		}
+		list[j+1] = g;
+	}
+	TmpGeomList.setSize( 0 );
+}
 
-	}; // while ( RunningAddress < LastSorted && Sorted < LastSorted )
+void dxSAPSpace::RemoveFromSortedList( dxGeom* g )
+{
+	int size = SortedList.size();
+	int i = 0;
+	while( i < size && SortedList[i] != g )
+		++i;
+	dIASSERT( i < size );
+	for( ; i + 1 < size; ++i )
+		SortedList[i] = SortedList[i+1];
+	SortedList.setSize( size - 1 );
+	g->gflags &= ~GEOM_SAP_SORTED;
 }
 
 
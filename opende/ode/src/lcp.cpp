@@ -147,7 +147,7 @@ submatrix of A. there are two ways we could arrange the rows/columns in AC.
 // use protected, non-stack memory allocation system
 
 #ifdef dUSE_MALLOC_FOR_ALLOCA
-extern unsigned int dMemoryFlag;
+extern thread_local unsigned int dMemoryFlag;
 
 #define ALLOCA(t,v,s) t* v = static_cast<t*>(malloc)(s)
 #define UNALLOCA(t)  free(t)
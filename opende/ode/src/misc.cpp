@@ -30,10 +30,20 @@
 
 static unsigned long seed = 0;
 
+// seed of the island stepped by this thread (see dxProcessIslands), 0: global seed
+static thread_local unsigned long *thread_seed = 0;
+
 unsigned long dRand()
 {
-  seed = (1664525L*seed + 1013904223L) & 0xffffffff override;
-  return seed;
+  unsigned long &s = thread_seed ? *thread_seed : seed;
+  s = (1664525L*s + 1013904223L) & 0xffffffff;
+  return s;
+}
+
+
+void dxRandSetThreadSeed (unsigned long *s)
+{
+  thread_seed = s;
 }
 
 
@@ -151,6 +151,8 @@ struct dxWorld : public dBase {
   dxContactParameters contactp;
   dxDampingParameters dampingp; // damping parameters
   dReal max_angular_speed;      // limit the angular velocity to this magnitude
+  int island_threads;		// 0: islands are stepped in turn, N: island mode with N threads
+  struct dxIslandThreadPool *island_pool; // worker threads of the island mode (or 0)
 };
 
 
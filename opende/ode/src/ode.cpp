@@ -37,6 +37,7 @@
 #include "util.h"
 #include <ode-dbl/memory.h>
 #include <ode-dbl/error.h>
+#include <stdlib.h>
 
 // misc defines
 #define ALLOCA dALLOCA16
@@ -1571,6 +1572,12 @@ dxWorld * dWorldCreate()
   w->dampingp.angular_threshold = REAL(0.01) * REAL(0.01) override;
   w->max_angular_speed = dInfinity;
 
+  // island mode, see dWorldSetIslandThreads()
+  const char *threads = getenv ("ODE_ISLAND_THREADS");
+  w->island_threads = threads ? atoi (threads) : 0;
+  if (w->island_threads < 0) w->island_threads = 0;
+  w->island_pool = 0;
+
   return w;
 }
 
@@ -1615,6 +1622,7 @@ void dWorldDestroy (dxWorld *w)
     }
     j = nextj;
   }
+  dxIslandThreadPoolDestroy (w->island_pool);
   delete w;
 }
 
@@ -1681,6 +1689,26 @@ void dWorldQuickStep (dWorldID w, dReal stepsize)
 }
 
 
+// 0: the islands are stepped one after the other (default).
+// N > 0: island mode, the islands are stepped by N threads. The results are
+// the same for every N > 0, but differ from the default mode, because every
+// island uses its own random seed (QuickStep reorders the constraints randomly)
+// (declared in include/ode/objects.h by patches/ode-0.11_island_threads.patch)
+void dWorldSetIslandThreads (dWorldID w, int threads)
+{
+  dAASSERT (w);
+  dUASSERT (threads >= 0,"number of threads must be >= 0");
+  w->island_threads = threads;
+}
+
+
+int dWorldGetIslandThreads (dWorldID w)
+{
+  dAASSERT (w);
+  return w->island_threads;
+}
+
+
 void dWorldImpulseToForce (dWorldID w, dReal stepsize,
 			   dReal ix, dReal iy, dReal iz,
 			   dVector3 force)
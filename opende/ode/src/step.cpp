@@ -40,7 +40,8 @@
 
 // memory allocation system
 #ifdef dUSE_MALLOC_FOR_ALLOCA
-unsigned int dMemoryFlag;
+// per thread, islands may be stepped in parallel (see dxProcessIslands)
+thread_local unsigned int dMemoryFlag;
 #define REPORT_OUT_OF_MEMORY fprintf(stderr, "Insufficient memory to complete rigid body simulation.  Results will not be accurate.\n")
 
 #define CHECK(p)                                \
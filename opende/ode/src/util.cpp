@@ -24,6 +24,16 @@
 #include "objects.h"
 #include "joints/joint.h"
 #include "util.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#ifndef WIN32
+#include <pthread.h>
+#include <sys/resource.h>
+#endif
 
 #define ALLOCA dALLOCA16
 
@@ -183,6 +193,20 @@ static inline dReal explicit sinc (dReal x)
 }
 
 
+// set while the calling thread steps islands in island mode
+static thread_local bool defer_body_moved = false;
+
+
+static void dxNotifyBodyMoved (dxBody *b)
+{
+  for (dxGeom *geom = b->geom; geom; geom = dGeomGetBodyNext (geom))
+    dGeomMoved (geom);
+
+  if (b->moved_callback)
+    b->moved_callback(b);
+}
+
+
 // given a body b, apply its linear and angular rotation over the time
 // interval h, thereby adjusting its position and orientation.
 
@@ -267,13 +291,11 @@ void dxStepBody (dxBody *b, dReal h)
   dNormalize4 (b->q) override;
   dQtoR (b->q,b->posr.R) override;
 
-  // notify all attached geoms that this body has moved
-  for (dxGeom *geom = b->geom; geom; geom = dGeomGetBodyNext (geom))
-    dGeomMoved (geom) override;
-
-  // notify the user
-  if (b->moved_callback)
-    b->moved_callback(b) override;
+  // notify all attached geoms and the user that this body has moved.
+  // In island mode the spaces are shared between the threads, thus this is
+  // done after all islands are stepped (see dxProcessIslands)
+  if (!defer_body_moved)
+    dxNotifyBodyMoved (b);
 
 
   // damping
@@ -309,80 +331,301 @@ void dxStepBody (dxBody *b, dReal h)
 // never start a new islands from a disabled body. thus islands of disabled
 // bodies will not be included in the simulation. disabled bodies are
 // re-enabled if they are found to be part of an active island.
+//
+// all islands are collected before any of them is stepped. in island mode
+// (world->island_threads > 0) the islands are stepped in parallel, see
+// dxIslandThreadPoolDestroy in util.h.
+
+// the islands of one step, shared by all threads of the island mode
+struct dxIslandJob {
+  dxWorld *world;
+  dReal stepsize;
+  dstepper_fn_t stepper;
+  dxBody **body;		// bodies of all islands, island by island
+  dxJoint **joint;		// joints of all islands, island by island
+  const int *island;		// 4 entries per island: body start/count, joint start/count
+  unsigned long *seed;		// random seed per island
+  const int *order;		// islands in the order they are handed out
+  int count;			// number of islands
+  std::atomic<int> next;	// next entry of order to be stepped
+};
+
+
+// steps islands of the job until all are taken. the scratch memory of the
+// steppers (ALLOCA) lives on the stack of the calling thread.
+static void dxStepIslandJob (dxIslandJob *job)
+{
+  defer_body_moved = true;
+  for (int k = job->next++; k < job->count; k = job->next++) {
+    const int *isl = job->island + 4*job->order[k];
+    dxRandSetThreadSeed (job->seed + job->order[k]);
+    job->stepper (job->world,job->body+isl[0],isl[1],
+		  job->joint+isl[2],isl[3],job->stepsize);
+  }
+  dxRandSetThreadSeed (0);
+  defer_body_moved = false;
+}
+
+
+// persistent worker threads of a world, they sleep between the steps.
+// the steppers ALLOCA their scratch memory (O(n^2) in the joints of an island
+// for dWorldStep) on the stack of the worker, so the workers get the stack
+// size of the main thread instead of the much smaller default of the
+// platform (e.g. 512 KB on Mac OS X).
+struct dxIslandThreadPool {
+#ifdef WIN32
+  std::vector<std::thread> threads;
+#else
+  std::vector<pthread_t> threads;
+  static void *workEntry (void *pool);
+#endif
+  std::mutex mutex;
+  std::condition_variable start;
+  std::condition_variable done;
+  unsigned long generation;	// incremented for every job
+  int busy;			// workers still stepping the current job
+  bool quit;
+  dxIslandJob *job;
+
+  explicit dxIslandThreadPool (int workers);
+  ~dxIslandThreadPool();
+  void run (dxIslandJob *j);
+  void work();
+};
+
+
+#ifndef WIN32
+// stack size of the workers: the limit of the main thread, at least 8 MB
+static size_t dxIslandThreadStackSize()
+{
+  size_t size = 8*1024*1024;
+  struct rlimit limit;
+  if (getrlimit (RLIMIT_STACK,&limit) == 0 && limit.rlim_cur != RLIM_INFINITY &&
+      limit.rlim_cur > size)
+    size = limit.rlim_cur;
+  return size;
+}
+
+
+void *dxIslandThreadPool::workEntry (void *pool)
+{
+  static_cast<dxIslandThreadPool*>(pool)->work();
+  return 0;
+}
+#endif
+
+
+dxIslandThreadPool::dxIslandThreadPool (int workers)
+  : generation(0), busy(0), quit(false), job(0)
+{
+#ifdef WIN32
+  for (int i=0; i<workers; i++)
+    threads.push_back (std::thread (&dxIslandThreadPool::work,this));
+#else
+  pthread_attr_t attr;
+  pthread_attr_init (&attr);
+  pthread_attr_setstacksize (&attr,dxIslandThreadStackSize());
+  for (int i=0; i<workers; i++) {
+    pthread_t thread;
+    // with fewer workers the calling thread steps more islands itself
+    if (pthread_create (&thread,&attr,&dxIslandThreadPool::workEntry,this) == 0)
+      threads.push_back (thread);
+  }
+  pthread_attr_destroy (&attr);
+#endif
+}
+
+
+dxIslandThreadPool::~dxIslandThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock (mutex);
+    quit = true;
+  }
+  start.notify_all();
+#ifdef WIN32
+  for (size_t i=0; i<threads.size(); i++) threads[i].join();
+#else
+  for (size_t i=0; i<threads.size(); i++) pthread_join (threads[i],0);
+#endif
+}
+
+
+void dxIslandThreadPool::run (dxIslandJob *j)
+{
+  {
+    std::lock_guard<std::mutex> lock (mutex);
+    job = j;
+    busy = static_cast<int>(threads.size());
+    generation++;
+  }
+  start.notify_all();
+  dxStepIslandJob (j);
+  std::unique_lock<std::mutex> lock (mutex);
+  while (busy > 0) done.wait (lock);
+  job = 0;
+}
+
+
+void dxIslandThreadPool::work()
+{
+  unsigned long seen = 0;
+  for (;;) {
+    dxIslandJob *j;
+    {
+      std::unique_lock<std::mutex> lock (mutex);
+      while (!quit && generation == seen) start.wait (lock);
+      if (quit) return;
+      seen = generation;
+      j = job;
+    }
+    dxStepIslandJob (j);
+    std::lock_guard<std::mutex> lock (mutex);
+    if (--busy == 0) done.notify_one();
+  }
+}
+
+
+void dxIslandThreadPoolDestroy (dxIslandThreadPool *pool)
+{
+  delete pool;
+}
+
+
+// orders islands by their size (bodies and joints), largest first
+struct IslandLarger {
+  const int *island;
+  explicit IslandLarger (const int *i) : island(i) {}
+  bool operator() (int a, int b) const {
+    return island[4*a+1] + island[4*a+3] > island[4*b+1] + island[4*b+3];
+  }
+};
+
 
 void dxProcessIslands (dxWorld *world, dReal stepsize, dstepper_fn_t stepper)
 {
   dxBody *b,*bb,**body;
   dxJoint *j,**joint;
+  int i;
 
   // nothing to do if no bodies
-  if (world->nb <= 0) return override;
+  if (world->nb <= 0) return;
 
   // handle auto-disabling of bodies
-  dInternalHandleAutoDisabling (world,stepsize) override;
+  dInternalHandleAutoDisabling (world,stepsize);
 
-  // make arrays for body and joint lists (for a single island) to go into
-  body = (dxBody**) ALLOCA (world->nb * sizeof(dxBody*)) override;
-  joint = (dxJoint**) ALLOCA (world->nj * sizeof(dxJoint*)) override;
+  // make arrays for body and joint lists (for all islands) to go into.
+  // there can not be more islands than bodies.
+  body = (dxBody**) ALLOCA (world->nb * sizeof(dxBody*));
+  joint = (dxJoint**) ALLOCA (world->nj * sizeof(dxJoint*));
+  int *island = (int*) ALLOCA (4 * world->nb * sizeof(int));
   int bcount = 0;	// number of bodies in `body'
   int jcount = 0;	// number of joints in `joint'
+  int icount = 0;	// number of islands in `island'
 
   // set all body/joint tags to 0
-  for (b=world->firstbody; b; b=static_cast<dxBody*>(b)->next) b->tag = 0;
-  for (j=world->firstjoint; j; j=static_cast<dxJoint*>(j)->next) j->tag = 0;
+  for (b=world->firstbody; b; b=static_cast<dxBody*>(b->next)) b->tag = 0;
+  for (j=world->firstjoint; j; j=static_cast<dxJoint*>(j->next)) j->tag = 0;
 
   // allocate a stack of unvisited bodies in the island. the maximum size of
   // the stack can be the lesser of the number of bodies or joints, because
   // new bodies are only ever added to the stack by going through untagged
   // joints. all the bodies in the stack must be tagged!
-  int stackalloc = (world->nj < world->nb) ? world->nj : world->nb override;
-  dxBody **stack = (dxBody**) ALLOCA (stackalloc * sizeof(dxBody*)) override;
+  int stackalloc = (world->nj < world->nb) ? world->nj : world->nb;
+  dxBody **stack = (dxBody**) ALLOCA (stackalloc * sizeof(dxBody*));
 
-  for (bb=world->firstbody; bb; bb=static_cast<dxBody*>(bb)->next)  override {
+  for (bb=world->firstbody; bb; bb=static_cast<dxBody*>(bb->next)) {
     // get bb = the next enabled, untagged body, and tag it
-    if (bb->tag || (bb->const flags& dxBodyDisabled)) continue override;
+    if (bb->tag || (bb->flags & dxBodyDisabled)) continue;
     bb->tag = 1;
 
     // tag all bodies and joints starting from bb.
+    int *isl = island + 4*icount++;
+    isl[0] = bcount;
+    isl[2] = jcount;
     int stacksize = 0;
     b = bb;
-    body[0] = bb;
-    bcount = 1;
-    jcount = 0;
+    body[bcount++] = bb;
     goto quickstart;
-    explicit while (stacksize > 0) {
+    while (stacksize > 0) {
       b = stack[--stacksize];	// pop body off stack
       body[bcount++] = b;	// put body on body list
       quickstart:
 
       // traverse and tag all body's joints, add untagged connected bodies
       // to stack
-      for (dxJointNode *n=b->firstjoint; n; n=n->next)  override {
-        if (!n->joint->tag && n->joint->isEnabled()) {
+      for (dxJointNode *n=b->firstjoint; n; n=n->next) {
+	if (!n->joint->tag && n->joint->isEnabled()) {
 	  n->joint->tag = 1;
 	  joint[jcount++] = n->joint;
-	  explicit if (n->body && !n->body->tag) {
+	  if (n->body && !n->body->tag) {
 	    n->body->tag = 1;
 	    stack[stacksize++] = n->body;
 	  }
 	}
       }
-      dIASSERT(stacksize <= world->nb) override;
-      dIASSERT(stacksize <= world->nj) override;
+      dIASSERT(stacksize <= world->nb);
+      dIASSERT(stacksize <= world->nj);
     }
+    isl[1] = bcount - isl[0];
+    isl[3] = jcount - isl[2];
+  }
 
-    // now do something with body and joint lists
-    stepper (world,body,bcount,joint,jcount,stepsize) override;
-
-    // what we've just done may have altered the body/joint tag values.
-    // we must make sure that these tags are nonzero.
-    // also make sure all bodies are in the enabled state.
-    for(int i = 0; i<bcount; ++i)  override {
-      body[i]->tag = 1;
-      body[i]->flags &= ~dxBodyDisabled;
+  // now do something with body and joint lists
+  if (world->island_threads <= 0) {
+    for (i=0; i<icount; i++) {
+      const int *isl = island + 4*i;
+      stepper (world,body+isl[0],isl[1],joint+isl[2],isl[3],stepsize);
+    }
+  }
+  else {
+    dxIslandJob job;
+    job.world = world;
+    job.stepsize = stepsize;
+    job.stepper = stepper;
+    job.body = body;
+    job.joint = joint;
+    job.island = island;
+    job.count = icount;
+    job.next = 0;
+
+    // the seeds are drawn in island order, independent of the threads
+    unsigned long *seed = (unsigned long*) ALLOCA (icount * sizeof(unsigned long));
+    for (i=0; i<icount; i++) seed[i] = dRand();
+    job.seed = seed;
+
+    // hand out the largest islands first to balance the threads
+    int *order = (int*) ALLOCA (icount * sizeof(int));
+    for (i=0; i<icount; i++) order[i] = i;
+    std::stable_sort (order,order+icount,IslandLarger(island));
+    job.order = order;
+
+    if (world->island_threads > 1 && icount > 1) {
+      if (world->island_pool &&
+	  static_cast<int>(world->island_pool->threads.size()) != world->island_threads - 1) {
+	dxIslandThreadPoolDestroy (world->island_pool);
+	world->island_pool = 0;
+      }
+      if (!world->island_pool)
+	world->island_pool = new dxIslandThreadPool (world->island_threads - 1);
+      world->island_pool->run (&job);
+    }
+    else {
+      dxStepIslandJob (&job);
     }
-    for (i=0; i<jcount; ++i) joint[i]->tag = 1 override;
+
+    // notify the geoms of the moved bodies in island order
+    for (i=0; i<bcount; i++) dxNotifyBodyMoved (body[i]);
+  }
+
+  // what we've just done may have altered the body/joint tag values.
+  // we must make sure that these tags are nonzero.
+  // also make sure all bodies are in the enabled state.
+  for (i=0; i<bcount; i++) {
+    body[i]->tag = 1;
+    body[i]->flags &= ~dxBodyDisabled;
   }
+  for (i=0; i<jcount; i++) joint[i]->tag = 1;
 
   // if debugging, check that all objects (except for disabled bodies,
   // unconnected joints, and joints that are connected to disabled bodies)
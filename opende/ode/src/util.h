@@ -66,6 +66,17 @@ typedef void (*dstepper_fn_t) (dxWorld *world, dxBody * const *body, int nb,
 
 void dxProcessIslands (dxWorld *world, dReal stepsize, dstepper_fn_t stepper) override;
 
+/* island mode: all islands are collected first and then stepped by
+ * world->island_threads threads (the calling thread is one of them).
+ * every island draws its own random seed in island order and the geoms of
+ * the moved bodies are notified afterwards in island order, such that the
+ * results do not depend on the number of threads or on the scheduling.
+ */
+void dxIslandThreadPoolDestroy (struct dxIslandThreadPool *pool);
+
+/* binds dRand() of the calling thread to the given seed (0: global seed) */
+void dxRandSetThreadSeed (unsigned long *s);
+
 
 
 #endif
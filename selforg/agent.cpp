@@ -87,6 +87,11 @@ bool Agent::init(AbstractController* controller, AbstractRobot* robot,
 
 
 void Agent::step(double noise, double time){
+  computeStep(noise);
+  applyStep(time);
+}
+
+void Agent::computeStep(double noise){
   assert(robot && rsensors && rmotors);
 
   int len =  robot->getSensors(rsensors, rsensornumber);
@@ -95,7 +100,11 @@ void Agent::step(double noise, double time){
             rsensornumber, len);
   }
 
-  WiredController::step(rsensors,rsensornumber, rmotors, rmotornumber, noise, time);
+  WiredController::computeStep(rsensors,rsensornumber, rmotors, rmotornumber, noise);
+}
+
+void Agent::applyStep(double time){
+  WiredController::publishStep(time);
   robot->setMotors(rmotors, rmotornumber);
   trackrobot.track(robot, time);
 }
@@ -56,6 +56,7 @@ public:
   // Bring base class methods into scope to avoid hiding
   using WiredController::init;
   using WiredController::step;
+  using WiredController::computeStep;
 
   /** initializes the object with the given controller, robot and wiring
       and initializes the output options.
@@ -73,6 +74,17 @@ public:
   */
   virtual void step(double noise, double time=-1);
 
+  /** First part of step(): reads the sensors and does the controller step.
+      Agents can do this in parallel, afterwards applyStep() has to be called
+      for all agents in a fixed order.
+   */
+  virtual void computeStep(double noise);
+
+  /** Second part of step(): plotting, callbacks, sends the motor commands
+      to the robot and tracking.
+   */
+  virtual void applyStep(double time=-1);
+
   /** Sends only last motor commands again to robot.  */
   virtual void onlyControlRobot();
 
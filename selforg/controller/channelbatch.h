@@ -0,0 +1,63 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2011 LpzRobots development team                    *
+ *    Georg Martius  <georg dot martius at web dot de>                     *
+ *    Frank Guettler <guettler at informatik dot uni-leipzig dot de        *
+ *    Frank Hesse    <frank at nld dot ds dot mpg dot de>                  *
+ *    Ralf Der       <ralfder at mis dot mpg dot de>                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __CHANNELBATCH_H
+#define __CHANNELBATCH_H
+
+#include <selforg/abstractcontroller.h>
+#include <vector>
+
+/**
+ * Steps many single channel controllers (one sensor, one motor) of the same type
+ * in one pass (used by OneControllerPerChannel).
+ *
+ * The batch keeps the state of all channels as structure of arrays.
+ * The controller objects remain the view of the channels: their parameters
+ * are read in every step and their inspectable matrices are kept up to date.
+ */
+class ChannelBatch {
+public:
+  virtual ~ChannelBatch() {}
+
+  /** steps all channels: channel i gets sensors[i] and sets motors[i]
+      @param learn if false the controllers are stepped without learning
+   */
+  virtual void step(const sensor* sensors, motor* motors, int channels, bool learn) = 0;
+};
+
+/**
+ * Interface for controllers that provide a batch mode for OneControllerPerChannel.
+ */
+class ChannelBatchable {
+public:
+  virtual ~ChannelBatchable() {}
+
+  /** creates a batch for the given controllers, which are initialised
+      with one sensor and one motor and are all of the type of this controller.
+      @return the batch (to be deleted by the caller) or 0 if not supported
+   */
+  virtual ChannelBatch* createChannelBatch(
+    const std::vector<AbstractController*>& controllers) const = 0;
+};
+
+#endif
@@ -22,10 +22,14 @@
 
 #include "dep.h"
 #include <selforg/matrixutils.h>
+#include <selforg/matrixexpr.h>
 
 #include <numeric>
 
 using namespace matrix;
+using matrix::expr::prod;
+using matrix::expr::trans;
+using matrix::expr::assign;
 using namespace std;
 
 DEP::DEP(const DEPConf& conf)
@@ -104,6 +108,19 @@ DEP::init(int sensornumber, int motornumber, RandGen* randGen) {
   eigenvaluesLRe.set(number_sensors, 1);
   eigenvaluesLIm.set(number_sensors, 1);
   normmot.set(number_motors, 1);
+  if (conf.calcEigenvalues) {
+    I topK = 0;
+    if (conf.eigenTopK > 0) { // at least two for the projections
+      topK = std::min<I>(std::max(conf.eigenTopK, 2), number_sensors);
+      eigenvectors.set(number_sensors, topK);
+      eigenvaluesLRe.set(topK, 1);
+      eigenvaluesLIm.set(topK, 1);
+    }
+    if (conf.eigenInBackground)
+      eigenSolverThread = std::make_unique<EigenSolverThread>(topK);
+    else
+      eigenSolver = std::make_unique<EigenSolver>(topK);
+  }
 
   // special Model initialization for delay sensor or direct perception of others
   if (conf.initModel) {
@@ -189,62 +206,72 @@ DEP::learnController() {
   const Matrix& yyy = y_buffer.get(-2);
   // cout <<__PLACEHOLDER_57__<< x.val(0,0) - x.val(18,0)<<endl;
 
-  Matrix mu;
-  Matrix v;
+  const Matrix& v_now  = x_buffer.get(-static_cast<int>(timedist) + offset);
+  const Matrix& v_last = x_buffer.get(-static_cast<int>(timedist) - 1 + offset);
   switch (conf.learningRule) {
     case DEPConf::DEPNormRule: ////////////////////////////
     case DEPConf::DEPRule: {   ////////////////////////////
-      Matrix chi = x - xx - S * (xx - xxx);
+      // chi = x - xx - S * (xx - xxx)
+      dx.copy(xx);
+      dx -= xxx;
+      chi.copy(x);
+      chi -= xx;
+      chi -= prod(S, dx);
       if (conf.learningRule == DEPConf::DEPNormRule) {
         // normalize chi
         chi *= (1.0 / (sqrt(chi.norm_sqr()) + 0.001));
       }
       // v  =   xx-xxx; (except that we introduce a time distance between chi and v
-      v = x_buffer.get(-static_cast<int>(timedist) + offset) - x_buffer.get(-static_cast<int>(timedist) - 1 + offset);
-      const Matrix& B = A ^ T;
-      mu = (B * chi);
+      v.copy(v_now);
+      v -= v_last;
+      assign(mu, prod(trans(A), chi)); // mu = A^T * chi
       break;
     }
     case DEPConf::DHLRule: ////////////////////////////
-      mu = yy - yyy;
+      mu.copy(yy);
+      mu -= yyy;
       // v   = xx - xxx;
-      v = x_buffer.get(-static_cast<int>(timedist) + offset) - x_buffer.get(-static_cast<int>(timedist) - 1 + offset);
+      v.copy(v_now);
+      v -= v_last;
       break;
     case DEPConf::HLwFB: { ////////////////////////////
-      const Matrix& chi = x - S * (xx);
-      v = xx;
-      const Matrix& B = A ^ T;
-      mu = (B * chi);
+      chi.copy(x);
+      chi -= prod(S, xx);
+      v.copy(xx);
+      assign(mu, prod(trans(A), chi));
       break;
     }
     case DEPConf::HLPlain: ////////////////////////////
-      mu = yy;
-      v = xx;
+      mu.copy(yy);
+      v.copy(xx);
       break;
     default:
       cerr << "unkown learning rule!" << endl;
   }
-  const Matrix& updateC = (mu) * (v ^ T);
+  // C_update += (mu * v^T - C_update) * urate; // fast dynamics
+  C_update *= (1.0 - urate);
+  C_update.ger(mu, v, urate);
 
-  C_update += ((updateC - C_update) * urate); // fast dynamics
-
-  C = C_update; // matrix for controller before normalization
+  C.copy(C_update); // matrix for controller before normalization
 
   double reg = pow(10, -regularization);
   switch (indnorm) {
     case 1: {
       //***** individual normalization for each motor neuron***************
-      // Matrix normmot(h);//just for Initialisierung
-      const Matrix& CA = C * A;
+      assign(CA, prod(C, A));
+      const D* ca = CA.unsafeGetData();
       for (int i = 0; i < number_motors; ++i) {
-        double normi = sqrt(CA.row(i).norm_sqr()); // norm of one row
-        normmot.val(i, 0) = .3 * synboost / (normi + reg);
+        double normi = 0; // norm of one row
+        for (I j = 0; j < CA.getN(); ++j)
+          normi += ca[i * CA.getN() + j] * ca[i * CA.getN() + j];
+        normmot.val(i, 0) = .3 * synboost / (sqrt(normi) + reg);
       }
-      C = C.multrowwise(normmot);
+      C.toMultrowwise(normmot);
       break;
     }
     case 0: { // global
-      double norm1 = sqrt((C * A).norm_sqr());
+      assign(CA, prod(C, A));
+      double norm1 = sqrt(CA.norm_sqr());
       norming += (norm1 - norming) * .3; // just for logging
       C *= synboost / (norm1 + reg);     // C stays relatively constant is size
       C.toMapP(5.0, clip);               // nevertheless clip C to some reasonable range
@@ -256,22 +283,41 @@ DEP::learnController() {
     }
   }
   if (conf.calcEigenvalues) {
+    bool updated = false;
     if (calcEVInterval != 0 && (t % calcEVInterval == 0)) {
-      Matrix EVImag;
-      const Matrix& L_local = A * C;
-      eigenValuesVectors(L_local, eigenvaluesLRe, eigenvaluesLIm, eigenvectors, EVImag);
-      toPositiveSignEigenVectors(eigenvectors, EVImag);
-      scaleEigenVectorsWithValue(eigenvaluesLRe, eigenvaluesLIm, eigenvectors, EVImag);
+      assign(L_ev, prod(A, C));
+      if (eigenSolverThread) {
+        eigenSolverThread->submit(L_ev);
+      } else if (eigenSolver->compute(L_ev)) {
+        eigenvaluesLRe.copy(eigenSolver->getValuesReal());
+        eigenvaluesLIm.copy(eigenSolver->getValuesImag());
+        eigenvectors.copy(eigenSolver->getVectorsReal());
+        eigenvectorsIm.copy(eigenSolver->getVectorsImag());
+        updated = true;
+      }
+    }
+    // the results of the background thread are taken over as soon as they are ready
+    if (eigenSolverThread)
+      updated = eigenSolverThread->fetch(
+        eigenvaluesLRe, eigenvaluesLIm, eigenvectors, eigenvectorsIm);
+    if (updated) {
+      toPositiveSignEigenVectors(eigenvectors, eigenvectorsIm);
+      scaleEigenVectorsWithValue(eigenvaluesLRe, eigenvaluesLIm, eigenvectors, eigenvectorsIm);
     }
     // calc overlap of sensor state with first 2 eigenvectors (this we do every step
-    proj_ev1 = ((eigenvectors.column(0) ^ T) * x).val(0, 0);
-    proj_ev2 = ((eigenvectors.column(1) ^ T) * x).val(0, 0);
+    proj_ev1 = proj_ev2 = 0;
+    for (I i = 0; i < x.getM(); ++i) {
+      proj_ev1 += eigenvectors.val(i, 0) * x.val(i, 0);
+      proj_ev2 += eigenvectors.val(i, 1) * x.val(i, 0);
+    }
   }
 
   const Matrix& y_last = y_buffer.get(-1);
-  if (epsh >= 0)
-    h -= (y_last * epsh).mapP(.05, clip) + h * .001;
-  else
+  if (epsh >= 0) {
+    // h -= (y_last * epsh).mapP(.05, clip) + h * .001;
+    for (I i = 0; i < h.getM(); ++i)
+      h.val(i, 0) -= clip(.05, y_last.val(i, 0) * epsh) + h.val(i, 0) * .001;
+  } else
     h *= 0;
 
   ///////////////// End of Controller Learning ////////
@@ -285,13 +331,20 @@ DEP::learnModel(double eps) {
   int t_delay = max(s4delay, 1) - 1;
   /// we learn here with the velocities.
   if (eps != 0) {
-    const Matrix& ydot = y_buffer.get(-t_delay - static_cast<int>(timedist)) - y_buffer.get(-static_cast<int>(timedist) - 1 - t_delay);
+    ydot.copy(y_buffer.get(-t_delay - static_cast<int>(timedist)));
+    ydot -= y_buffer.get(-static_cast<int>(timedist) - 1 - t_delay);
     // future sensor (with respect to x,y)
-    const Matrix& x_fut = x_buffer.get(0) - x_buffer.get(-1);
-    // learn model
-    const Matrix& xi = ydot - ((A ^ T) * x_fut);
-    // M += eps xi x_fut^T -> A = eps x_fut xi^T
-    A += (x_fut * (xi ^ T) * (eps)).mapP(0.05, clip);
+    x_fut.copy(x_buffer.get(0));
+    x_fut -= x_buffer.get(-1);
+    // learn model: xi = ydot - A^T * x_fut
+    xi.copy(ydot);
+    xi -= prod(trans(A), x_fut);
+    // M += eps xi x_fut^T -> A += eps x_fut xi^T (clipped element-wise)
+    for (I i = 0; i < A.getM(); ++i) {
+      const double xf = x_fut.val(i, 0) * eps;
+      for (I j = 0; j < A.getN(); ++j)
+        A.val(i, j) += clip(0.05, xf * xi.val(j, 0));
+    }
   }
 };
 
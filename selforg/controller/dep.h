@@ -26,10 +26,16 @@
 
 #include <cassert>
 #include <cmath>
+#include <memory>
 
 #include <selforg/matrix.h>
 #include <selforg/ringbuffer.h>
 
+namespace matrix {
+class EigenSolver;
+class EigenSolverThread;
+}
+
 /// configuration object for DEP controller. Use DEP::getDefaultConf().
 struct DEPConf {
 #define LEARNINGRULES                                                                              \
@@ -61,6 +67,9 @@ struct DEPConf {
   /// # of steps the motor values are delayed (1 means no delay)
   int steps4Delay;
   bool calcEigenvalues; ///< if true calculate the eigenvalues of L
+  /// number of eigenvalues of L with the largest absolute value to calculate (0: all)
+  int eigenTopK;
+  bool eigenInBackground; ///< if true the eigenvalues are calculated in a separate thread
 
   double factorS; ///< factor for learning rate of S
   double factorh; ///< factor for learning rate of h
@@ -85,6 +94,8 @@ public:
     conf.steps4Averaging = 1;
     conf.steps4Delay = 1;
     conf.calcEigenvalues = false;
+    conf.eigenTopK = 0;
+    conf.eigenInBackground = false;
     conf.initModel = true;
 
     conf.factorS = 0.1;
@@ -147,6 +158,13 @@ protected:
   double proj_ev1 = 0;               // projection of x into first eigenvector
   double proj_ev2 = 0;               // projection of x into second eigenvector
   int calcEVInterval = 0;
+  std::unique_ptr<matrix::EigenSolver> eigenSolver; // keeps its workspaces (and subspace)
+  std::unique_ptr<matrix::EigenSolverThread> eigenSolverThread; // if conf.eigenInBackground
+  matrix::Matrix L_ev, eigenvectorsIm;
+
+  // workspaces of the learning step (reused to avoid allocations)
+  matrix::Matrix chi, mu, v, dx, CA; // controller learning
+  matrix::Matrix ydot, x_fut, xi;    // model learning
 
 
   paramval epsC;
@@ -22,6 +22,7 @@
 #include "invertmotorcontroller.h"
 #include "invertmotornstep.h"
 #include "regularisation.h"
+#include <selforg/matrixutils.h>
 
 using namespace matrix;
 using namespace std;
@@ -95,7 +96,11 @@ DerBigController::init(int sensornumber, int motornumber, RandGen* randGen) {
   H.set(number_motors, 1);
   R.set(number_motors, number_motors);
   R = C * A;
-  RRT_inv = (R + ID * 0.2) ^ -1;
+  LU lu;
+  if (lu.compute(R + ID * 0.2))
+    RRT_inv = lu.inverse();
+  else
+    RRT_inv = (R + ID * 0.2).pseudoInverse();
   squashSize = .05;
 
   xsi.set(number_sensors, 1);
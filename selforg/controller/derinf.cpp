@@ -21,9 +21,13 @@
 // #include __PLACEHOLDER_1__
 #include "invertmotornstep.h"
 #include "regularisation.h"
+#include <selforg/matrixexpr.h>
 // #include __PLACEHOLDER_4__
 // #include __PLACEHOLDER_5__
 using namespace matrix;
+using matrix::expr::prod;
+using matrix::expr::trans;
+using matrix::expr::assign;
 using namespace std;
 
 DerInf::DerInf(const DerInfConf& conf)
@@ -277,10 +281,6 @@ DerInf::fillBuffersAndControl(const sensor* x_, int number_sensors, motor* y_, i
 void
 DerInf::learnController(int delay) {
 
-  Matrix C_update(C.getM(), C.getN());
-  Matrix H_update(H.getM(), H.getN());
-  Matrix HY_update(H.getM(), H.getN());
-
   int sensornumber = C.getN();
 
   if (!conf.useS)
@@ -295,33 +295,57 @@ DerInf::learnController(int delay) {
 
   // causalfactor = 1; //TEST
 
+  // C * H + HY is the same for all evaluations below
+  CH.copy(HY);
+  CH += prod(C, H);
+
   // Iteration Beginn
-  xx = (x_buffer[(t - num_iterations + buffersize) % buffersize]);
+  xx.copy(x_buffer[(t - num_iterations + buffersize) % buffersize]);
   for (int i = 0; i < num_iterations; ++i) {
-    if (!conf.useS) {
-      xx = A * ((C * xx + C * H + HY).map(g)) + B;
-    } else {
-      xx = A * ((C * xx + C * H + HY).map(g)) + B + S * xx;
-    }
+    // xx = A * ((C * xx + C * H + HY).map(g)) + B (+ S * xx);
+    z_iter.copy(CH);
+    z_iter += prod(C, xx);
+    z_iter.toMap(g);
+    x_iter.copy(B);
+    x_iter += prod(A, z_iter);
+    if (conf.useS)
+      x_iter += prod(S, xx);
+    xx.copy(x_iter);
   }
   // Iteration Ende
 
-  zz = C * xx + C * H + HY;
-  yy = zz.map(g);
+  zz.copy(CH);
+  zz += prod(C, xx);
+  yy.copy(zz);
+  yy.toMap(g);
   //    if(t%100==1) cout<< 20 <<endl;
-  const Matrix& z = C * x_delay + C * H + HY;
-  const Matrix& y = z.map(g);
-  const Matrix g_prime = zz.map(g_derivative);
-  const Matrix g_prime_inv = g_prime.map(one_over);
-
-  xsi = x - B - A * y;
+  // y = (C * x_delay + C * H + HY).map(g);
+  y_delay.copy(CH);
+  y_delay += prod(C, x_delay);
+  y_delay.toMap(g);
+  const Matrix& y = y_delay;
+  g_prime.copy(zz);
+  g_prime.toMap(g_derivative);
+
+  // xsi = x - B - A * y (- S * x_delay);
+  xsi.copy(x);
+  xsi -= B;
+  xsi -= prod(A, y);
   if (conf.useS)
-    xsi = x - B - A * y - S * x_delay;
-
-  A += xsi * ((y + eta * .000000001) ^ T) * epsA - A * dampA * epsA;
-  B += xsi * epsA * factorB - B * factorB * epsA * .02;
-  if (conf.useS)
-    S += xsi * (x_delay ^ T) * epsA - S * epsA * dampS;
+    xsi -= prod(S, x_delay);
+
+  // A += xsi * ((y + eta * .000000001) ^ T) * epsA - A * dampA * epsA;
+  y_eta.copy(y);
+  y_eta.axpy(.000000001, eta);
+  A *= 1.0 - dampA * epsA;
+  A.ger(xsi, y_eta, epsA);
+  // B += xsi * epsA * factorB - B * factorB * epsA * .02;
+  B.axpy(epsA * factorB, xsi, 1.0 - factorB * epsA * .02);
+  if (conf.useS) {
+    // S += xsi * (x_delay ^ T) * epsA - S * epsA * dampS;
+    S *= 1.0 - epsA * dampS;
+    S.ger(xsi, x_delay, epsA);
+  }
 
   for (int i = 0; i < number_motors; ++i) {
     G.val(i, i) = g_prime.val(i, 0);
@@ -339,9 +363,16 @@ DerInf::learnController(int delay) {
   //                      + L* xsi_buffer[(t-1+buffersize)%buffersize]
   //                      + xsi
   //                      )).multrowwise(g_prime);
-  eta = G * (A ^ T) * (x - xx);
-  const Matrix xsi1 = G * (A ^ T) * xsi;
-  DD += (eta * (eta ^ T) - xsi1 * (xsi1 ^ T) - DD) * zetaupdate;
+  // eta = G * (A ^ T) * (x - xx);
+  assign(GAT, prod(G, trans(A)));
+  x_err.copy(x);
+  x_err -= xx;
+  assign(eta, prod(GAT, x_err));
+  assign(xsi1, prod(GAT, xsi));
+  // DD += (eta * (eta ^ T) - xsi1 * (xsi1 ^ T) - DD) * zetaupdate;
+  DD *= 1.0 - zetaupdate;
+  DD.ger(eta, eta, zetaupdate);
+  DD.ger(xsi1, xsi1, -zetaupdate);
 
   //      RG = RG.map(random_minusone_to_one)*.03;
   //      RG += RG^T;
@@ -351,28 +382,40 @@ DerInf::learnController(int delay) {
   //         ^(-1))*A*G;
   //     DD = G*(A^T)*((RG + ((ID_Sensor^0) -  L * (L^T) ))^(-1))* A * G;;
   //    DD = DD  - xsi1*(xsi1^T);
-  xsistrength += ((((xsi ^ T) * xsi).val(0, 0)) / sensornumber - xsistrength) * .03;
+  xsistrength += (xsi.norm_sqr() / sensornumber - xsistrength) * .03;
   //  double Dfactor = 1/(xsistrength + .00001);
   //  Dinverse = (( ((DD*Dfactor)^-1)*.03 ).map(tanh))*3;
   ////   cout << DD.val(0,0)*Dfactor << __PLACEHOLDER_24__<<Dfactor<< endl;
 
   //  xx = x; yy = y;
+  // ups_i = (DD * C * (C ^ T))_ii
+  assign(DDC, prod(DD, C));
   for (int i = 0; i < number_motors; ++i) {
-    ups.val(i, 0) = (DD * C * (C ^ T)).val(i, i);
+    double u = 0;
+    for (int j = 0; j < sensornumber; ++j)
+      u += DDC.val(i, j) * C.val(i, j);
+    ups.val(i, 0) = u;
   }
 
-  EE = .3 / (((eta ^ T) * eta).val(0, 0) + .0000000001);
+  EE = .3 / (eta.norm_sqr() + .0000000001);
   //  EE = 1.0/(((ups^T)*ups).val(0,0)+.0000000001);//TEST
   //  EE = sqrt(EE);
   //    EE *= 1+sin(t/80);
 
-  ups = ups.multrowwise(yy) * -2 * sense;
+  ups.toMultrowwise(yy);
+  ups *= -2 * sense;
 
   // Lernen:
 
-  C_update = ((DD * C + ups * (xx ^ T))) * epsC * EE;
+  // C_update = ((DD * C + ups * (xx ^ T))) * epsC * EE;
+  C_update.copy(DDC);
+  C_update.ger(ups, xx);
+  C_update *= epsC * EE;
 
-  HY_update = (ups /*.map(g)*/) * (epsC)*EE - yy * creat;
+  // HY_update = (ups /*.map(g)*/) * (epsC)*EE - yy * creat;
+  HY_update.copy(ups);
+  HY_update *= epsC * EE;
+  HY_update.axpy(-creat, yy);
 
   //   C_update = ((DD * C + (DD * C * (C^T) ) * y * (xx^T)*(-2 * xsifactor)).map(g))*epsC*EE;
 
@@ -383,9 +426,15 @@ DerInf::learnController(int delay) {
 
   //  HY_update += x*-.003;//TEST
   if (epsC > 0) {
-    C -= (C - (C ^ 0)) /* *(C - (C^0)) *(C - (C^0)) */ * dampC;
-    H -= (H & H) * dampC;
-    HY -= (HY & HY) * .00000001;
+    // C -= (C - (C ^ 0)) /* *(C - (C^0)) *(C - (C^0)) */ * dampC;
+    C *= 1.0 - dampC;
+    for (I i = 0; i < std::min(C.getM(), C.getN()); ++i)
+      C.val(i, i) += dampC;
+    // H -= (H & H) * dampC;  HY -= (HY & HY) * .00000001;
+    for (I i = 0; i < H.getM(); ++i)
+      H.val(i, 0) -= H.val(i, 0) * H.val(i, 0) * dampC;
+    for (I i = 0; i < HY.getM(); ++i)
+      HY.val(i, 0) -= HY.val(i, 0) * HY.val(i, 0) * .00000001;
 
     //     C_update = C_update * gamma + C_updateOld * ( 1 - gamma );
     //     H_update = H_update * gamma + H_updateOld * ( 1 - gamma );
@@ -395,9 +444,9 @@ DerInf::learnController(int delay) {
     //     H_updateOld = H_update;
     //     HY_updateOld = HY_update;
 
-    C += (C_update).map(g) * .01; // weighting;
+    C.axpy(.01, C_update.toMap(g)); // weighting;
     //  H += H_update;
-    HY += (HY_update).map(g) * .01; // weighting*2;
+    HY.axpy(.01, HY_update.toMap(g)); // weighting*2;
     //     //    epsC=epsC_old;
 
     //      H*=0;
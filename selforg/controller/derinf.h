@@ -181,6 +181,10 @@ protected:
   matrix::Matrix x_intern;
   int num_iterations = 0;
 
+  // workspaces of the learning step (reused to avoid allocations)
+  matrix::Matrix C_update, HY_update, CH, z_iter, x_iter, y_delay, g_prime, y_eta, GAT, x_err,
+    xsi1, DDC;
+
   int t_rand = 0; ///< initial random time to avoid syncronous management of all controllers
   int t_delay = 0;
   int managementInterval = 0;     ///< interval between subsequent management function calls
@@ -29,24 +29,22 @@
 using namespace std;
 using namespace matrix;
 
-/**
- * ESN class implementation notes:
- * The constructor appears to be defined in the header file or the
- * initialization code below is orphaned from an old implementation.
- */
-// Orphaned constructor body code - commented out:
-// ESN::ESN(const ESNConf& conf) : InvertableModel("ESN", "1.0"), conf(conf) {
-//   addParameter("learningrate", &conf.learningrate, 0, 1, "learning rate");
-//   // nothing
-//   addInspectableMatrix("OutputWeights", &outputWeights, false, "output weights");
-//   addInspectableMatrix(
-//     "OutputDirectWeights", &outputDirectWeights, false, "direct input to output weights");
-//   if (conf.inspectInternals) {
-//     addInspectableMatrix("ESNState", &ESNState, false, "internal state");
-//     addInspectableMatrix("ESNWeights", &ESNWeights, false, "internal weights");
-//   }
-//   addInspectableValue("error", &error, "Learning error");
-// }
+ESN::ESN(const ESNConf& conf)
+  : InvertableModel("ESN", "1.0")
+  , conf(conf)
+  , nbInputs(0)
+  , nbOutputs(0)
+  , error(0)
+  , initialized(false) {
+  addParameter("learningrate", &this->conf.learningrate, 0, 1, "learning rate");
+  addInspectableMatrix("OutputWeights", &outputWeights, false, "output weights");
+  addInspectableMatrix(
+    "OutputDirectWeights", &outputDirectWeights, false, "direct input to output weights");
+  if (conf.inspectInternals) {
+    addInspectableMatrix("ESNState", &ESNState, false, "internal state");
+  }
+  addInspectableValue("error", &error, "Learning error");
+}
 
 void
 ESN::init(unsigned int inputDim, unsigned int outputDim, double unit_map, RandGen* randGen) {
@@ -64,7 +62,6 @@ ESN::init(unsigned int inputDim, unsigned int outputDim, double unit_map, RandGe
   outputDirectWeights.set(outputDim, inputDim);
   ESNState.set(conf.numNeurons, 1);
   ESNActivations.set(conf.numNeurons, 1);
-  ESNWeights.set(conf.numNeurons, conf.numNeurons);
   for (int count1 = 0; count1 < nbInputs; ++count1) {
     for (int count2 = 0; count2 < nbInputConnectionPN; ++count2) {
       int i = rand() % conf.numNeurons;
@@ -83,20 +80,29 @@ ESN::init(unsigned int inputDim, unsigned int outputDim, double unit_map, RandGe
   //         }
 
   outputDirectWeights = (outputDirectWeights ^ 0) * unit_map;
+  // the internal weights are sparse, for large reservoirs a dense matrix would
+  // dominate the memory and the costs of process()
+  std::vector<SparseMatrix::Triplet> connections;
+  connections.reserve(nbInternalConnection);
   for (int count = 0; count < nbInternalConnection; ++count) {
-    int i = rand() % conf.numNeurons;
-    int j = rand() % conf.numNeurons;
-    ESNWeights.val(i, j) = random_minusone_to_one(static_cast<void*>(randGen), 0);
+    unsigned int i = rand() % conf.numNeurons;
+    unsigned int j = rand() % conf.numNeurons;
+    connections.push_back({ i, j, random_minusone_to_one(static_cast<void*>(randGen), 0) });
   }
+  ESNWeights = SparseMatrix(conf.numNeurons, conf.numNeurons, connections);
 
-  // calculate the eigenvalues
+  // calculate the eigenvalues (exactly for small reservoirs if available)
+  double radius;
   Matrix real;
   Matrix img;
-  assert(eigenValues(ESNWeights, real, img));
-  Matrix abs = Matrix::map2(hypot, real, img); // calc absolute of complex number
-  //  abs.toSort();
-  // cout << (abs^T) << endl;
-  ESNWeights *= conf.spectralRadius / max(abs);
+  if (conf.numNeurons <= 1000 && eigenValues(ESNWeights.toDense(), real, img)) {
+    Matrix abs = Matrix::map2(hypot, real, img); // calc absolute of complex number
+    radius = max(abs);
+  } else {
+    radius = spectralRadius(ESNWeights);
+  }
+  if (radius > 0)
+    ESNWeights *= conf.spectralRadius / radius;
 
   initialized = true;
 }
@@ -104,7 +110,8 @@ ESN::init(unsigned int inputDim, unsigned int outputDim, double unit_map, RandGe
 const Matrix
 ESN::process(const Matrix& input) {
   assert(initialized);
-  ESNActivations = inputWeights * input + ESNWeights * ESNState;
+  ESNWeights.mult(ESNState, ESNActivations);
+  ESNActivations += inputWeights * input;
   ESNState = ESNActivations.map(tanh);
   return outputWeights * ESNState + outputDirectWeights * input;
 }
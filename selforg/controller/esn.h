@@ -27,6 +27,7 @@
 #include <cmath>
 #include <selforg/invertablemodel.h>
 #include <selforg/matrix.h>
+#include <selforg/sparsematrix.h>
 #include <cstdio>
 
 struct ESNConf {
@@ -133,7 +134,7 @@ protected:
   matrix::Matrix outputDirectWeights;
   matrix::Matrix ESNState;
   matrix::Matrix ESNActivations;
-  matrix::Matrix ESNWeights;
+  matrix::SparseMatrix ESNWeights; ///< internal weights, connectionRatio of them are nonzero
   double error;
   bool initialized;
 
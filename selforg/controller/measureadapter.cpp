@@ -62,6 +62,16 @@ MeasureAdapter::addSensorComplexMeasure(const char* measureName,
         case ENTSLOW:
           cm->addObservable(sensorValues.data()[i], -1.0, 1.0);
           break;
+        case MI: // between the sensor and the motor with the same index
+          cm->addObservable(sensorValues.data()[i], -1.0, 1.0);
+          if (i < controller->getMotorNumber())
+            cm->addObservable(motorValues.data()[i], -1.0, 1.0);
+          cm->setStepSize(stepSize);
+          break;
+        case PINF:
+          cm->addObservable(sensorValues.data()[i], -1.0, 1.0);
+          cm->setStepSize(stepSize);
+          break;
         default:
           break;
       }
@@ -28,8 +28,6 @@
 using namespace std;
 using namespace matrix;
 
-using rankingvector = vector<pair<double, int>>;
-
 NeuralGas::NeuralGas(const std::string& name, const std::string& revision)
   : AbstractModel(name, revision)
   , eps(0.1)
@@ -56,15 +54,14 @@ void
 NeuralGas::init(unsigned int inputDim, unsigned int outputDim, double unit_map, RandGen* randGen) {
   if (!randGen)
     randGen = new RandGen(); // this gives a small memory leak
-  weights.resize(outputDim);
-  diffvectors.resize(outputDim);
+  prototypes.init(inputDim, outputDim);
   double factor = (unit_map == 0) ? 1 : unit_map;
   // pure random initialised in the interval (-factor, factor) in all dimensions
+  Matrix w(inputDim, 1);
   for (unsigned int i = 0; i < outputDim; ++i) {
-    weights[i].set(inputDim, 1);
-    weights[i] = weights[i].mapP(randGen, random_minusone_to_one) * factor;
-    diffvectors[i].set(inputDim, 1);
+    prototypes.setPrototype(i, w.mapP(randGen, random_minusone_to_one) * factor);
   }
+  lastInput.set(inputDim, 1);
   distances.set(outputDim, 1);
 
   cellsizes.set(outputDim, 1);
@@ -87,12 +84,10 @@ ng_print_double(void* f, double d) {
 
 void
 NeuralGas::printWeights(FILE* f) const {
-  int k = 0;
   fprintf(f, "# weight elements, cellsize\n");
-  FOREACHC(vector<Matrix>, weights, i) {
-    (void)i->mapP(f, ng_print_double);
-    fprintf(f, "\t%f\n", cellsizes.val(k, 0));
-    ++k;
+  for (unsigned int i = 0; i < prototypes.size(); ++i) {
+    (void)prototypes.getPrototype(i).mapP(f, ng_print_double);
+    fprintf(f, "\t%f\n", cellsizes.val(i, 0));
   }
 }
 
@@ -103,36 +98,28 @@ NeuralGas::printCellsizes(FILE* f) const {
 
 const Matrix
 NeuralGas::process(const Matrix& input) {
-  unsigned int s = weights.size();
-  for (unsigned int i = 0; i < s; ++i) {
-    diffvectors[i] = (input - weights[i]);
-    double d = diffvectors[i].map(sqr).elementSum();
-    distances.val(i, 0) = d;
-  }
+  lastInput = input;
+  prototypes.distances(input, distances);
   return distances.map2(activationfunction, cellsizes, distances);
 }
 
 const Matrix
 NeuralGas::learn(const Matrix& input, const Matrix& nom_output, double learnRateFactor) {
   // __PLACEHOLDER_5__ of network already done in process
-  // rank by distance
-  rankingvector ranking(distances.getM());
-  for (int i = 0; i < (static_cast<int>(distances.getM())); ++i) {
-    ranking[i].first = distances.val(i, 0);
-    ranking[i].second = i;
-  }
-  std::sort(ranking.begin(), ranking.end());
-
-  int k = 0;
   double e = (maxTime == 0) ? eps * learnRateFactor
                             : eps * exp(-3.0 * t / static_cast<double>(maxTime)) * learnRateFactor;
   double l = (maxTime == 0) ? lambda : lambda * exp(-3.0 * t / static_cast<double>(maxTime));
-  FOREACHC(rankingvector, ranking, i) {
-    double e_l = exp(-k / l) * e;
-    if (e_l < e - 9)
+  // neurons with a learning rate below e*1e-9 are not adapted,
+  // so only the closest ones need to be ranked by distance
+  const unsigned int count = prototypes.size();
+  const unsigned int ranked =
+    static_cast<unsigned int>(min<double>(count, ceil(l * log(1e9)) + 1));
+  PrototypeSet::rank(distances.unsafeGetData(), count, ranked, ranking);
+  for (unsigned int k = 0; k < ranked; ++k) {
+    double e_l = exp(-static_cast<double>(k) / l) * e;
+    if (e_l < e * 1e-9)
       break;
-    weights[i->second] = weights[i->second] + diffvectors[i->second] * e_l;
-    ++k;
+    prototypes.moveTowards(ranking[k].second, lastInput.unsafeGetData(), e_l);
   }
   if (t % 100 == 0)
     updateCellSizes();
@@ -142,20 +129,13 @@ NeuralGas::learn(const Matrix& input, const Matrix& nom_output, double learnRate
 
 void
 NeuralGas::updateCellSizes() {
-  int k = 0;
-
-  unsigned int s = weights.size();
-
-  FOREACHC(vector<Matrix>, weights, w) {
-    Matrix dists(s, 1);
-    for (unsigned int i = 0; i < s; ++i) {
-      diffvectors[i] = (*w - weights[i]);
-      double d = diffvectors[i].map(sqr).elementSum();
-      dists.val(i, 0) = d;
-    }
-    double size = getKthSmallestElement(dists, 3);
-    cellsizes.val(k, 0) = size;
-    ++k;
+  vector<double> w(prototypes.getDim());
+  for (unsigned int i = 0; i < prototypes.size(); ++i) {
+    for (unsigned int j = 0; j < w.size(); ++j)
+      w[j] = prototypes.val(i, j);
+    // the third smallest distance (the closest neuron is the neuron itself)
+    prototypes.kNearest(w.data(), 3, ranking);
+    cellsizes.val(i, 0) = ranking.back().first;
   }
 }
 
@@ -169,8 +149,8 @@ NeuralGas::store(FILE* f) const {
 
   distances.store(f);
   cellsizes.store(f);
-  FOREACHC(vector<Matrix>, weights, w) {
-    w->store(f);
+  for (unsigned int i = 0; i < prototypes.size(); ++i) {
+    prototypes.getPrototype(i).store(f);
   }
   return true;
 }
@@ -197,13 +177,16 @@ NeuralGas::restore(FILE* f) {
 
   distances.restore(f);
   cellsizes.restore(f);
-  weights.clear();
-  diffvectors.clear();
+  vector<Matrix> weights(odim);
+  for (int i = 0; i < odim; ++i) {
+    if (!weights[i].restore(f))
+      return false;
+  }
+  const unsigned int idim = odim > 0 ? weights[0].getM() : 0;
+  prototypes.init(idim, odim);
   for (int i = 0; i < odim; ++i) {
-    Matrix w;
-    w.restore(f);
-    weights.push_back(w);
-    diffvectors.push_back(w); // overwritten anyway
+    prototypes.setPrototype(i, weights[i]);
   }
+  lastInput.set(idim, 1);
   return true;
 }
@@ -26,6 +26,7 @@
 
 #include "abstractmodel.h"
 #include "controller_misc.h"
+#include "prototypeset.h"
 
 #include <vector>
 
@@ -75,10 +76,10 @@ public:
   }
 
   virtual unsigned int getInputDim() const override {
-    return weights[0].getM();
+    return prototypes.getDim();
   }
   virtual unsigned int getOutputDim() const override {
-    return weights.size();
+    return prototypes.size();
   }
 
   virtual bool store(FILE* f) const override;
@@ -87,6 +88,12 @@ public:
   virtual void printWeights(FILE* f) const;
   virtual void printCellsizes(FILE* f) const;
 
+  /** switches the k-d tree for the computation of the cell sizes on or off.
+      This pays off for large numbers of neurons (some hundred and more). */
+  void setUseTree(bool useTree) {
+    prototypes.setUseTree(useTree);
+  }
+
 protected:
   /// updates the cell sizes
   void updateCellSizes();
@@ -99,9 +106,10 @@ public:
   double lambda = 3; ///< initial competitive constant for neighborhood learning
   int maxTime = 100; ///< maximal time for annealing
 private:
-  std::vector<matrix::Matrix> weights;
-  std::vector<matrix::Matrix> diffvectors; ///< temporary difference vectors
+  PrototypeSet prototypes;  ///< weights of all neurons
+  matrix::Matrix lastInput; ///< input of the last process() (used for learning)
   matrix::Matrix distances; ///< distances to all neurons
+  PrototypeSet::Ranking ranking; ///< neurons ranked by distance
   matrix::Matrix cellsizes; ///< cell sizes
   int t = 0; ///< time used for annealing
   bool initialised = false;
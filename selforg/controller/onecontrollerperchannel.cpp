@@ -25,17 +25,20 @@
 
 #include <cassert>
 #include <cstring>
+#include <typeinfo>
 
 OneControllerPerChannel::OneControllerPerChannel(ControllerGenerator* controllerGenerator,
                                                  std::string controllerName,
                                                  int numCtrlCreateBeforeInit,
-                                                 int numContextSensors)
+                                                 int numContextSensors,
+                                                 bool useBatch)
   : AbstractController(controllerName, "1")
   , controllerGenerator(controllerGenerator)
   , numCtrlCreateBeforeInit(numCtrlCreateBeforeInit)
   , numContextSensors(numContextSensors)
   , motornumber(0)
-  , sensornumber(0) {
+  , sensornumber(0)
+  , useBatch(useBatch) {
   for (int i = 0; i < numCtrlCreateBeforeInit; ++i) {
     AbstractController* c = (*controllerGenerator)(i);
     ctrl.push_back(c);
@@ -45,6 +48,7 @@ OneControllerPerChannel::OneControllerPerChannel(ControllerGenerator* controller
 }
 
 OneControllerPerChannel::~OneControllerPerChannel() {
+  delete batch;
   FOREACH(std::vector<AbstractController*>, ctrl, c) {
     delete *c;
   }
@@ -73,6 +77,18 @@ OneControllerPerChannel::init(const int sensornumber, const int motornumber, Ran
       addConfigurable(c);
     }
   }
+
+  // batch mode if all controllers are of the same type and support it
+  delete batch;
+  batch = 0;
+  if (useBatch && numContextSensors == 0 && motornumber > 0) {
+    bool homogeneous = true;
+    for (int i = 1; i < motornumber; ++i)
+      homogeneous = homogeneous && typeid(*ctrl[i]) == typeid(*ctrl[0]);
+    const ChannelBatchable* b = dynamic_cast<const ChannelBatchable*>(ctrl[0]);
+    if (homogeneous && b)
+      batch = b->createChannelBatch(ctrl);
+  }
 }
 
 void
@@ -81,7 +97,9 @@ OneControllerPerChannel::step(const sensor* sensors,
                               motor* motors,
                               int motornumber) {
   assert(static_cast<int>(ctrl.size()) == motornumber);
-  if (numContextSensors == 0) {
+  if (batch) {
+    batch->step(sensors, motors, motornumber, true);
+  } else if (numContextSensors == 0) {
     for (int i = 0; i < motornumber; ++i) {
       ctrl[i]->step(sensors + i, 1, motors + i, 1);
     }
@@ -103,7 +121,9 @@ OneControllerPerChannel::stepNoLearning(const sensor* sensors,
                                         int motornumber) {
   assert(static_cast<int>(ctrl.size()) == motornumber);
 
-  if (numContextSensors == 0) {
+  if (batch) {
+    batch->step(sensors, motors, motornumber, false);
+  } else if (numContextSensors == 0) {
     for (int i = 0; i < motornumber; ++i) {
       ctrl[i]->stepNoLearning(sensors + i, 1, motors + i, 1);
     }
@@ -26,6 +26,7 @@
 
 #include <functional>
 #include <selforg/abstractcontroller.h>
+#include <selforg/channelbatch.h>
 #include <vector>
 
 /** generator for controller
@@ -70,11 +71,14 @@ public:
      function is called. Useful if they should be put into the inspectable list of the agent
       @param numContextSensors number of context sensors (counted from the end)
        passed to all controllers
+      @param useBatch if true and all controllers are of the same type that supports it
+       (see ChannelBatchable) all channels are stepped in one batch (without context sensors)
    */
   OneControllerPerChannel(ControllerGenerator* controllerGenerator,
                           std::string controllerName,
                           int numCtrlCreateBeforeInit = 1,
-                          int numContextSensors = 0);
+                          int numContextSensors = 0,
+                          bool useBatch = true);
 
   virtual ~OneControllerPerChannel() override;
 
@@ -112,6 +116,8 @@ protected:
   int motornumber = 0;
   int sensornumber = 0;
   double* sensorbuffer = nullptr;
+  bool useBatch = true;
+  ChannelBatch* batch = nullptr; ///< used instead of the individual steps if not 0
 };
 
 #endif
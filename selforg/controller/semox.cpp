@@ -18,6 +18,7 @@
  ***************************************************************************/
 
 #include "semox.h"
+#include <selforg/matrixutils.h>
 #include <selforg/regularisation.h>
 using namespace matrix;
 using namespace std;
@@ -216,7 +217,7 @@ SeMoX::learnController() {
   // eta = A^-1 xsi (first shift in motor-space at current time)
   //  we use pseudoinverse eta = U^-1 A^T xsi, with U=A^T A + \lambda I
   //  it is additionally clipped to -1 to 1 via g (arbitrary choice)
-  const Matrix& eta = (A.pseudoInverse(0.001) * xsi).map(g);
+  const Matrix& eta = pseudoInverseSolve(A, xsi, 0.001).map(g);
 
   const Matrix& x = x_buffer[(t - 1) % buffersize];
   const Matrix& z = C * x + H;
@@ -226,7 +227,7 @@ SeMoX::learnController() {
 
   const Matrix zeta = eta.multrowwise(g_prime_inv); // G'(Z)^-1 * (eta+v)
   R = C * A;
-  const Matrix chi = ((R.multMT() + SmallID) ^ -1) * zeta;
+  const Matrix chi = Cholesky(R.multMT() + SmallID).solve(zeta);
   v = (R ^ T) * chi;
   // squash v to -3,3 (arbitrary choice)
   double size = 3;
@@ -239,22 +240,24 @@ SeMoX::learnController() {
   // scale of the additional terms (natural gradient with metric LL^T)
   if (teaching) {
     // scale of the additional terms
-    const Matrix& LLT_I = ((R & g_prime).multMT() + SmallID) ^ -1;
+    const Cholesky LLT((R & g_prime).multMT() + SmallID);
 
     if (gamma_cont != 0) { // learning to keep motorcommands smooth
       // the teaching signal is the previous motor command
       const Matrix& y = y_buffer[(t) % buffersize];
       const Matrix& y_tm1 = y_buffer[(t - 1) % buffersize];
       const Matrix& delta = (y_tm1 - y) & (g_prime);
-      C_updateTeaching += (LLT_I * delta * (x ^ T)) * (gamma_cont * epsC);
-      H_updateTeaching += LLT_I * delta * (gamma_cont * epsC);
+      const Matrix& LLT_I_delta = LLT.solve(delta);
+      C_updateTeaching += (LLT_I_delta * (x ^ T)) * (gamma_cont * epsC);
+      H_updateTeaching += LLT_I_delta * (gamma_cont * epsC);
     }
     if (intern_useTeaching && gamma_teach != 0) {
       const Matrix& y = y_buffer[(t - 1) % buffersize];
       const Matrix& xsi_local = y_teaching - y;
       const Matrix& delta = xsi_local.multrowwise(g_prime);
-      C_updateTeaching += (LLT_I * delta * (x ^ T)) * (gamma_teach * epsC);
-      H_updateTeaching += (LLT_I * delta) * (gamma_teach * epsC);
+      const Matrix& LLT_I_delta = LLT.solve(delta);
+      C_updateTeaching += (LLT_I_delta * (x ^ T)) * (gamma_teach * epsC);
+      H_updateTeaching += LLT_I_delta * (gamma_teach * epsC);
       intern_useTeaching =
         false; // after we applied teaching signal it is switched off until new signal is given
     }
@@ -416,7 +419,7 @@ void
 SeMoX::setSensorTeaching(const matrix::Matrix& teaching) {
   assert(teaching.getM() == number_sensors && teaching.getN() == 1);
   // calculate the y_teaching, that belongs to the distal teaching value by the inverse model.
-  y_teaching = (A.pseudoInverse(0.001) * (teaching - B)).mapP(0.95, clip);
+  y_teaching = pseudoInverseSolve(A, teaching - B, 0.001).mapP(0.95, clip);
   intern_useTeaching = true;
 }
 
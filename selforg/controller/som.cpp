@@ -59,24 +59,24 @@ SOM::init(unsigned int inputDim, unsigned int outputDim, double unit_map, RandGe
   double s = pow(outputDim, 1.0 / dimensions);
   size = static_cast<int>(round(s));
   assert(fabs(s - int(size)) < 0.001);
-  weights.resize(outputDim);
-  diffvectors.resize(outputDim);
+  prototypes.init(inputDim, outputDim);
 
   int input_cube_size = static_cast<int>(round(pow(outputDim, 1.0 / inputDim)));
   Matrix offset(inputDim, 1);
   offset.toMapP(unit_map, constant);
 
+  Matrix w(inputDim, 1);
   for (unsigned int i = 0; i < outputDim; ++i) {
-    weights[i].set(inputDim, 1);
     if (unit_map == 0) { // random
-      weights[i] = weights[i].mapP(randGen, random_minusone_to_one);
+      prototypes.setPrototype(i, w.mapP(randGen, random_minusone_to_one));
     } else { // uniform
-      weights[i] =
+      prototypes.setPrototype(
+        i,
         indexToCoord(i, input_cube_size, inputDim) * (2 * unit_map / (input_cube_size - 1)) -
-        offset;
+          offset);
     }
-    diffvectors[i].set(inputDim, 1);
   }
+  lastInput.set(inputDim, 1);
   distances.set(outputDim, 1);
 
   /// initialise neighbourhood
@@ -171,20 +171,16 @@ som_print_double(void* f, double d) {
 
 void
 SOM::printWeights(FILE* f) const {
-  FOREACHC(vector<Matrix>, weights, i) {
-    (void)i->mapP(f, som_print_double);
+  for (unsigned int i = 0; i < prototypes.size(); ++i) {
+    (void)prototypes.getPrototype(i).mapP(f, som_print_double);
     fprintf(f, "\n");
   }
 }
 
 const Matrix
 SOM::process(const Matrix& input) {
-  unsigned int s = weights.size();
-  for (unsigned int i = 0; i < s; ++i) {
-    diffvectors[i] = (input - weights[i]);
-    double d = diffvectors[i].map(sqr).elementSum();
-    distances.val(i, 0) = d;
-  }
+  lastInput = input;
+  prototypes.distances(input, distances);
 
   return distances.mapP(&rbfsize, activationfunction);
 }
@@ -198,8 +194,8 @@ SOM::learn(const Matrix& input, const Matrix& nom_output, double learnRateFactor
 
   Neighbours neighbs = getNeighbours(winner);
   FOREACH(Neighbours, neighbs, i) {
-    weights[i->first] =
-      weights[i->first] + diffvectors[i->first] * (eps * learnRateFactor * i->second);
+    prototypes.moveTowards(
+      i->first, lastInput.unsafeGetData(), eps * learnRateFactor * i->second);
     // printf(__PLACEHOLDER_5__, i->first, i->second);
     //    cout << __PLACEHOLDER_6__ << (weights[i->first]^T) <<;
     //    cout << __PLACEHOLDER_7__<< (diffvectors[i->first]^T) << endl;
@@ -217,8 +213,8 @@ SOM::store(FILE* f) const {
   fprintf(f, "%u\n", getOutputDim());
 
   distances.store(f);
-  FOREACHC(vector<Matrix>, weights, w) {
-    w->store(f);
+  for (unsigned int i = 0; i < prototypes.size(); ++i) {
+    prototypes.getPrototype(i).store(f);
   }
   return true;
 }
@@ -247,14 +243,17 @@ SOM::restore(FILE* f) {
   int odim = atoi(buffer);
 
   distances.restore(f);
-  weights.clear();
-  diffvectors.clear();
+  vector<Matrix> weights(odim);
+  for (int i = 0; i < odim; ++i) {
+    if (!weights[i].restore(f))
+      return false;
+  }
+  const unsigned int idim = odim > 0 ? weights[0].getM() : 0;
+  prototypes.init(idim, odim);
   for (int i = 0; i < odim; ++i) {
-    Matrix w;
-    w.restore(f);
-    weights.push_back(w);
-    diffvectors.push_back(w); // overwritten anyway
+    prototypes.setPrototype(i, weights[i]);
   }
+  lastInput.set(idim, 1);
   initNeighbourhood(sigma);
   return true;
 }
@@ -26,6 +26,7 @@
 
 #include "abstractmodel.h"
 #include "controller_misc.h"
+#include "prototypeset.h"
 
 #include <vector>
 
@@ -79,10 +80,10 @@ public:
   }
 
   virtual unsigned int getInputDim() const override {
-    return weights[0].getM();
+    return prototypes.getDim();
   }
   virtual unsigned int getOutputDim() const override {
-    return weights.size();
+    return prototypes.size();
   }
 
   virtual bool store(FILE* f) const override;
@@ -115,8 +116,8 @@ protected:
 public:
   double eps = 0; ///< learning rate for weight update
 private:
-  std::vector<matrix::Matrix> weights;
-  std::vector<matrix::Matrix> diffvectors; ///< temporary difference vectors
+  PrototypeSet prototypes;                 ///< weights of all neurons
+  matrix::Matrix lastInput;                ///< input of the last process() (used for learning)
   matrix::Matrix distances;                ///< vector of distances
   int dimensions = 0;                          ///< number of dimensions of lattice
   double sigma = 0;                            ///< neighbourhood size
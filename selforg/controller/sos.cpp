@@ -225,3 +225,157 @@ Sos::restore(FILE* f) {
   t = 0; // set time to zero to ensure proper filling of buffers
   return true;
 }
+
+/**
+ * Batch mode of Sos for OneControllerPerChannel: all channels (one sensor, one motor)
+ * are updated in one pass over arrays of the scalar state.
+ * The results are exactly those of the individual Sos::step calls.
+ * Parameters and the matrices A, C, h, b and v_avg are read from the
+ * controller objects in every step and written back. The sensor/motor buffers
+ * and the time are kept in the batch and the newest entries are written back
+ * as well, so the controllers stay valid (e.g. for step() without the batch).
+ */
+class SosChannelBatch : public ChannelBatch {
+public:
+  explicit SosChannelBatch(const std::vector<Sos*>& controllers)
+    : ctrl(controllers)
+    , y1(1, 1) {
+    const int n = ctrl.size();
+    for (std::vector<double>* v : { &A, &C, &h, &b, &v_avg, &x_smooth, &creativity, &epsC, &epsA })
+      v->resize(n);
+    t.resize(n);
+    s4avg.resize(n);
+    s4delay.resize(n);
+    loga.resize(n);
+    x_buf.resize(N * n);
+    y_buf.resize(N * n);
+    // take over the buffers (element k steps back is at (head + N - 1 - k) % N)
+    for (int i = 0; i < n; ++i) {
+      const Sos& s = *ctrl[i];
+      x_smooth[i] = s.x_smooth.val(0, 0);
+      t[i] = s.t;
+      for (int k = 0; k < N; ++k) {
+        x_buf[(N - 1 - k) * n + i] = s.x_buffer.get(k).val(0, 0);
+        y_buf[(N - 1 - k) * n + i] = s.y_buffer.get(k).val(0, 0);
+      }
+    }
+  }
+
+  virtual void step(const sensor* sensors, motor* motors, int channels, bool learn) override {
+    const int n = ctrl.size();
+    assert(channels == n);
+    for (int i = 0; i < n; ++i) { // gather
+      Sos& s = *ctrl[i];
+      s.s4avg = ::clip(s.s4avg, 1, N - 1);
+      if (learn)
+        s.s4delay = ::clip(s.s4delay, 1, N - 1);
+      A[i] = s.A.val(0, 0);
+      C[i] = s.C.val(0, 0);
+      h[i] = s.h.val(0, 0);
+      b[i] = s.b.val(0, 0);
+      v_avg[i] = s.v_avg.val(0, 0);
+      creativity[i] = s.creativity;
+      epsC[i] = s.epsC;
+      epsA[i] = s.epsA;
+      s4avg[i] = s.s4avg;
+      s4delay[i] = s.s4delay;
+      loga[i] = s.loga;
+    }
+
+    // controller (Sos::stepNoLearning)
+    double* xb = &x_buf[head * n];
+    double* yb = &y_buf[head * n];
+    for (int i = 0; i < n; ++i) {
+      if (s4avg[i] > 1)
+        x_smooth[i] += (sensors[i] - x_smooth[i]) * (1.0 / s4avg[i]);
+      else
+        x_smooth[i] = sensors[i];
+      xb[i] = x_smooth[i];
+      yb[i] = Sos::g(C[i] * (x_smooth[i] + (v_avg[i] * creativity[i])) + h[i]);
+      motors[i] = yb[i];
+      ++t[i];
+    }
+    head = (head + 1) % N;
+
+    if (learn) { // Sos::learn with scalars
+      const double* x_fut = &x_buf[((head + N - 1) % N) * n];
+      for (int i = 0; i < n; ++i) {
+        if (t[i] <= N)
+          continue;
+        const int k = (N - s4delay[i]) % N; // same element as x_buffer.get(-s4delay)
+        const int pos = ((head + N - 1 - k) % N) * n + i;
+        const double xd = x_buf[pos];
+        const double yd = y_buf[pos];
+        const double z = C[i] * (xd + v_avg[i] * creativity[i]) + h[i];
+        const double g_prime_inv = 1.0 / Sos::g_s(z);
+        const double xsi = x_fut[i] - (A[i] * yd + b[i]);
+
+        const double onA = epsA[i] > 0 ? 1 : 0;
+        A[i] += Sos::clip(0.1, xsi * yd * epsA[i] + (A[i] * -0.003) * onA);
+        b[i] += Sos::clip(0.1, xsi * epsA[i] + (b[i] * -0.001) * onA);
+
+        // pseudoinverse of A like Matrix::pseudoInverse (via the Cholesky factor)
+        const double R = A[i] * A[i];
+        double d = R > 0 ? R : R + 1e-8;
+        double Ainv;
+        if (d > 0) {
+          const double inv = 1.0 / sqrt(d);
+          Ainv = A[i] * inv * inv;
+        } else
+          Ainv = A[i] / d;
+        const double eta = Ainv * xsi;
+        const double zeta = Sos::clip(1.0, eta * g_prime_inv);
+        const double mue = (1 / (C[i] * C[i] + 1e-8)) * zeta;
+        const double v = Sos::clip(1.0, C[i] * mue);
+        v_avg[i] += (v - v_avg[i]) * .1;
+
+        double EE = 1.0;
+        if (loga[i])
+          EE = .1 / (v * v + .001);
+        const double my_z = mue * yd * zeta;
+        const double C_update = ((mue * v) + (my_z * (-2) * xd)) * (EE * epsC[i]);
+        const double h_update = my_z * (-2 * EE * epsC[i]);
+        h[i] += Sos::clip(.1, h_update);
+        C[i] += Sos::clip(.05, C_update);
+      }
+    }
+
+    for (int i = 0; i < n; ++i) { // scatter
+      Sos& s = *ctrl[i];
+      s.A.val(0, 0) = A[i];
+      s.C.val(0, 0) = C[i];
+      s.h.val(0, 0) = h[i];
+      s.b.val(0, 0) = b[i];
+      s.v_avg.val(0, 0) = v_avg[i];
+      s.t = t[i];
+      s.x.val(0, 0) = sensors[i];
+      s.x_smooth.val(0, 0) = x_smooth[i];
+      s.x_buffer.push(s.x_smooth);
+      y1.val(0, 0) = yb[i];
+      s.y_buffer.push(y1);
+    }
+  }
+
+private:
+  static constexpr int N = Sos::buffersize;
+  std::vector<Sos*> ctrl;
+  int head = 0; // next position in the buffers
+  std::vector<double> A, C, h, b, v_avg, x_smooth;
+  std::vector<double> creativity, epsC, epsA;
+  std::vector<int> t, s4avg, s4delay;
+  std::vector<char> loga;
+  std::vector<double> x_buf, y_buf; // N x channels
+  matrix::Matrix y1; // for writing back the motor value
+};
+
+ChannelBatch*
+Sos::createChannelBatch(const std::vector<AbstractController*>& controllers) const {
+  std::vector<Sos*> sos;
+  for (AbstractController* c : controllers) {
+    Sos* s = dynamic_cast<Sos*>(c);
+    if (!s || s->number_sensors != 1 || s->number_motors != 1)
+      return 0;
+    sos.push_back(s);
+  }
+  return new SosChannelBatch(sos);
+}
@@ -20,6 +20,7 @@
 #define __SOS_H
 
 #include <selforg/abstractcontroller.h>
+#include <selforg/channelbatch.h>
 #include <selforg/circular_buffer.h>
 #include <selforg/controller_misc.h>
 
@@ -32,7 +33,7 @@
  * This controller implements the standard algorihm described the Chapter 5 (Homeokinesis)
  *  of book __PLACEHOLDER_0__
  */
-class Sos : public AbstractController {
+class Sos : public AbstractController, public ChannelBatchable {
 
 public:
   explicit Sos(double init_feedback_strength = 1.0);
@@ -70,7 +71,13 @@ public:
   virtual matrix::Matrix geth();
   virtual void seth(const matrix::Matrix& h);
 
+  /// batch mode for OneControllerPerChannel (see SosChannelBatch)
+  virtual ChannelBatch* createChannelBatch(
+    const std::vector<AbstractController*>& controllers) const override;
+
 protected:
+  friend class SosChannelBatch;
+
   unsigned short number_sensors = 0;
   unsigned short number_motors = 0;
   static constexpr unsigned short buffersize = 10;
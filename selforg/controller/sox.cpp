@@ -18,7 +18,12 @@
  ***************************************************************************/
 
 #include "sox.h"
+#include <selforg/matrixutils.h>
+#include <selforg/matrixexpr.h>
 using namespace matrix;
+using matrix::expr::prod;
+using matrix::expr::trans;
+using matrix::expr::assign;
 using namespace std;
 
 Sox::Sox(const SoxConf& conf)
@@ -262,7 +267,11 @@ Sox::pseudoInvL(const Matrix& L, const Matrix& A, const Matrix& C) {
   } else {
     const Matrix& P = pseudo == 1 || pseudo == 2 ? A ^ T : C;
     const Matrix& Q = pseudo == 1 ? C ^ T : A;
-    return Q * ((P * L * Q) ^ (-1)) * P;
+    const Matrix& M = P * L * Q;
+    LU lu;
+    if (!lu.compute(M)) // singular (e.g. C or A is zero): use the regularized inverse
+      return Q * M.pseudoInverse() * P;
+    return Q * lu.solve(P);
   }
 }
 
@@ -276,28 +285,50 @@ Sox::learn() {
   const Matrix& y_creat = y_buffer.get(-max(s4delay, 1));
   const Matrix& x_fut = x_buffer.get(0); // future sensor (with respect to x,y)
 
-  const Matrix& xi = x_fut - (A * y_creat + b + S * x_delayed); // here we use creativity
-
-  const Matrix& z = (C * (x_delayed) + h); // here no creativity
-  const Matrix& y_ctrl = z.map(g);
-  const Matrix& g_prime = z.map(g_s);
-
-  L = A * C.multrowwise(g_prime) + S;
-  R = A * C + S; // this is only used for visualization
-
-  const Matrix& eta = A.pseudoInverse() * xi;
-  const Matrix& y_hat = y_ctrl + eta * causeaware;
+  // xi = x_fut - (A * y_creat + b + S * x_delayed); // here we use creativity
+  xi.copy(x_fut);
+  xi -= b;
+  xi -= prod(A, y_creat);
+  xi -= prod(S, x_delayed);
+
+  // z = C * x_delayed + h; // here no creativity
+  z.copy(h);
+  z += prod(C, x_delayed);
+  y_ctrl.copy(z);
+  y_ctrl.toMap(g);
+  g_prime.copy(z);
+  g_prime.toMap(g_s);
+
+  // L = A * C.multrowwise(g_prime) + S;
+  Cg.copy(C);
+  Cg.toMultrowwise(g_prime);
+  L.copy(S);
+  L += prod(A, Cg);
+  // R = A * C + S; // this is only used for visualization
+  R.copy(S);
+  R += prod(A, C);
+
+  const Matrix& eta = pseudoInverseSolve(A, xi);
+  y_hat.copy(y_ctrl);
+  y_hat.axpy(causeaware, eta); // y_hat = y_ctrl + eta * causeaware
 
   const Matrix& Lplus = pseudoInvL(L, A, C);
-  const Matrix& v = Lplus * xi;
-  const Matrix& chi = (Lplus ^ T) * v;
+  assign(v, prod(Lplus, xi));  // v = Lplus * xi
+  assign(chi, prod(trans(Lplus), v));  // chi = Lplus^T * v
 
-  const Matrix& mu = ((A ^ T) & g_prime) * chi;
-  const Matrix& epsrel = (mu & (C * v)) * (sense * 2);
+  // mu = ((A ^ T) & g_prime) * chi;
+  assign(mu, prod(trans(A), chi));
+  mu.toMultrowwise(g_prime);
+  // epsrel = (mu & (C * v)) * (sense * 2);
+  assign(Cv, prod(C, v));
+  epsrel.copy(mu);
+  epsrel.toMultrowwise(Cv);
+  epsrel *= sense * 2;
 
-  const Matrix& v_hat = v + x_delayed * harmony;
+  v_hat.copy(v);
+  v_hat.axpy(harmony, x_delayed); // v_hat = v + x_delayed * harmony
 
-  v_avg += (v - v_avg) * .1;
+  v_avg.axpy(.1, v, .9); // v_avg += (v - v_avg) * .1
 
   double EE = 1.0;
   if (loga) {
@@ -306,18 +337,48 @@ Sox::learn() {
   if (epsA > 0) {
     double epsS = epsA * conf.factorS;
     double epsb = epsA * conf.factorb;
-    A += (xi * (y_hat ^ T) * epsA).mapP(0.1, clip);
-    if (damping)
-      A += (((A_native - A).map(power3)) * damping).mapP(0.1, clip);
-    if (conf.useExtendedModel)
-      S += (xi * (x ^ T) * (epsS) + (S * -damping * 10)).mapP(0.1, clip);
-    b += (xi * (epsb) + (b * -damping)).mapP(0.1, clip);
+    // A += (xi * (y_hat ^ T) * epsA).mapP(0.1, clip);
+    assign(dA, prod(xi, trans(y_hat)) * epsA);
+    A += dA.toMapP(0.1, clip);
+    if (damping) {
+      dA.copy(A_native);
+      dA -= A;
+      dA.toMap(power3);
+      dA *= damping;
+      A += dA.toMapP(0.1, clip);
+    }
+    if (conf.useExtendedModel) {
+      // S += (xi * (x ^ T) * (epsS) + (S * -damping * 10)).mapP(0.1, clip);
+      assign(dS, prod(xi, trans(x)) * epsS);
+      dS.axpy(-damping * 10, S);
+      S += dS.toMapP(0.1, clip);
+    }
+    // b += (xi * (epsb) + (b * -damping)).mapP(0.1, clip);
+    db.copy(xi);
+    db *= epsb;
+    db.axpy(-damping, b);
+    b += db.toMapP(0.1, clip);
   }
   if (epsC > 0) {
-    C += ((mu * (v_hat ^ T) - epsrel.multrowwise(y_ctrl) * (x_delayed ^ T)) * (EE * epsC)).mapP(.05, clip);
-    if (damping)
-      C += (((C_native - C).map(power3)) * damping).mapP(.05, clip);
-    h += ((mu * harmony - epsrel.multrowwise(y_ctrl)) * (EE * epsC * conf.factorh)).mapP(.05, clip);
+    // C += ((mu * (v_hat ^ T) - epsrel.multrowwise(y_ctrl) * (x_delayed ^ T)) * (EE * epsC)).mapP(.05, clip);
+    eps_y.copy(epsrel);
+    eps_y.toMultrowwise(y_ctrl);
+    assign(dC, prod(mu, trans(v_hat)) * (EE * epsC));
+    dC -= prod(eps_y, trans(x_delayed)) * (EE * epsC);
+    C += dC.toMapP(.05, clip);
+    if (damping) {
+      dC.copy(C_native);
+      dC -= C;
+      dC.toMap(power3);
+      dC *= damping;
+      C += dC.toMapP(.05, clip);
+    }
+    // h += ((mu * harmony - epsrel.multrowwise(y_ctrl)) * (EE * epsC * conf.factorh)).mapP(.05, clip);
+    dh.copy(mu);
+    dh *= harmony;
+    dh -= eps_y;
+    dh *= EE * epsC * conf.factorh;
+    h += dh.toMapP(.05, clip);
 
     if (intern_isTeaching && gamma > 0) {
       // scale of the additional terms
@@ -349,7 +410,7 @@ Sox::setSensorTeaching(const matrix::Matrix& teaching) {
   assert(teaching.getM() == number_sensors && teaching.getN() == 1);
   // calculate the y_teaching,
   // that belongs to the distal teaching value by the inverse model.
-  y_teaching = (A.pseudoInverse() * (teaching - b)).mapP(0.95, clip);
+  y_teaching = pseudoInverseSolve(A, teaching - b).mapP(0.95, clip);
   intern_isTeaching = true;
 }
 
@@ -153,6 +153,10 @@ protected:
   matrix::Matrix x_smooth; // time average of x values
   int t = 0;
 
+  // workspaces of the learning step (reused to avoid allocations)
+  matrix::Matrix xi, z, y_ctrl, g_prime, Cg, y_hat, v, chi, mu, Cv, epsrel, v_hat, eps_y;
+  matrix::Matrix dA, dS, db, dC, dh;
+
   bool loga = false;
 
   SoxConf conf; ///< configuration objects
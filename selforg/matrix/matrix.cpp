@@ -7,9 +7,13 @@
 
 #include "matrix.h"
 #include "matrix_neon.h"
+#include "matrix_gemm.h"
+#include "matrixpool.h"
+#include "matrixutils.h"
 #include <cmath>
 #include <cstring>
 #include <algorithm>
+#include <utility>
 
 namespace matrix {
 
@@ -57,8 +61,7 @@ Matrix::Matrix(I _m, I _n, D def)
 Matrix&
 Matrix::operator=(Matrix&& c) noexcept {
   if (this != &c) {  // Self-assignment check
-    if (data)
-      free(data);
+    MatrixPool::release(data);
     m = c.m;
     n = c.n;
     buffersize = c.buffersize;
@@ -75,19 +78,16 @@ Matrix::operator=(Matrix&& c) noexcept {
 void
 Matrix::allocate() {
   if (m * n == 0) {
-    if (data)
-      free(data);
+    MatrixPool::release(data);
     data = 0;
     buffersize = 0;
   }
 
   if (m * n > buffersize) {
-    buffersize = m * n;
-    if (data)
-      free(data);
-
-    data = static_cast<D*>(malloc(sizeof(D) * buffersize));
-    assert(data);
+    MatrixPool::release(data);
+    // the pool may hand out a larger buffer, which is used for later growth
+    data = MatrixPool::alloc(m * n);
+    buffersize = static_cast<I>(MatrixPool::capacity(data));
   }
 }
 
@@ -282,18 +282,15 @@ Matrix&
 Matrix::toTranspose() {
   assert(buffersize > 0);
   if (m != 1 && n != 1) { // if m or n == 1 then no copying is necessary!
-    double* newdata = static_cast<double*>(malloc(sizeof(D) * buffersize));
-    if (newdata == 0) {
-      fprintf(stderr, "Matrix::toTranspose() memory allocation failed\n");
-      exit(1);
-    }
+    double* newdata = MatrixPool::alloc(buffersize);
     for (I i = 0; i < m; ++i) {
       for (I j = 0; j < n; ++j) {
         newdata[j * m + i] = data[i * n + j];
       }
     }
-    free(data);
+    MatrixPool::release(data);
     data = newdata;
+    buffersize = static_cast<I>(MatrixPool::capacity(data));
   }
   // swap n and m
   I t = m;
@@ -379,17 +376,8 @@ Matrix::mult(const Matrix& a, const Matrix& b) {
   // Use NEON optimized multiplication for ARM64
   MatrixNEON::mult_neon(a, b, *this);
 #else
-  // Standard scalar multiplication
-  D d;
-  for (I i = 0; i < m; ++i) {
-    for (I j = 0; j < n; ++j) {
-      d = 0;
-      for (I k = 0; k < interdim; ++k) {
-        d += a.val(i, k) * b.val(k, j);
-      }
-      VAL(i, j) = d;
-    }
-  }
+  // blocked and vectorized multiplication (kernel selected at runtime)
+  MatrixGEMM::gemm(false, false, m, n, a.n, D_One, a.data, a.n, b.data, b.n, D_Zero, data, n);
 #endif
 }
 
@@ -425,6 +413,68 @@ Matrix::toMult(const D& fac) {
   return *this;
 }
 
+Matrix&
+Matrix::gemm(const Matrix& a, bool transA, const Matrix& b, bool transB, const D& alpha,
+             const D& beta) {
+  const I M = transA ? a.n : a.m;
+  const I K = transA ? a.m : a.n;
+  const I N = transB ? b.m : b.n;
+  assert(K == (transB ? b.n : b.m));
+  if (&a == this || &b == this) { // the result must not overlap with the operands
+    Matrix result;
+    if (beta != 0)
+      result.copy(*this);
+    result.gemm(a, transA, b, transB, alpha, beta);
+    std::swap(m, result.m);
+    std::swap(n, result.n);
+    std::swap(buffersize, result.buffersize);
+    std::swap(data, result.data);
+    return *this;
+  }
+  if (beta == 0) {
+    m = M;
+    n = N;
+    allocate();
+  } else {
+    assert(m == M && n == N);
+  }
+  if (M * N == 0)
+    return *this;
+  if (K == 0) { // empty sum
+    toMult(beta);
+    return *this;
+  }
+  MatrixGEMM::gemm(transA, transB, M, N, K, alpha, a.data, a.n, b.data, b.n, beta, data, n);
+  return *this;
+}
+
+Matrix&
+Matrix::ger(const Matrix& x, const Matrix& y, const D& alpha) {
+  assert(x.isVector() && y.isVector() && x.size() == m && y.size() == n);
+  for (I i = 0; i < m; ++i) {
+    const D xi = alpha * x.data[i];
+    D* row = data + i * n;
+    for (I j = 0; j < n; ++j) {
+      row[j] += xi * y.data[j];
+    }
+  }
+  return *this;
+}
+
+Matrix&
+Matrix::axpy(const D& alpha, const Matrix& x, const D& beta) {
+  assert(x.m == m && x.n == n);
+  const I len = m * n;
+  if (beta == 1) {
+    for (I i = 0; i < len; ++i)
+      data[i] += alpha * x.data[i];
+  } else {
+    for (I i = 0; i < len; ++i)
+      data[i] = alpha * x.data[i] + beta * data[i];
+  }
+  return *this;
+}
+
 /* special  matrix power
     @see toExp
  */
@@ -487,14 +537,16 @@ Matrix::hasNormalEntries() const {
 
 Matrix
 Matrix::secureInverse() const {
-  // try first without lambda
-  const Matrix& Rinv = (*this) ^ (-1);
-  // if it has NAN or INF entries then regularize
-  if (Rinv.hasNormalEntries()) {
-    return Rinv;
-  } else {
-    return pseudoInverse(0.000001);
+  assert(m == n);
+  // try first without lambda (LU with partial pivoting)
+  LU lu(*this);
+  if (!lu.isSingular()) {
+    Matrix Rinv = lu.inverse();
+    // if it has NAN or INF entries then regularize
+    if (Rinv.hasNormalEntries())
+      return Rinv;
   }
+  return pseudoInverse(0.000001);
 }
 
 Matrix
@@ -505,15 +557,25 @@ Matrix::pseudoInverse(const D& lambda) const {
   else
     R = this->multMT();
 
-  // try first without lambda
-  Matrix Rinv = R ^ (-1);
-  // if it has NAN or INF entries then regularize
-  if (!Rinv.hasNormalEntries()) {
-    for (I i = 0; i < R.getM(); ++i) {
-      R.val(i, i) += lambda;
+  // R is symmetric positive semidefinite: solve with its Cholesky factors
+  // instead of inverting it, try first without lambda
+  Cholesky chol(R);
+  if (chol.isValid() || chol.compute(R, lambda)) {
+    if (m > n) { // (A^T A)^-1 A^T
+      Matrix X = *this ^ T;
+      chol.solveInPlace(X);
+      return X;
+    } else { // A^T (A A^T)^-1 = ((A A^T)^-1 A)^T
+      Matrix X(*this);
+      chol.solveInPlace(X);
+      return std::move(X) ^ T;
     }
-    Rinv = R ^ (-1);
   }
+  // not even positive definite with lambda (e.g. NAN entries): invert explicitly
+  for (I i = 0; i < R.getM(); ++i) {
+    R.val(i, i) += lambda;
+  }
+  const Matrix& Rinv = R ^ (-1);
   if (m > n)
     return Rinv * (*this ^ T);
   else
@@ -530,12 +592,18 @@ Matrix::toMap(D (*fun)(D)) {
 }
 
 Matrix
-Matrix::map(D (*fun)(D)) const {
+Matrix::map(D (*fun)(D)) const& {
   Matrix result(*this);
   result.toMap(fun);
   return result;
 }
 
+Matrix
+Matrix::map(D (*fun)(D)) && {
+  toMap(fun);
+  return std::move(*this);
+}
+
 Matrix&
 Matrix::toMapP(D param, D (*fun)(D, D)) {
   I len = m * n;
@@ -554,12 +622,18 @@ Matrix::toMapP(void* param, D (*fun)(void*, D)) {
 }
 
 Matrix
-Matrix::mapP(D param, D (*fun)(D, D)) const {
+Matrix::mapP(D param, D (*fun)(D, D)) const& {
   Matrix result(*this);
   result.toMapP(param, fun);
   return result;
 }
 
+Matrix
+Matrix::mapP(D param, D (*fun)(D, D)) && {
+  toMapP(param, fun);
+  return std::move(*this);
+}
+
 Matrix
 Matrix::mapP(void* param, D (*fun)(void*, D)) const {
   Matrix result(*this);
@@ -643,7 +717,15 @@ Matrix::toMultcolwise(const Matrix& factors) {
 Matrix&
 Matrix::toAbove(const Matrix& a) {
   assert(a.n == this->n);
-  data = static_cast<D*>(realloc(data, sizeof(D) * (this->m * this->n + a.n * a.m)));
+  const I newsize = this->m * this->n + a.n * a.m;
+  if (newsize > buffersize) {
+    D* newdata = MatrixPool::alloc(newsize);
+    if (data)
+      memcpy(newdata, data, sizeof(D) * this->m * this->n);
+    MatrixPool::release(data);
+    data = newdata;
+    buffersize = static_cast<I>(MatrixPool::capacity(data));
+  }
   memcpy(data + this->m * this->n, a.data, sizeof(D) * (a.n * a.m));
   this->m += a.m;
   return *this;
@@ -656,14 +738,13 @@ Matrix::toBeside(const Matrix& a) {
   D* oldData = data;
   I oldN = this->n;
   this->n += a.n;
-  buffersize = this->m * this->n;
-  data = static_cast<D*>(malloc(sizeof(D) * buffersize));
-  assert(data);
+  data = MatrixPool::alloc(this->m * this->n);
+  buffersize = static_cast<I>(MatrixPool::capacity(data));
   if (oldData) { // copy old values
     for (I i = 0; i < this->m * oldN; ++i) {
       data[(i / oldN) * this->n + (i % oldN)] = oldData[i];
     }
-    free(oldData);
+    MatrixPool::release(oldData);
   }
   if (a.data) { // copy new values for the new rows
     for (I i = 0; i < m; ++i) {
@@ -725,16 +806,7 @@ Matrix
 Matrix::multMT() const {
   assert(m != 0 && n != 0);
   Matrix result(m, m);
-  D d;
-  for (I i = 0; i < m; ++i) {
-    for (I j = 0; j < m; ++j) {
-      d = 0;
-      for (I k = 0; k < n; ++k) {
-        d += VAL(i, k) * VAL(j, k);
-      }
-      result.val(i, j) = d;
-    }
-  }
+  MatrixGEMM::gemm(false, true, m, m, n, D_One, data, n, data, n, D_Zero, result.data, m);
   return result;
 }
 
@@ -743,16 +815,7 @@ Matrix
 Matrix::multTM() const {
   assert(m != 0 && n != 0);
   Matrix result(n, n);
-  D d;
-  for (I i = 0; i < n; ++i) {
-    for (I j = 0; j < n; ++j) {
-      d = 0;
-      for (I k = 0; k < m; ++k) {
-        d += VAL(k, i) * VAL(k, j);
-      }
-      result.val(i, j) = d;
-    }
-  }
+  MatrixGEMM::gemm(true, false, n, n, m, D_One, data, n, data, n, D_Zero, result.data, n);
   return result;
 }
 
@@ -840,18 +903,17 @@ Matrix::removeColumns(I numberColumns) {
   // internal allocation
   D* oldData = data;
   I newN = n - numberColumns;
-  data = static_cast<D*>(malloc(sizeof(D) * m * newN));
-  assert(data);
+  data = MatrixPool::alloc(m * newN);
   if (oldData) { // copy old values
     for (I i = 0; i < m; ++i) {
       for (I j = 0; j < newN; ++j) {
         data[i * newN + j] = oldData[i * n + j];
       }
     }
-    free(oldData);
+    MatrixPool::release(oldData);
   }
   n = newN;
-  buffersize = m * n;
+  buffersize = static_cast<I>(MatrixPool::capacity(data));
   return *this;
 }
 
@@ -946,19 +1008,59 @@ Matrix::invert3x3() {
 // normal binary operators
 
 Matrix
-Matrix::operator+(const Matrix& sum) const {
+Matrix::operator+(const Matrix& sum) const& {
   Matrix result;
   result.add(*this, sum);
   return result;
 }
 
 Matrix
-Matrix::operator-(const Matrix& sum) const {
+Matrix::operator+(const Matrix& sum) && {
+  toSum(sum);
+  return std::move(*this);
+}
+
+Matrix
+Matrix::operator+(Matrix&& sum) const& {
+  sum.toSum(*this);
+  return std::move(sum);
+}
+
+Matrix
+Matrix::operator+(Matrix&& sum) && {
+  toSum(sum);
+  return std::move(*this);
+}
+
+Matrix
+Matrix::operator-(const Matrix& sum) const& {
   Matrix result;
   result.sub(*this, sum);
   return result;
 }
 
+Matrix
+Matrix::operator-(const Matrix& sum) && {
+  toDiff(sum);
+  return std::move(*this);
+}
+
+Matrix
+Matrix::operator-(Matrix&& sum) const& {
+  assert(sum.m == m && sum.n == n);
+  // this - sum, stored in the temporary sum
+  for (I i = 0; i < m * n; ++i) {
+    sum.data[i] = data[i] - sum.data[i];
+  }
+  return std::move(sum);
+}
+
+Matrix
+Matrix::operator-(Matrix&& sum) && {
+  toDiff(sum);
+  return std::move(*this);
+}
+
 /** matrix product*/
 Matrix
 Matrix::operator*(const Matrix& fac) const {
@@ -968,31 +1070,49 @@ Matrix::operator*(const Matrix& fac) const {
 }
 /** product with scalar (double)*/
 Matrix
-Matrix::operator*(const D& scalar) const {
+Matrix::operator*(const D& scalar) const& {
   Matrix result;
   result.mult(*this, scalar);
   return result;
 }
+
+Matrix
+Matrix::operator*(const D& scalar) && {
+  toMult(scalar);
+  return std::move(*this);
+}
 /** special matrix potence:
     @param exp -1 -> inverse; 0 -> Identity Matrix;
     1 -> itself; 2-> Matrix*Matrix^T
     T -> Transpose
 */
 Matrix
-Matrix::operator^(int exponent) const {
+Matrix::operator^(int exponent) const& {
   Matrix result(*this);
   result.toExp(exponent);
   return result;
 }
 
+Matrix
+Matrix::operator^(int exponent) && {
+  toExp(exponent);
+  return std::move(*this);
+}
+
 /// row-wise multiplication
 Matrix
-Matrix::operator&(const Matrix& b) const {
+Matrix::operator&(const Matrix& b) const& {
   Matrix result(*this);
   result.toMultrowwise(b);
   return result;
 }
 
+Matrix
+Matrix::operator&(const Matrix& b) && {
+  toMultrowwise(b);
+  return std::move(*this);
+}
+
 bool
 Matrix::operator==(const Matrix& c) const {
   if (m != c.m || n != c.n)
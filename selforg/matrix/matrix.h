@@ -16,6 +16,7 @@
 #include <cstdlib>
 #include <list>
 #include <selforg/storeable.h>
+#include "matrixpool.h"
 
 namespace matrix {
 
@@ -75,8 +76,7 @@ public:
   /// copy move constructor
   Matrix(Matrix&& c) noexcept;
   ~Matrix() {
-    if (data)
-      free(data);
+    MatrixPool::release(data);
   };
 
 public:
@@ -155,6 +155,10 @@ public:
   const D* unsafeGetData() const {
     return data;
   }
+  /// returns a pointer to the data for writing (size must not be changed). UNSAFE!!!
+  D* unsafeGetData() {
+    return data;
+  }
 
   /*       STOREABLE       */
   /** stores the Matrix into the given file stream (same as write)
@@ -207,10 +211,13 @@ public:
       \f[A^{+} = (A^T A + \lambda \mathbb I)^{-1}A^T\f]
       otherwise
       \f[A^{+} = A^T(A A^T + \lambda \mathbb I)^{-1}\f]
+      The inverse is not formed, the Cholesky factors are used instead.
+      lambda is only added if the matrix is not positive definite without.
+      To calculate \f$A^{+}B\f$ use pseudoInverseSolve() (matrixutils.h).
    */
   [[nodiscard]] Matrix pseudoInverse(const D& lambda = 1e-8) const;
 
-  /** calculates the secure inverse of a square matrix.
+  /** calculates the secure inverse of a square matrix (LU with partial pivoting).
       If singular then the pseudoinverse is used.
    */
   [[nodiscard]] Matrix secureInverse() const;
@@ -222,10 +229,14 @@ public:
   /**  maps the matrix to a new matrix
        with all elements mapped with the given function
   */
-  [[nodiscard]] Matrix map(D (*fun)(D)) const;
+  [[nodiscard]] Matrix map(D (*fun)(D)) const&;
+  /// map of a temporary: maps inplace and passes the buffer on
+  [[nodiscard]] Matrix map(D (*fun)(D)) &&;
   /**  like map but with additional double parameter for the mapping function
        (first argument of fun is parameter, the second is the value)*/
-  [[nodiscard]] Matrix mapP(D param, D (*fun)(D, D)) const;
+  [[nodiscard]] Matrix mapP(D param, D (*fun)(D, D)) const&;
+  /// mapP of a temporary: maps inplace and passes the buffer on
+  [[nodiscard]] Matrix mapP(D param, D (*fun)(D, D)) &&;
   /**  like map but with additional arbitrary parameter for the mapping function */
   [[nodiscard]] Matrix mapP(void* param, D (*fun)(void*, D)) const;
 
@@ -286,24 +297,37 @@ public: // normal binary Operators
   }
   /// deep copy move operator
   Matrix& operator=(Matrix&& c) noexcept;
+  /* The binary operators are overloaded for temporaries (rvalues):
+     in chains like (a - b) * s + c the intermediate results are reused
+     as destination, so only one buffer is allocated for the whole
+     element-wise chain. For lazy evaluation see matrixexpr.h */
   /// sum of two matrices
-  [[nodiscard]] Matrix operator+(const Matrix& sum) const;
+  [[nodiscard]] Matrix operator+(const Matrix& sum) const&;
+  [[nodiscard]] Matrix operator+(const Matrix& sum) &&;
+  [[nodiscard]] Matrix operator+(Matrix&& sum) const&;
+  [[nodiscard]] Matrix operator+(Matrix&& sum) &&;
   //    Matrix operator +  (const D& sum) const; /// new operator (guettler)
   /// difference of two matrices
-  [[nodiscard]] Matrix operator-(const Matrix& sum) const;
+  [[nodiscard]] Matrix operator-(const Matrix& sum) const&;
+  [[nodiscard]] Matrix operator-(const Matrix& sum) &&;
+  [[nodiscard]] Matrix operator-(Matrix&& sum) const&;
+  [[nodiscard]] Matrix operator-(Matrix&& sum) &&;
   /** matrix product*/
   [[nodiscard]] Matrix operator*(const Matrix& fac) const;
   /** product with scalar (D) (only right side) */
-  [[nodiscard]] Matrix operator*(const D& fac) const;
+  [[nodiscard]] Matrix operator*(const D& fac) const&;
+  [[nodiscard]] Matrix operator*(const D& fac) &&;
   /** special matrix potence:
       @param exponent -1 -> inverse;
                      0 -> Identity Matrix;
                   1 -> itself;
                   T -> Transpose
   */
-  [[nodiscard]] Matrix operator^(int exponent) const;
+  [[nodiscard]] Matrix operator^(int exponent) const&;
+  [[nodiscard]] Matrix operator^(int exponent) &&;
   /// row-wise multiplication
-  [[nodiscard]] Matrix operator&(const Matrix& b) const;
+  [[nodiscard]] Matrix operator&(const Matrix& b) const&;
+  [[nodiscard]] Matrix operator&(const Matrix& b) &&;
   /// combined assigment operator (higher performance)
   Matrix& operator+=(const Matrix& c) {
     toSum(c);
@@ -365,6 +389,23 @@ public:
   /// inplace multiplication with scalar: this = this*fac
   Matrix& toMult(const D& fac);
 
+  /** general multiplication with transposition flags and scaling (no temporaries):
+      this = alpha * op(a) * op(b) + beta * this, where op(X) is X or X^T.
+      If beta is zero then this is resized and its old content is ignored,
+      otherwise it must have the size of the product.
+      The operands may be this matrix. Usually written as product expression,
+      e.g. C += prod(a, trans(b)) * alpha (see matrixexpr.h).
+      @see MatrixGEMM::gemm
+  */
+  Matrix& gemm(const Matrix& a, bool transA, const Matrix& b, bool transB,
+               const D& alpha = 1, const D& beta = 0);
+  /** rank-1 update: this = this + alpha * x * y^T.
+      x and y are vectors (rows or columns) with getM() and getN() elements
+  */
+  Matrix& ger(const Matrix& x, const Matrix& y, const D& alpha = 1);
+  /// scaled addition in one pass: this = alpha * x + beta * this
+  Matrix& axpy(const D& alpha, const Matrix& x, const D& beta = 1);
+
   /** special inplace matrix power:
       @param exponent -1 -> inverse; (matrix MUST be SQUARE and NONZERO)
                   0 -> Identity Matrix;
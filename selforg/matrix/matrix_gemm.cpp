@@ -0,0 +1,447 @@
+/***************************************************************************
+ *   Cache-blocked, register-tiled matrix multiplication                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "matrix_gemm.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MATRIX_GEMM_X86
+#include <immintrin.h>
+#endif
+
+namespace matrix {
+
+namespace {
+
+// Blocking parameters (in elements). A packed MCxKC block of A stays in L2,
+// a KCxNR sliver of B in L1 while the micro-kernel streams over it.
+// MC must be a multiple of all MR and NC of all NR below.
+constexpr unsigned int KC = 256;
+constexpr unsigned int MC = 96;
+constexpr unsigned int NC = 1536;
+
+// below this number of multiply-adds (or for matrix-vector products)
+// the direct loop is faster than packing
+constexpr unsigned long SMALL_GEMM = 8 * 8 * 8;
+constexpr unsigned int SMALL_N = 4;
+
+/* micro-kernel: C[0..MR)[0..NR) += Ap * Bp
+   Ap is packed as kc columns of MR values, Bp as kc rows of NR values */
+using MicroKernel = void (*)(unsigned int kc, const double* Ap, const double* Bp, double* C,
+                             unsigned int ldc);
+
+struct KernelInfo {
+  MicroKernel fn;
+  unsigned int mr;
+  unsigned int nr;
+};
+
+void
+kernel_scalar_4x4(unsigned int kc, const double* a, const double* b, double* c,
+                  unsigned int ldc) {
+  double ab[4][4] = {};
+  for (unsigned int p = 0; p < kc; ++p) {
+    for (unsigned int i = 0; i < 4; ++i) {
+      for (unsigned int j = 0; j < 4; ++j) {
+        ab[i][j] += a[i] * b[j];
+      }
+    }
+    a += 4;
+    b += 4;
+  }
+  for (unsigned int i = 0; i < 4; ++i) {
+    for (unsigned int j = 0; j < 4; ++j) {
+      c[i * ldc + j] += ab[i][j];
+    }
+  }
+}
+
+#ifdef MATRIX_GEMM_X86
+
+__attribute__((target("sse2"))) void
+kernel_sse2_4x4(unsigned int kc, const double* a, const double* b, double* c,
+                unsigned int ldc) {
+  __m128d c00 = _mm_setzero_pd(), c01 = _mm_setzero_pd();
+  __m128d c10 = _mm_setzero_pd(), c11 = _mm_setzero_pd();
+  __m128d c20 = _mm_setzero_pd(), c21 = _mm_setzero_pd();
+  __m128d c30 = _mm_setzero_pd(), c31 = _mm_setzero_pd();
+  for (unsigned int p = 0; p < kc; ++p) {
+    const __m128d b0 = _mm_loadu_pd(b);
+    const __m128d b1 = _mm_loadu_pd(b + 2);
+    __m128d ai = _mm_set1_pd(a[0]);
+    c00 = _mm_add_pd(c00, _mm_mul_pd(ai, b0));
+    c01 = _mm_add_pd(c01, _mm_mul_pd(ai, b1));
+    ai = _mm_set1_pd(a[1]);
+    c10 = _mm_add_pd(c10, _mm_mul_pd(ai, b0));
+    c11 = _mm_add_pd(c11, _mm_mul_pd(ai, b1));
+    ai = _mm_set1_pd(a[2]);
+    c20 = _mm_add_pd(c20, _mm_mul_pd(ai, b0));
+    c21 = _mm_add_pd(c21, _mm_mul_pd(ai, b1));
+    ai = _mm_set1_pd(a[3]);
+    c30 = _mm_add_pd(c30, _mm_mul_pd(ai, b0));
+    c31 = _mm_add_pd(c31, _mm_mul_pd(ai, b1));
+    a += 4;
+    b += 4;
+  }
+#define GEMM_STORE_SSE2(row, lo, hi)                                                               \
+  _mm_storeu_pd(c + (row)*ldc, _mm_add_pd(_mm_loadu_pd(c + (row)*ldc), lo));                      \
+  _mm_storeu_pd(c + (row)*ldc + 2, _mm_add_pd(_mm_loadu_pd(c + (row)*ldc + 2), hi));
+  GEMM_STORE_SSE2(0, c00, c01)
+  GEMM_STORE_SSE2(1, c10, c11)
+  GEMM_STORE_SSE2(2, c20, c21)
+  GEMM_STORE_SSE2(3, c30, c31)
+#undef GEMM_STORE_SSE2
+}
+
+__attribute__((target("avx2,fma"))) void
+kernel_avx2_6x8(unsigned int kc, const double* a, const double* b, double* c,
+                unsigned int ldc) {
+  __m256d c00 = _mm256_setzero_pd(), c01 = _mm256_setzero_pd();
+  __m256d c10 = _mm256_setzero_pd(), c11 = _mm256_setzero_pd();
+  __m256d c20 = _mm256_setzero_pd(), c21 = _mm256_setzero_pd();
+  __m256d c30 = _mm256_setzero_pd(), c31 = _mm256_setzero_pd();
+  __m256d c40 = _mm256_setzero_pd(), c41 = _mm256_setzero_pd();
+  __m256d c50 = _mm256_setzero_pd(), c51 = _mm256_setzero_pd();
+  for (unsigned int p = 0; p < kc; ++p) {
+    const __m256d b0 = _mm256_loadu_pd(b);
+    const __m256d b1 = _mm256_loadu_pd(b + 4);
+    __m256d ai = _mm256_broadcast_sd(a);
+    c00 = _mm256_fmadd_pd(ai, b0, c00);
+    c01 = _mm256_fmadd_pd(ai, b1, c01);
+    ai = _mm256_broadcast_sd(a + 1);
+    c10 = _mm256_fmadd_pd(ai, b0, c10);
+    c11 = _mm256_fmadd_pd(ai, b1, c11);
+    ai = _mm256_broadcast_sd(a + 2);
+    c20 = _mm256_fmadd_pd(ai, b0, c20);
+    c21 = _mm256_fmadd_pd(ai, b1, c21);
+    ai = _mm256_broadcast_sd(a + 3);
+    c30 = _mm256_fmadd_pd(ai, b0, c30);
+    c31 = _mm256_fmadd_pd(ai, b1, c31);
+    ai = _mm256_broadcast_sd(a + 4);
+    c40 = _mm256_fmadd_pd(ai, b0, c40);
+    c41 = _mm256_fmadd_pd(ai, b1, c41);
+    ai = _mm256_broadcast_sd(a + 5);
+    c50 = _mm256_fmadd_pd(ai, b0, c50);
+    c51 = _mm256_fmadd_pd(ai, b1, c51);
+    a += 6;
+    b += 8;
+  }
+#define GEMM_STORE_AVX2(row, lo, hi)                                                               \
+  _mm256_storeu_pd(c + (row)*ldc, _mm256_add_pd(_mm256_loadu_pd(c + (row)*ldc), lo));             \
+  _mm256_storeu_pd(c + (row)*ldc + 4, _mm256_add_pd(_mm256_loadu_pd(c + (row)*ldc + 4), hi));
+  GEMM_STORE_AVX2(0, c00, c01)
+  GEMM_STORE_AVX2(1, c10, c11)
+  GEMM_STORE_AVX2(2, c20, c21)
+  GEMM_STORE_AVX2(3, c30, c31)
+  GEMM_STORE_AVX2(4, c40, c41)
+  GEMM_STORE_AVX2(5, c50, c51)
+#undef GEMM_STORE_AVX2
+}
+
+__attribute__((target("avx512f"))) void
+kernel_avx512_8x16(unsigned int kc, const double* a, const double* b, double* c,
+                   unsigned int ldc) {
+  __m512d c00 = _mm512_setzero_pd(), c01 = _mm512_setzero_pd();
+  __m512d c10 = _mm512_setzero_pd(), c11 = _mm512_setzero_pd();
+  __m512d c20 = _mm512_setzero_pd(), c21 = _mm512_setzero_pd();
+  __m512d c30 = _mm512_setzero_pd(), c31 = _mm512_setzero_pd();
+  __m512d c40 = _mm512_setzero_pd(), c41 = _mm512_setzero_pd();
+  __m512d c50 = _mm512_setzero_pd(), c51 = _mm512_setzero_pd();
+  __m512d c60 = _mm512_setzero_pd(), c61 = _mm512_setzero_pd();
+  __m512d c70 = _mm512_setzero_pd(), c71 = _mm512_setzero_pd();
+  for (unsigned int p = 0; p < kc; ++p) {
+    const __m512d b0 = _mm512_loadu_pd(b);
+    const __m512d b1 = _mm512_loadu_pd(b + 8);
+    __m512d ai = _mm512_set1_pd(a[0]);
+    c00 = _mm512_fmadd_pd(ai, b0, c00);
+    c01 = _mm512_fmadd_pd(ai, b1, c01);
+    ai = _mm512_set1_pd(a[1]);
+    c10 = _mm512_fmadd_pd(ai, b0, c10);
+    c11 = _mm512_fmadd_pd(ai, b1, c11);
+    ai = _mm512_set1_pd(a[2]);
+    c20 = _mm512_fmadd_pd(ai, b0, c20);
+    c21 = _mm512_fmadd_pd(ai, b1, c21);
+    ai = _mm512_set1_pd(a[3]);
+    c30 = _mm512_fmadd_pd(ai, b0, c30);
+    c31 = _mm512_fmadd_pd(ai, b1, c31);
+    ai = _mm512_set1_pd(a[4]);
+    c40 = _mm512_fmadd_pd(ai, b0, c40);
+    c41 = _mm512_fmadd_pd(ai, b1, c41);
+    ai = _mm512_set1_pd(a[5]);
+    c50 = _mm512_fmadd_pd(ai, b0, c50);
+    c51 = _mm512_fmadd_pd(ai, b1, c51);
+    ai = _mm512_set1_pd(a[6]);
+    c60 = _mm512_fmadd_pd(ai, b0, c60);
+    c61 = _mm512_fmadd_pd(ai, b1, c61);
+    ai = _mm512_set1_pd(a[7]);
+    c70 = _mm512_fmadd_pd(ai, b0, c70);
+    c71 = _mm512_fmadd_pd(ai, b1, c71);
+    a += 8;
+    b += 16;
+  }
+#define GEMM_STORE_AVX512(row, lo, hi)                                                             \
+  _mm512_storeu_pd(c + (row)*ldc, _mm512_add_pd(_mm512_loadu_pd(c + (row)*ldc), lo));             \
+  _mm512_storeu_pd(c + (row)*ldc + 8, _mm512_add_pd(_mm512_loadu_pd(c + (row)*ldc + 8), hi));
+  GEMM_STORE_AVX512(0, c00, c01)
+  GEMM_STORE_AVX512(1, c10, c11)
+  GEMM_STORE_AVX512(2, c20, c21)
+  GEMM_STORE_AVX512(3, c30, c31)
+  GEMM_STORE_AVX512(4, c40, c41)
+  GEMM_STORE_AVX512(5, c50, c51)
+  GEMM_STORE_AVX512(6, c60, c61)
+  GEMM_STORE_AVX512(7, c70, c71)
+#undef GEMM_STORE_AVX512
+}
+
+#endif // MATRIX_GEMM_X86
+
+KernelInfo
+kernelInfo(MatrixGEMM::Kernel kernel) {
+  switch (kernel) {
+#ifdef MATRIX_GEMM_X86
+    case MatrixGEMM::SSE2:
+      return { kernel_sse2_4x4, 4, 4 };
+    case MatrixGEMM::AVX2:
+      return { kernel_avx2_6x8, 6, 8 };
+    case MatrixGEMM::AVX512:
+      return { kernel_avx512_8x16, 8, 16 };
+#endif
+    default:
+      return { kernel_scalar_4x4, 4, 4 };
+  }
+}
+
+MatrixGEMM::Kernel
+bestKernel() {
+  if (MatrixGEMM::isSupported(MatrixGEMM::AVX512))
+    return MatrixGEMM::AVX512;
+  if (MatrixGEMM::isSupported(MatrixGEMM::AVX2))
+    return MatrixGEMM::AVX2;
+  if (MatrixGEMM::isSupported(MatrixGEMM::SSE2))
+    return MatrixGEMM::SSE2;
+  return MatrixGEMM::Scalar;
+}
+
+MatrixGEMM::Kernel&
+currentKernel() {
+  static MatrixGEMM::Kernel kernel = bestKernel();
+  return kernel;
+}
+
+/* packs the block op(A)[i0..i0+mc)[p0..p0+kc) into panels of mr rows
+   (zero padded), scaled by alpha */
+void
+packA(bool trans, const double* A, unsigned int lda, unsigned int i0, unsigned int p0,
+      unsigned int mc, unsigned int kc, unsigned int mr, double alpha, double* Ap) {
+  for (unsigned int ir = 0; ir < mc; ir += mr) {
+    const unsigned int rows = std::min(mr, mc - ir);
+    for (unsigned int p = 0; p < kc; ++p) {
+      for (unsigned int i = 0; i < rows; ++i) {
+        const unsigned int r = i0 + ir + i;
+        const unsigned int col = p0 + p;
+        *Ap++ = alpha * (trans ? A[col * lda + r] : A[r * lda + col]);
+      }
+      for (unsigned int i = rows; i < mr; ++i)
+        *Ap++ = 0;
+    }
+  }
+}
+
+/* packs the block op(B)[p0..p0+kc)[j0..j0+nc) into panels of nr columns
+   (zero padded) */
+void
+packB(bool trans, const double* B, unsigned int ldb, unsigned int p0, unsigned int j0,
+      unsigned int kc, unsigned int nc, unsigned int nr, double* Bp) {
+  for (unsigned int jr = 0; jr < nc; jr += nr) {
+    const unsigned int cols = std::min(nr, nc - jr);
+    for (unsigned int p = 0; p < kc; ++p) {
+      const unsigned int row = p0 + p;
+      if (!trans) {
+        memcpy(Bp, B + row * ldb + j0 + jr, cols * sizeof(double));
+        Bp += cols;
+      } else {
+        for (unsigned int j = 0; j < cols; ++j)
+          *Bp++ = B[(j0 + jr + j) * ldb + row];
+      }
+      for (unsigned int j = cols; j < nr; ++j)
+        *Bp++ = 0;
+    }
+  }
+}
+
+/// direct loops for small products (C is already scaled by beta)
+void
+gemmSmall(bool transA, bool transB, unsigned int M, unsigned int N, unsigned int K, double alpha,
+          const double* A, unsigned int lda, const double* B, unsigned int ldb, double* C,
+          unsigned int ldc) {
+  if (!transA && (transB || N < SMALL_N)) { // dot products of rows of A with columns of op(B)
+    const unsigned int bstride = transB ? 1 : ldb;
+    for (unsigned int i = 0; i < M; ++i) {
+      const double* a = A + i * lda;
+      double* c = C + i * ldc;
+      for (unsigned int j = 0; j < N; ++j) {
+        const double* b = transB ? B + j * ldb : B + j;
+        double d = 0;
+        for (unsigned int p = 0; p < K; ++p)
+          d += a[p] * b[p * bstride];
+        c[j] += alpha * d;
+      }
+    }
+    return;
+  }
+  for (unsigned int i = 0; i < M; ++i) {
+    double* c = C + i * ldc;
+    for (unsigned int p = 0; p < K; ++p) {
+      const double a = alpha * (transA ? A[p * lda + i] : A[i * lda + p]);
+      if (!transB) {
+        const double* b = B + p * ldb;
+        for (unsigned int j = 0; j < N; ++j)
+          c[j] += a * b[j];
+      } else {
+        for (unsigned int j = 0; j < N; ++j)
+          c[j] += a * B[j * ldb + p];
+      }
+    }
+  }
+}
+
+} // namespace
+
+void
+MatrixGEMM::gemm(bool transA, bool transB, unsigned int M, unsigned int N, unsigned int K,
+                 double alpha, const double* A, unsigned int lda, const double* B,
+                 unsigned int ldb, double beta, double* C, unsigned int ldc) {
+  if (M == 0 || N == 0)
+    return;
+  // C = beta * C
+  if (beta == 0) {
+    for (unsigned int i = 0; i < M; ++i)
+      memset(C + i * ldc, 0, N * sizeof(double));
+  } else if (beta != 1) {
+    for (unsigned int i = 0; i < M; ++i)
+      for (unsigned int j = 0; j < N; ++j)
+        C[i * ldc + j] *= beta;
+  }
+  if (K == 0 || alpha == 0)
+    return;
+
+  if (static_cast<unsigned long>(M) * N * K <= SMALL_GEMM || N < SMALL_N) {
+    gemmSmall(transA, transB, M, N, K, alpha, A, lda, B, ldb, C, ldc);
+    return;
+  }
+
+  const KernelInfo kernel = kernelInfo(currentKernel());
+  const unsigned int mr = kernel.mr;
+  const unsigned int nr = kernel.nr;
+
+  // packing buffers are kept per thread to avoid allocations in every call
+  thread_local std::vector<double> Abuf;
+  thread_local std::vector<double> Bbuf;
+  const unsigned int ncmax = std::min(NC, (N + nr - 1) / nr * nr);
+  const unsigned int mcmax = std::min(MC, (M + mr - 1) / mr * mr);
+  if (Abuf.size() < static_cast<size_t>(mcmax) * KC)
+    Abuf.resize(static_cast<size_t>(mcmax) * KC);
+  if (Bbuf.size() < static_cast<size_t>(ncmax) * KC)
+    Bbuf.resize(static_cast<size_t>(ncmax) * KC);
+  double* Ap = Abuf.data();
+  double* Bp = Bbuf.data();
+  double tile[8 * 16]; // scratch for partial tiles at the borders (max MR x NR)
+
+  for (unsigned int jc = 0; jc < N; jc += NC) {
+    const unsigned int nc = std::min(NC, N - jc);
+    for (unsigned int pc = 0; pc < K; pc += KC) {
+      const unsigned int kc = std::min(KC, K - pc);
+      packB(transB, B, ldb, pc, jc, kc, nc, nr, Bp);
+      for (unsigned int ic = 0; ic < M; ic += MC) {
+        const unsigned int mc = std::min(MC, M - ic);
+        packA(transA, A, lda, ic, pc, mc, kc, mr, alpha, Ap);
+        for (unsigned int jr = 0; jr < nc; jr += nr) {
+          const unsigned int cols = std::min(nr, nc - jr);
+          const double* bpanel = Bp + static_cast<size_t>(jr) * kc;
+          for (unsigned int ir = 0; ir < mc; ir += mr) {
+            const unsigned int rows = std::min(mr, mc - ir);
+            const double* apanel = Ap + static_cast<size_t>(ir) * kc;
+            double* c = C + static_cast<size_t>(ic + ir) * ldc + jc + jr;
+            if (rows == mr && cols == nr) {
+              kernel.fn(kc, apanel, bpanel, c, ldc);
+            } else {
+              memset(tile, 0, sizeof(double) * mr * nr);
+              kernel.fn(kc, apanel, bpanel, tile, nr);
+              for (unsigned int i = 0; i < rows; ++i)
+                for (unsigned int j = 0; j < cols; ++j)
+                  c[i * ldc + j] += tile[i * nr + j];
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+MatrixGEMM::Kernel
+MatrixGEMM::activeKernel() {
+  return currentKernel();
+}
+
+bool
+MatrixGEMM::setKernel(Kernel kernel) {
+  if (kernel == Auto) {
+    currentKernel() = bestKernel();
+    return true;
+  }
+  if (!isSupported(kernel))
+    return false;
+  currentKernel() = kernel;
+  return true;
+}
+
+bool
+MatrixGEMM::isSupported(Kernel kernel) {
+  switch (kernel) {
+    case Auto:
+    case Scalar:
+      return true;
+#ifdef MATRIX_GEMM_X86
+    case SSE2:
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("sse2");
+    case AVX2:
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    case AVX512:
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx512f");
+#endif
+    default:
+      return false;
+  }
+}
+
+const char*
+MatrixGEMM::kernelName(Kernel kernel) {
+  switch (kernel) {
+    case Auto:
+      return "auto";
+    case Scalar:
+      return "scalar";
+    case SSE2:
+      return "sse2";
+    case AVX2:
+      return "avx2+fma";
+    case AVX512:
+      return "avx512";
+  }
+  return "unknown";
+}
+
+} // namespace matrix
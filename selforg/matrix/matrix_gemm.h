@@ -0,0 +1,64 @@
+/***************************************************************************
+ *   Cache-blocked, register-tiled matrix multiplication                   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef __MATRIX_GEMM_H
+#define __MATRIX_GEMM_H
+
+namespace matrix {
+
+/** General matrix multiplication on raw row-major buffers:
+    \f[ C = \alpha\, op(A)\, op(B) + \beta C \f]
+    where op(X) is X or X^T.
+
+    Large products are computed by packing op(A) and op(B) into cache sized
+    panels and running a register-tiled micro-kernel over them.
+    The micro-kernel is chosen at runtime from the instruction sets supported
+    by the CPU (scalar, SSE2, AVX2+FMA or AVX-512), so one binary runs
+    everywhere and still uses the widest units available.
+    Small products take a direct loop since packing would not pay off.
+
+    This is the backend of Matrix::mult, Matrix::operator*,
+    Matrix::multMT and Matrix::multTM.
+ */
+class MatrixGEMM {
+public:
+  /// available micro-kernels
+  enum Kernel { Auto, Scalar, SSE2, AVX2, AVX512 };
+
+  /** computes C = alpha * op(A) * op(B) + beta * C
+      @param transA if true op(A) = A^T otherwise op(A) = A
+      @param transB if true op(B) = B^T otherwise op(B) = B
+      @param M number of rows of op(A) and C
+      @param N number of columns of op(B) and C
+      @param K number of columns of op(A) and rows of op(B)
+      @param lda,ldb,ldc row stride (leading dimension) of the buffers A, B and C
+      If beta is zero then C is not read (it may contain garbage).
+      C must not overlap with A or B.
+   */
+  static void gemm(bool transA, bool transB, unsigned int M, unsigned int N, unsigned int K,
+                   double alpha, const double* A, unsigned int lda, const double* B,
+                   unsigned int ldb, double beta, double* C, unsigned int ldc);
+
+  /// @return the micro-kernel that is currently used
+  static Kernel activeKernel();
+  /** forces the use of the given micro-kernel (Auto selects the best supported one).
+      Meant for testing and benchmarking; not thread safe.
+      @return false if the kernel is not supported by this CPU (nothing is changed then)
+   */
+  static bool setKernel(Kernel kernel);
+  /// @return true if the given kernel can be used on this CPU
+  static bool isSupported(Kernel kernel);
+  /// @return printable name of the kernel
+  static const char* kernelName(Kernel kernel);
+};
+
+} // namespace matrix
+
+#endif // __MATRIX_GEMM_H
@@ -0,0 +1,391 @@
+/***************************************************************************
+                          matrixexpr.h  -  description
+                             -------------------
+    email                : georg.martius@web.de
+***************************************************************************/
+// provides lazy expression templates for the Matrix class
+
+#ifndef __MATRIXEXPR_H
+#define __MATRIXEXPR_H
+
+#include "matrix.h"
+
+#include <type_traits>
+
+namespace matrix {
+
+/** Lazy evaluation of matrix expressions.
+
+    The normal Matrix operators evaluate eagerly and return a new Matrix
+    (temporaries are reused for rvalues, see Matrix::operator+).
+    The expressions in this namespace are only evaluated when they are assigned,
+    so a whole element-wise chain runs in one loop without any intermediate buffer
+    and products are written directly into an existing destination.
+
+    Element-wise expressions start with lazy():
+    \code
+    using namespace matrix::expr;
+    assign(x, lazy(a) * 0.5 + b - c);     // one loop, no temporary
+    y += mapped(lazy(x) - b, [](D v) { return v * v; }); // fused map
+    Matrix z = hadamard(a, lazy(b) + 1.0); // converts to Matrix on demand
+    \endcode
+    Products are expressed with prod() and trans():
+    \code
+    assign(mu, prod(trans(A), chi));  // mu = A^T * chi, A^T is not formed
+    C += prod(mu, trans(v)) * eps;    // C = C + eps * mu * v^T
+    \endcode
+    Sub-expressions keep references to the matrices they use, so an expression must
+    not outlive its operands. The destination may appear in an element-wise expression
+    as long as it has already the right size, and it may be an operand of prod().
+ */
+namespace expr {
+
+/// base class of all element-wise expressions (CRTP)
+template <typename E>
+class Expr {
+public:
+  const E& self() const {
+    return static_cast<const E&>(*this);
+  }
+  /// evaluates the expression into a new matrix
+  operator Matrix() const;
+};
+
+/// leaf expression: reference to a matrix
+class Ref : public Expr<Ref> {
+public:
+  explicit Ref(const Matrix& m)
+    : m(m.getM())
+    , n(m.getN())
+    , data(m.unsafeGetData()) {}
+  I getM() const {
+    return m;
+  }
+  I getN() const {
+    return n;
+  }
+  D operator[](I k) const {
+    return data[k];
+  }
+
+private:
+  I m, n;
+  const D* data;
+};
+
+/// element-wise binary operation of two expressions of the same size
+template <typename L, typename R, typename Op>
+class Binary : public Expr<Binary<L, R, Op>> {
+public:
+  Binary(const L& l, const R& r)
+    : l(l)
+    , r(r) {
+    assert(l.getM() == r.getM() && l.getN() == r.getN());
+  }
+  I getM() const {
+    return l.getM();
+  }
+  I getN() const {
+    return l.getN();
+  }
+  D operator[](I k) const {
+    return Op::apply(l[k], r[k]);
+  }
+
+private:
+  L l;
+  R r;
+};
+
+/// element-wise application of a function object
+template <typename E, typename F>
+class Unary : public Expr<Unary<E, F>> {
+public:
+  Unary(const E& e, F f)
+    : e(e)
+    , f(f) {}
+  I getM() const {
+    return e.getM();
+  }
+  I getN() const {
+    return e.getN();
+  }
+  D operator[](I k) const {
+    return f(e[k]);
+  }
+
+private:
+  E e;
+  F f;
+};
+
+struct Plus {
+  static D apply(D a, D b) {
+    return a + b;
+  }
+};
+struct Minus {
+  static D apply(D a, D b) {
+    return a - b;
+  }
+};
+struct Times {
+  static D apply(D a, D b) {
+    return a * b;
+  }
+};
+struct Scale {
+  D s;
+  D operator()(D x) const {
+    return x * s;
+  }
+};
+struct Shift {
+  D s;
+  D operator()(D x) const {
+    return x + s;
+  }
+};
+struct Negate {
+  D operator()(D x) const {
+    return -x;
+  }
+};
+
+/// starts a lazy expression with the given matrix
+inline Ref
+lazy(const Matrix& m) {
+  return Ref(m);
+}
+
+/// turns matrices and expressions into expression leaves
+inline Ref
+leaf(const Matrix& m) {
+  return Ref(m);
+}
+template <typename E>
+const E&
+leaf(const Expr<E>& e) {
+  return e.self();
+}
+
+#define MATRIXEXPR_BINARY(op, Op)                                                                  \
+  template <typename L, typename R>                                                                \
+  Binary<L, R, Op> operator op(const Expr<L>& l, const Expr<R>& r) {                             \
+    return Binary<L, R, Op>(l.self(), r.self());                                                   \
+  }                                                                                                \
+  template <typename L>                                                                            \
+  Binary<L, Ref, Op> operator op(const Expr<L>& l, const Matrix& r) {                            \
+    return Binary<L, Ref, Op>(l.self(), Ref(r));                                                   \
+  }                                                                                                \
+  template <typename R>                                                                            \
+  Binary<Ref, R, Op> operator op(const Matrix& l, const Expr<R>& r) {                            \
+    return Binary<Ref, R, Op>(Ref(l), r.self());                                                   \
+  }
+
+MATRIXEXPR_BINARY(+, Plus)
+MATRIXEXPR_BINARY(-, Minus)
+#undef MATRIXEXPR_BINARY
+
+/// element-wise product (like Matrix::map2 with multiplication)
+template <typename L, typename R>
+auto
+hadamard(const L& l, const R& r) {
+  return Binary<std::decay_t<decltype(leaf(l))>, std::decay_t<decltype(leaf(r))>, Times>(
+    leaf(l), leaf(r));
+}
+
+template <typename E>
+Unary<E, Scale>
+operator*(const Expr<E>& e, D s) {
+  return Unary<E, Scale>(e.self(), Scale{ s });
+}
+template <typename E>
+Unary<E, Scale>
+operator*(D s, const Expr<E>& e) {
+  return Unary<E, Scale>(e.self(), Scale{ s });
+}
+template <typename E>
+Unary<E, Scale>
+operator/(const Expr<E>& e, D s) {
+  return Unary<E, Scale>(e.self(), Scale{ 1.0 / s });
+}
+template <typename E>
+Unary<E, Shift>
+operator+(const Expr<E>& e, D s) {
+  return Unary<E, Shift>(e.self(), Shift{ s });
+}
+template <typename E>
+Unary<E, Shift>
+operator-(const Expr<E>& e, D s) {
+  return Unary<E, Shift>(e.self(), Shift{ -s });
+}
+template <typename E>
+Unary<E, Negate>
+operator-(const Expr<E>& e) {
+  return Unary<E, Negate>(e.self(), Negate());
+}
+
+/// element-wise application of fun (any callable D->D, e.g. a function pointer or lambda)
+template <typename A, typename F>
+auto
+mapped(const A& a, F fun) {
+  return Unary<std::decay_t<decltype(leaf(a))>, F>(leaf(a), fun);
+}
+
+/** evaluates the expression into dest (dest is resized if needed, otherwise its
+    buffer is reused)
+ */
+template <typename E>
+Matrix&
+assign(Matrix& dest, const Expr<E>& e) {
+  const E& x = e.self();
+  if (dest.getM() != x.getM() || dest.getN() != x.getN())
+    dest.set(x.getM(), x.getN());
+  D* d = dest.unsafeGetData();
+  const I len = x.getM() * x.getN();
+  for (I k = 0; k < len; ++k) {
+    d[k] = x[k];
+  }
+  return dest;
+}
+
+/// dest = dest + e (fused)
+template <typename E>
+Matrix&
+operator+=(Matrix& dest, const Expr<E>& e) {
+  const E& x = e.self();
+  assert(dest.getM() == x.getM() && dest.getN() == x.getN());
+  D* d = dest.unsafeGetData();
+  const I len = x.getM() * x.getN();
+  for (I k = 0; k < len; ++k) {
+    d[k] += x[k];
+  }
+  return dest;
+}
+
+/// dest = dest - e (fused)
+template <typename E>
+Matrix&
+operator-=(Matrix& dest, const Expr<E>& e) {
+  const E& x = e.self();
+  assert(dest.getM() == x.getM() && dest.getN() == x.getN());
+  D* d = dest.unsafeGetData();
+  const I len = x.getM() * x.getN();
+  for (I k = 0; k < len; ++k) {
+    d[k] -= x[k];
+  }
+  return dest;
+}
+
+template <typename E>
+Expr<E>::operator Matrix() const {
+  Matrix result;
+  assign(result, self());
+  return result;
+}
+
+/// marks a matrix as transposed inside of prod()
+struct Transposed {
+  const Matrix& m;
+};
+
+inline Transposed
+trans(const Matrix& m) {
+  return Transposed{ m };
+}
+
+/** lazy matrix product alpha * op(A) * op(B), evaluated by Matrix::gemm
+    directly into the destination
+ */
+class Product {
+public:
+  Product(const Matrix& a, bool transA, const Matrix& b, bool transB, D alpha = 1)
+    : a(a)
+    , b(b)
+    , transA(transA)
+    , transB(transB)
+    , alpha(alpha) {
+    assert((transA ? a.getM() : a.getN()) == (transB ? b.getN() : b.getM()));
+  }
+
+  I getM() const {
+    return transA ? a.getN() : a.getM();
+  }
+  I getN() const {
+    return transB ? b.getM() : b.getN();
+  }
+
+  Product operator*(D s) const {
+    return Product(a, transA, b, transB, alpha * s);
+  }
+  friend Product operator*(D s, const Product& p) {
+    return p * s;
+  }
+  Product operator-() const {
+    return Product(a, transA, b, transB, -alpha);
+  }
+
+  /** dest = alpha * op(A) * op(B) + beta * dest
+      (dest is resized if beta is zero, otherwise it must have the right size) */
+  void evalTo(Matrix& dest, D beta) const {
+    dest.gemm(a, transA, b, transB, alpha, beta);
+  }
+
+  /// evaluates the product into a new matrix
+  operator Matrix() const {
+    Matrix result(getM(), getN());
+    evalTo(result, 0);
+    return result;
+  }
+
+private:
+  const Matrix& a;
+  const Matrix& b;
+  bool transA;
+  bool transB;
+  D alpha;
+};
+
+inline Product
+prod(const Matrix& a, const Matrix& b) {
+  return Product(a, false, b, false);
+}
+inline Product
+prod(const Transposed& a, const Matrix& b) {
+  return Product(a.m, true, b, false);
+}
+inline Product
+prod(const Matrix& a, const Transposed& b) {
+  return Product(a, false, b.m, true);
+}
+inline Product
+prod(const Transposed& a, const Transposed& b) {
+  return Product(a.m, true, b.m, true);
+}
+
+/// evaluates the product into dest (dest is resized if needed)
+inline Matrix&
+assign(Matrix& dest, const Product& p) {
+  p.evalTo(dest, 0);
+  return dest;
+}
+
+/// dest = dest + p without temporary
+inline Matrix&
+operator+=(Matrix& dest, const Product& p) {
+  p.evalTo(dest, 1);
+  return dest;
+}
+
+/// dest = dest - p without temporary
+inline Matrix&
+operator-=(Matrix& dest, const Product& p) {
+  (-p).evalTo(dest, 1);
+  return dest;
+}
+
+} // namespace expr
+} // namespace matrix
+
+#endif // __MATRIXEXPR_H
@@ -0,0 +1,228 @@
+/***************************************************************************
+                          matrixpool.cpp  -  description
+                             -------------------
+    email                : georg.martius@web.de
+***************************************************************************/
+// provides a thread-local pool for the memory buffers of the Matrix class
+
+#include "matrixpool.h"
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+namespace matrix {
+
+namespace {
+
+// size classes: 2^MINSHIFT ... 2^MAXSHIFT doubles, larger buffers are not pooled
+constexpr unsigned int MINSHIFT = 2;
+constexpr unsigned int MAXSHIFT = 16;
+constexpr unsigned int NCLASSES = MAXSHIFT - MINSHIFT + 1;
+constexpr std::uint32_t NOCLASS = 0xFFFFFFFF;
+
+/* every buffer is preceded by this header (16 bytes, keeps the alignment of malloc).
+   A free buffer stores the next pointer of the free list in its first element. */
+struct Header {
+  std::uint32_t sizeclass;
+  std::uint32_t unused;
+  std::uint64_t capacity; // in doubles
+};
+static_assert(sizeof(Header) == 16, "header must keep 16 byte alignment");
+
+bool
+enabledFromEnvironment() {
+  const char* env = getenv("SELFORG_MATRIX_POOL");
+  return env && env[0] != '\0' && env[0] != '0';
+}
+
+std::atomic<bool> enabled(enabledFromEnvironment());
+std::atomic<std::size_t> maxPooledBytes(64 * 1024 * 1024);
+
+// life cycle of the pool of a thread (static matrices may be destroyed after it)
+enum PoolState { Unused, Alive, Destroyed };
+thread_local PoolState poolState = Unused;
+
+struct ThreadPool {
+  ThreadPool() {
+    poolState = Alive;
+  }
+  double* freelist[NCLASSES] = {};
+  MatrixPool::Stats stats;
+  MatrixPool::Stats stepStart;
+  MatrixPool::Stats lastStep;
+  int stepDepth = 0;
+
+  ~ThreadPool();
+  void trim(std::size_t keepBytes);
+};
+
+thread_local ThreadPool pool;
+
+inline ThreadPool&
+threadPool() {
+  return pool;
+}
+
+inline Header*
+header(const double* data) {
+  return reinterpret_cast<Header*>(const_cast<double*>(data)) - 1;
+}
+
+inline double*&
+nextFree(double* data) {
+  return *reinterpret_cast<double**>(data);
+}
+
+double*
+systemAlloc(std::uint32_t sizeclass, std::size_t capacity) {
+  Header* h = static_cast<Header*>(malloc(sizeof(Header) + capacity * sizeof(double)));
+  assert(h);
+  h->sizeclass = sizeclass;
+  h->unused = 0;
+  h->capacity = capacity;
+  return reinterpret_cast<double*>(h + 1);
+}
+
+ThreadPool::~ThreadPool() {
+  trim(0);
+  poolState = Destroyed;
+}
+
+void
+ThreadPool::trim(std::size_t keepBytes) {
+  // release the largest buffers first
+  for (unsigned int c = NCLASSES; c-- > 0 && stats.pooledBytes > keepBytes;) {
+    while (freelist[c] && stats.pooledBytes > keepBytes) {
+      double* data = freelist[c];
+      freelist[c] = nextFree(data);
+      stats.pooledBytes -= header(data)->capacity * sizeof(double);
+      stats.frees++;
+      free(header(data));
+    }
+  }
+}
+
+} // namespace
+
+double*
+MatrixPool::alloc(std::size_t elements) {
+  if (elements == 0)
+    elements = 1;
+  if (poolState == Destroyed)
+    return systemAlloc(NOCLASS, elements);
+  ThreadPool& p = threadPool();
+  p.stats.requests++;
+  if (!enabled.load(std::memory_order_relaxed)) {
+    p.stats.mallocs++;
+    return systemAlloc(NOCLASS, elements);
+  }
+  unsigned int shift = MINSHIFT;
+  while ((std::size_t(1) << shift) < elements && shift <= MAXSHIFT)
+    ++shift;
+  if (shift > MAXSHIFT) {
+    p.stats.mallocs++;
+    return systemAlloc(NOCLASS, elements);
+  }
+  const unsigned int c = shift - MINSHIFT;
+  const std::size_t capacity = std::size_t(1) << shift;
+  if (double* data = p.freelist[c]) {
+    p.freelist[c] = nextFree(data);
+    p.stats.pooledBytes -= capacity * sizeof(double);
+    p.stats.recycled++;
+    return data;
+  }
+  p.stats.mallocs++;
+  return systemAlloc(c, capacity);
+}
+
+void
+MatrixPool::release(double* data) {
+  if (!data)
+    return;
+  Header* h = header(data);
+  if (poolState == Destroyed) {
+    free(h);
+    return;
+  }
+  ThreadPool& p = threadPool();
+  if (h->sizeclass == NOCLASS || !enabled.load(std::memory_order_relaxed)) {
+    p.stats.frees++;
+    free(h);
+    return;
+  }
+  const std::size_t bytes = h->capacity * sizeof(double);
+  if (p.stats.pooledBytes + bytes > maxPooledBytes.load(std::memory_order_relaxed)) {
+    p.stats.frees++;
+    free(h);
+    return;
+  }
+  nextFree(data) = p.freelist[h->sizeclass];
+  p.freelist[h->sizeclass] = data;
+  p.stats.pooledBytes += bytes;
+}
+
+std::size_t
+MatrixPool::capacity(const double* data) {
+  return data ? header(data)->capacity : 0;
+}
+
+void
+MatrixPool::setEnabled(bool on) {
+  enabled = on;
+}
+
+bool
+MatrixPool::isEnabled() {
+  return enabled;
+}
+
+void
+MatrixPool::setMaxPooledBytes(std::size_t bytes) {
+  maxPooledBytes = bytes;
+}
+
+std::size_t
+MatrixPool::getMaxPooledBytes() {
+  return maxPooledBytes;
+}
+
+MatrixPool::Stats
+MatrixPool::stats() {
+  return threadPool().stats;
+}
+
+MatrixPool::Stats
+MatrixPool::lastStep() {
+  return threadPool().lastStep;
+}
+
+void
+MatrixPool::trim() {
+  threadPool().trim(0);
+}
+
+MatrixPool::StepScope::StepScope() {
+  ThreadPool& p = threadPool();
+  outermost = (p.stepDepth++ == 0);
+  if (outermost)
+    p.stepStart = p.stats;
+}
+
+MatrixPool::StepScope::~StepScope() {
+  ThreadPool& p = threadPool();
+  p.stepDepth--;
+  if (!outermost)
+    return;
+  p.lastStep.requests = p.stats.requests - p.stepStart.requests;
+  p.lastStep.recycled = p.stats.recycled - p.stepStart.recycled;
+  p.lastStep.mallocs = p.stats.mallocs - p.stepStart.mallocs;
+  p.lastStep.frees = p.stats.frees - p.stepStart.frees;
+  p.lastStep.pooledBytes = p.stats.pooledBytes;
+  if (p.stats.pooledBytes > maxPooledBytes.load(std::memory_order_relaxed))
+    p.trim(maxPooledBytes);
+}
+
+} // namespace matrix
@@ -0,0 +1,80 @@
+/***************************************************************************
+                          matrixpool.h  -  description
+                             -------------------
+    email                : georg.martius@web.de
+***************************************************************************/
+// provides a thread-local pool for the memory buffers of the Matrix class
+
+#ifndef __MATRIXPOOL_H
+#define __MATRIXPOOL_H
+
+#include <cstddef>
+
+namespace matrix {
+
+/** Thread-local size-class pool for Matrix buffers.
+
+    All buffers of Matrix are obtained with alloc() and given back with release().
+    If the pool is disabled (default) these are plain malloc/free calls.
+    If enabled, the buffer sizes are rounded up to powers of two and released buffers
+    are kept in per-thread free lists, so the many short-lived temporaries of a control
+    step reuse the memory of the previous step instead of going to malloc.
+    A buffer may be released in another thread than it was allocated in.
+
+    The pool is enabled with setEnabled() or by setting the environment
+    variable SELFORG_MATRIX_POOL=1.
+
+    A StepScope marks one control step (WiredController::step uses one).
+    It collects the allocation counters of the step (see lastStep())
+    and trims the free lists if they grew beyond getMaxPooledBytes().
+ */
+class MatrixPool {
+public:
+  /// allocation counters (per thread)
+  struct Stats {
+    unsigned long requests = 0;  ///< number of buffer requests
+    unsigned long recycled = 0;  ///< requests served from the free lists
+    unsigned long mallocs = 0;   ///< requests that called malloc
+    unsigned long frees = 0;     ///< buffers given back to the system (free)
+    std::size_t pooledBytes = 0; ///< bytes currently kept in the free lists
+  };
+
+  /** marks a step: on destruction the counters of the step are stored as lastStep()
+      and the free lists are trimmed. Scopes can be nested, only the outermost counts. */
+  class StepScope {
+  public:
+    StepScope();
+    ~StepScope();
+    StepScope(const StepScope&) = delete;
+    StepScope& operator=(const StepScope&) = delete;
+
+  private:
+    bool outermost;
+  };
+
+  /// @return a buffer for at least the given number of doubles (never null)
+  static double* alloc(std::size_t elements);
+  /// gives the buffer back (null is ignored)
+  static void release(double* data);
+  /// @return the number of doubles that fit into the buffer
+  static std::size_t capacity(const double* data);
+
+  /// switches pooling on or off (for all threads)
+  static void setEnabled(bool enabled);
+  static bool isEnabled();
+
+  /// sets the maximum number of bytes kept in the free lists of each thread
+  static void setMaxPooledBytes(std::size_t bytes);
+  static std::size_t getMaxPooledBytes();
+
+  /// @return the counters of the calling thread since its start
+  static Stats stats();
+  /// @return the counters of the last finished StepScope of the calling thread
+  static Stats lastStep();
+  /// returns all cached buffers of the calling thread to the system
+  static void trim();
+};
+
+} // namespace matrix
+
+#endif // __MATRIXPOOL_H
@@ -5,15 +5,60 @@
 ***************************************************************************/
 
 #include "matrixutils.h"
+#include <algorithm>
 #include <cmath>
+#include <complex>
+#include <cstring>
+#include <limits>
+#include <utility>
 
 #ifndef NO_GSL
 #include <gsl/gsl_eigen.h>
+#include <gsl/gsl_errno.h>
 #include <gsl/gsl_matrix.h>
+#endif
+
+namespace matrix {
+using Complex = std::complex<D>;
+
+struct EigenSolver::Workspace {
+  ~Workspace() {
+#ifndef NO_GSL
+    release();
+#endif
+  }
+
+  /** eigenvalues and eigenvectors of the small matrix T by the complex Schur
+      decomposition T = U S U^H (Hessenberg reduction and shifted QR steps with
+      Givens rotations). The result is in vals and in the columns of vecs,
+      order gives the indices with descending absolute value of the eigenvalues. */
+  bool schur(const Matrix& T);
 
+  std::vector<Complex> S, U, x; // Schur form, Schur vectors, back substitution
+  std::vector<D> rc;            // Givens rotations of a QR step
+  std::vector<Complex> rs;
+  std::vector<Complex> vals, vecs;
+  std::vector<I> order;
+
+#ifndef NO_GSL
+  void release();
+
+  std::size_t n = 0; // size of the GSL workspaces
+  gsl_matrix* m = nullptr;
+  gsl_vector_complex* eval = nullptr;
+  gsl_matrix_complex* evec = nullptr;
+  gsl_eigen_nonsymm_workspace* w = nullptr;
+  gsl_eigen_nonsymmv_workspace* wv = nullptr;
+#endif
+};
+}
+
+#ifndef NO_GSL
 namespace matrix {
 /// copies our matrix into a gsl matrix (don't forget gsl_matrix_free)
 gsl_matrix* toGSL(const Matrix& src);
+/// copies our matrix into the gsl matrix dst of the same size
+void toGSL(const Matrix& src, gsl_matrix* dst);
 /// copies gsl matrix to our matrix
 Matrix fromGSL(const gsl_matrix* src);
 /// copies gsl vector to our matrix (column-vector)
@@ -66,60 +111,75 @@ eigenValuesVectorsRealSym(const Matrix& m, Matrix& eigenvalues, Matrix& eigenvec
   return true;
 }
 
+void
+EigenSolver::Workspace::release() {
+  if (m)
+    gsl_matrix_free(m);
+  if (eval)
+    gsl_vector_complex_free(eval);
+  if (evec)
+    gsl_matrix_complex_free(evec);
+  if (w)
+    gsl_eigen_nonsymm_free(w);
+  if (wv)
+    gsl_eigen_nonsymmv_free(wv);
+  m = nullptr;
+  eval = nullptr;
+  evec = nullptr;
+  w = nullptr;
+  wv = nullptr;
+  n = 0;
+}
+
 // check for exception:
 // gsl: francis.c:210: ERROR: maximum iterations reached without finding all eigenvalues
 // Default GSL error handler invoked.
 bool
-eigenValues(const Matrix& m, Matrix& real, Matrix& imag) {
-  // check if m is square
-  assert(m.getM() == m.getN());
-  gsl_matrix* m_gsl = toGSL(m);
-  gsl_set_error_handler_off();
-
-  gsl_eigen_nonsymm_workspace* w = gsl_eigen_nonsymm_alloc(m.getM());
-  gsl_vector_complex* eval = gsl_vector_complex_alloc(m.getM());
-
-  gsl_eigen_nonsymm(m_gsl, eval, w);
-  gsl_eigen_nonsymm_free(w);
-  gsl_eigen_nonsymmv_sort(eval, 0, GSL_EIGEN_SORT_ABS_DESC);
-  gsl_vector_view eval_real = gsl_vector_complex_real(eval);
-  gsl_vector_view eval_imag = gsl_vector_complex_imag(eval);
-  real = fromGSL(&eval_real.vector);
-  imag = fromGSL(&eval_imag.vector);
-  gsl_matrix_free(m_gsl);
-  gsl_vector_complex_free(eval);
-  return true;
-}
-
-bool
-eigenValuesVectors(const Matrix& m,
-                   Matrix& vals_real,
-                   Matrix& vals_imag,
-                   Matrix& vecs_real,
-                   Matrix& vecs_imag) {
-  // check if m is square
-  assert(m.getM() == m.getN());
-  gsl_matrix* m_gsl = toGSL(m);
+EigenSolver::computeFull(const Matrix& m, bool vectors) {
+  const I n = m.getM();
+  Workspace& g = *ws;
+  if (g.n != n) {
+    g.release();
+    g.n = n;
+    g.m = gsl_matrix_alloc(n, n);
+    g.eval = gsl_vector_complex_alloc(n);
+  }
+  if (vectors && !g.wv) {
+    g.evec = gsl_matrix_complex_alloc(n, n);
+    g.wv = gsl_eigen_nonsymmv_alloc(n);
+  }
+  if (!vectors && !g.w)
+    g.w = gsl_eigen_nonsymm_alloc(n);
+  toGSL(m, g.m);
   gsl_set_error_handler_off();
 
-  gsl_eigen_nonsymmv_workspace* w = gsl_eigen_nonsymmv_alloc(m.getM());
-  gsl_vector_complex* eval = gsl_vector_complex_alloc(m.getM());
-  gsl_matrix_complex* evec = gsl_matrix_complex_alloc(m.getM(), m.getM());
-
-  gsl_eigen_nonsymmv(m_gsl, eval, evec, w);
-  gsl_eigen_nonsymmv_free(w);
-  gsl_eigen_nonsymmv_sort(eval, evec, GSL_EIGEN_SORT_ABS_DESC);
-  gsl_vector_view eval_real = gsl_vector_complex_real(eval);
-  gsl_vector_view eval_imag = gsl_vector_complex_imag(eval);
-  vals_real = fromGSL(&eval_real.vector);
-  vals_imag = fromGSL(&eval_imag.vector);
-  vecs_real = fromGSL_real(evec);
-  vecs_imag = fromGSL_imag(evec);
-
-  gsl_matrix_free(m_gsl);
-  gsl_vector_complex_free(eval);
-  gsl_matrix_complex_free(evec);
-  return true;
+  int status;
+  if (vectors) {
+    status = gsl_eigen_nonsymmv(g.m, g.eval, g.evec, g.wv);
+    gsl_eigen_nonsymmv_sort(g.eval, g.evec, GSL_EIGEN_SORT_ABS_DESC);
+  } else {
+    status = gsl_eigen_nonsymm(g.m, g.eval, g.w);
+    gsl_eigen_nonsymmv_sort(g.eval, 0, GSL_EIGEN_SORT_ABS_DESC);
+  }
+  vals_real.set(n, 1);
+  vals_imag.set(n, 1);
+  for (I i = 0; i < n; ++i) {
+    const gsl_complex z = gsl_vector_complex_get(g.eval, i);
+    vals_real.val(i, 0) = GSL_REAL(z);
+    vals_imag.val(i, 0) = GSL_IMAG(z);
+  }
+  if (vectors) {
+    vecs_real.set(n, n);
+    vecs_imag.set(n, n);
+    for (I i = 0; i < n; ++i) {
+      for (I j = 0; j < n; ++j) {
+        const gsl_complex z = gsl_matrix_complex_get(g.evec, i, j);
+        vecs_real.val(i, j) = GSL_REAL(z);
+        vecs_imag.val(i, j) = GSL_IMAG(z);
+      }
+    }
+  }
+  return status == GSL_SUCCESS;
 }
 
 /******************** local functions *************************************/
@@ -128,6 +188,13 @@ gsl_matrix*
 toGSL(const Matrix& src) {
   gsl_matrix* m = gsl_matrix_alloc(src.getM(), src.getN());
   assert(m);
+  toGSL(src, m);
+  return m;
+}
+
+void
+toGSL(const Matrix& src, gsl_matrix* m) {
+  assert(m && m->size1 == src.getM() && m->size2 == src.getN());
   static_assert(sizeof(double) == sizeof(D));
   // if the tda (row length) is equal to N static_cast<size2>(then) we can copy the data right away
   if (m->tda == m->size2) {
@@ -137,7 +204,6 @@ toGSL(const Matrix& src) {
       memcpy(m->data + i * m->tda, src.unsafeGetData() + i * src.getN(), m->size2 * sizeof(D));
     }
   }
-  return m;
 }
 
 Matrix
@@ -211,17 +277,7 @@ eigenValuesVectorsRealSym(const Matrix& m, Matrix& eigenvalues, Matrix& eigenvec
 }
 
 bool
-eigenValues(const Matrix& m, Matrix& real, Matrix& imag) {
-  assert("Not implemented!");
-  return false;
-}
-
-bool
-eigenValuesVectors(const Matrix& m,
-                   Matrix& vals_real,
-                   Matrix& vals_imag,
-                   Matrix& vecs_real,
-                   const Matrix& vecs_imag) {
+EigenSolver::computeFull(const Matrix& m, bool vectors) {
   assert("Not implemented!");
   return false;
 }
@@ -269,3 +325,849 @@ scaleEigenVectorsWithValue(const Matrix& vals_real,
 }
 
 }
+
+namespace matrix {
+
+/**************** EigenSolver ****************/
+
+// the free functions keep their workspaces between the calls (per thread)
+static EigenSolver&
+localEigenSolver() {
+  static thread_local EigenSolver solver;
+  return solver;
+}
+
+bool
+eigenValues(const Matrix& m, Matrix& real, Matrix& imag) {
+  EigenSolver& solver = localEigenSolver();
+  if (!solver.compute(m, false))
+    return false;
+  real.copy(solver.getValuesReal());
+  imag.copy(solver.getValuesImag());
+  return true;
+}
+
+bool
+eigenValuesVectors(const Matrix& m,
+                   Matrix& vals_real,
+                   Matrix& vals_imag,
+                   Matrix& vecs_real,
+                   Matrix& vecs_imag) {
+  EigenSolver& solver = localEigenSolver();
+  if (!solver.compute(m, true))
+    return false;
+  vals_real.copy(solver.getValuesReal());
+  vals_imag.copy(solver.getValuesImag());
+  vecs_real.copy(solver.getVectorsReal());
+  vecs_imag.copy(solver.getVectorsImag());
+  return true;
+}
+
+EigenSolver::EigenSolver(I topK)
+  : topK(topK) {}
+
+EigenSolver::~EigenSolver() = default;
+
+void
+EigenSolver::setTopK(I k) {
+  topK = k; // the subspace of the last call is still a valid start
+}
+
+bool
+EigenSolver::compute(const Matrix& m, bool vectors) {
+  // check if m is square
+  assert(m.getM() == m.getN());
+  if (!ws)
+    ws = std::make_unique<Workspace>();
+  iterations = 0;
+  if (topK == 0)
+    return computeFull(m, vectors);
+  else
+    return computeTopK(m, vectors);
+}
+
+/// complex Givens rotation [c s; -conj(s) c] that zeros g in (f, g)
+static void
+givens(const Complex& f, const Complex& g, D& c, Complex& s) {
+  const D fa = std::abs(f);
+  const D ga = std::abs(g);
+  if (ga == 0) {
+    c = 1;
+    s = 0;
+  } else if (fa == 0) {
+    c = 0;
+    s = std::conj(g) / ga;
+  } else {
+    const D norm = std::hypot(fa, ga);
+    c = fa / norm;
+    s = (f / fa) * std::conj(g) / norm;
+  }
+}
+
+bool
+EigenSolver::Workspace::schur(const Matrix& T) {
+  const int k = T.getM();
+  const D eps = std::numeric_limits<D>::epsilon();
+  S.assign(T.unsafeGetData(), T.unsafeGetData() + k * k);
+  U.assign(k * k, 0);
+  for (int i = 0; i < k; ++i)
+    U[i * k + i] = 1;
+  rc.resize(k);
+  rs.resize(k);
+
+  // rotation of the rows i and i+1 from column "from" on
+  auto rotateRows = [&](int i, D c, Complex s, int from) {
+    for (int j = from; j < k; ++j) {
+      const Complex a = S[i * k + j];
+      const Complex b = S[(i + 1) * k + j];
+      S[i * k + j] = c * a + s * b;
+      S[(i + 1) * k + j] = -std::conj(s) * a + c * b;
+    }
+  };
+  // rotation of the columns i and i+1 up to row "to" (and of the Schur vectors)
+  auto rotateColumns = [&](int i, D c, Complex s, int to) {
+    for (int r = 0; r <= to; ++r) {
+      const Complex a = S[r * k + i];
+      const Complex b = S[r * k + i + 1];
+      S[r * k + i] = a * c + b * std::conj(s);
+      S[r * k + i + 1] = -a * s + b * c;
+    }
+    for (int r = 0; r < k; ++r) {
+      const Complex a = U[r * k + i];
+      const Complex b = U[r * k + i + 1];
+      U[r * k + i] = a * c + b * std::conj(s);
+      U[r * k + i + 1] = -a * s + b * c;
+    }
+  };
+
+  D c;
+  Complex s;
+  // Hessenberg form
+  for (int j = 0; j + 2 < k; ++j) {
+    for (int i = k - 1; i >= j + 2; --i) {
+      givens(S[(i - 1) * k + j], S[i * k + j], c, s);
+      rotateRows(i - 1, c, s, j);
+      S[i * k + j] = 0;
+      rotateColumns(i - 1, c, s, k - 1);
+    }
+  }
+
+  D norm = 0;
+  for (const Complex& v : S)
+    norm += std::norm(v);
+  norm = sqrt(norm);
+
+  // shifted QR steps on the active block [l, hi] until it is triangular
+  int its = 0;
+  int total = 0;
+  for (int hi = k - 1; hi > 0;) {
+    int l = hi;
+    for (; l > 0; --l) {
+      D d = std::abs(S[(l - 1) * k + l - 1]) + std::abs(S[l * k + l]);
+      if (d == 0)
+        d = norm;
+      if (std::abs(S[l * k + l - 1]) <= eps * d) {
+        S[l * k + l - 1] = 0;
+        break;
+      }
+    }
+    if (l == hi) { // deflation
+      --hi;
+      its = 0;
+      continue;
+    }
+    if (++total > 30 * k)
+      return false;
+    Complex mu;
+    if (++its % 10 == 0) { // exceptional shift
+      mu = S[hi * k + hi] + 0.75 * std::abs(S[hi * k + hi - 1]);
+    } else { // Wilkinson shift: eigenvalue of the trailing 2x2 block closer to the last entry
+      const Complex a = S[(hi - 1) * k + hi - 1];
+      const Complex b = S[(hi - 1) * k + hi];
+      const Complex cc = S[hi * k + hi - 1];
+      const Complex d = S[hi * k + hi];
+      const Complex h = (a - d) * 0.5;
+      const Complex disc = std::sqrt(h * h + b * cc); // no cancellation for close eigenvalues
+      mu = d + (std::abs(h + disc) < std::abs(h - disc) ? h + disc : h - disc);
+    }
+    for (int i = l; i <= hi; ++i)
+      S[i * k + i] -= mu;
+    for (int i = l; i < hi; ++i) {
+      givens(S[i * k + i], S[(i + 1) * k + i], rc[i], rs[i]);
+      rotateRows(i, rc[i], rs[i], i);
+      S[(i + 1) * k + i] = 0;
+    }
+    for (int i = l; i < hi; ++i)
+      rotateColumns(i, rc[i], rs[i], i + 1);
+    for (int i = l; i <= hi; ++i)
+      S[i * k + i] += mu;
+  }
+
+  // eigenvectors of S by back substitution, transformed with U
+  const D small = std::max(eps * norm, std::numeric_limits<D>::min());
+  vals.resize(k);
+  vecs.resize(k * k);
+  x.resize(k);
+  for (int j = 0; j < k; ++j) {
+    const Complex lambda = S[j * k + j];
+    vals[j] = lambda;
+    x[j] = 1;
+    for (int r = j - 1; r >= 0; --r) {
+      Complex sum = 0;
+      for (int l = r + 1; l <= j; ++l)
+        sum += S[r * k + l] * x[l];
+      Complex d = S[r * k + r] - lambda;
+      if (std::abs(d) < small)
+        d = small;
+      x[r] = -sum / d;
+    }
+    D len = 0;
+    for (int i = 0; i < k; ++i) {
+      Complex v = 0;
+      for (int l = 0; l <= j; ++l)
+        v += U[i * k + l] * x[l];
+      vecs[i * k + j] = v;
+      len += std::norm(v);
+    }
+    len = sqrt(len);
+    for (int i = 0; i < k; ++i)
+      vecs[i * k + j] /= len;
+  }
+  order.resize(k);
+  for (int i = 0; i < k; ++i)
+    order[i] = i;
+  std::stable_sort(order.begin(), order.end(), [this](I a, I b) {
+    return std::abs(vals[a]) > std::abs(vals[b]);
+  });
+  // complex conjugate pairs: positive imaginary part first
+  for (int i = 0; i + 1 < k; ++i) {
+    const Complex a = vals[order[i]];
+    const Complex b = vals[order[i + 1]];
+    if (a.imag() < 0 && std::abs(a - std::conj(b)) <= 1000 * eps * norm)
+      std::swap(order[i], order[i + 1]);
+  }
+  return true;
+}
+
+/** orthonormalizes the columns of Q (modified Gram-Schmidt, applied twice).
+    Columns that are (numerically) in the span of the previous ones
+    are replaced by unit vectors. */
+static void
+orthonormalize(Matrix& Q) {
+  const I n = Q.getM();
+  const I p = Q.getN();
+  D* q = Q.unsafeGetData();
+  I next = 0; // next unit vector used as replacement
+  for (I j = 0; j < p; ++j) {
+    for (I attempt = 0; attempt <= n; ++attempt) {
+      D before = 0;
+      for (I i = 0; i < n; ++i)
+        before += q[i * p + j] * q[i * p + j];
+      for (int pass = 0; pass < 2; ++pass) {
+        for (I l = 0; l < j; ++l) {
+          D d = 0;
+          for (I i = 0; i < n; ++i)
+            d += q[i * p + l] * q[i * p + j];
+          for (I i = 0; i < n; ++i)
+            q[i * p + j] -= d * q[i * p + l];
+        }
+      }
+      D after = 0;
+      for (I i = 0; i < n; ++i)
+        after += q[i * p + j] * q[i * p + j];
+      if (after > 1e-20 * before && after > 0) {
+        const D f = 1.0 / sqrt(after);
+        for (I i = 0; i < n; ++i)
+          q[i * p + j] *= f;
+        break;
+      }
+      for (I i = 0; i < n; ++i)
+        q[i * p + j] = 0;
+      q[(next++ % n) * p + j] = 1;
+    }
+  }
+}
+
+bool
+EigenSolver::computeTopK(const Matrix& m, bool vectors) {
+  const I n = m.getM();
+  const I k = std::min(topK, n);
+  // additional basis vectors speed up the convergence of the k-th eigenvalue
+  const I p = std::min(n, k + std::max<I>(k, 4));
+  if (Q.getM() != n || Q.getN() != p) { // no warm start possible
+    Q.set(n, p);
+    for (I i = 0; i < n; ++i)
+      for (I j = 0; j < p; ++j)
+        Q.val(i, j) = (i == j) + 0.1 * sin(1.0 + i * (j + 1));
+    orthonormalize(Q);
+  }
+  Workspace& w = *ws;
+  const D* q = Q.unsafeGetData();
+  bool converged = false;
+  while (true) {
+    Z.gemm(m, false, Q, false);
+    T.gemm(Q, true, Z, false); // Rayleigh-Ritz: projection of m into the subspace
+    if (!w.schur(T))
+      return false;
+    ++iterations;
+    // residuals |m Q y - lambda Q y| of the top k Ritz pairs (Q y has unit length)
+    const D* z = Z.unsafeGetData();
+    q = Q.unsafeGetData();
+    const D scale = std::abs(w.vals[w.order[0]]);
+    converged = true;
+    for (I j = 0; j < k && converged; ++j) {
+      const I c = w.order[j];
+      const Complex lambda = w.vals[c];
+      D res = 0;
+      for (I i = 0; i < n; ++i) {
+        Complex a = 0;
+        Complex b = 0;
+        for (I l = 0; l < p; ++l) {
+          a += z[i * p + l] * w.vecs[l * p + c];
+          b += q[i * p + l] * w.vecs[l * p + c];
+        }
+        res += std::norm(a - lambda * b);
+      }
+      converged = sqrt(res) <= tolerance * scale;
+    }
+    if (converged || iterations >= maxIterations)
+      break;
+    Q.copy(Z);
+    orthonormalize(Q);
+  }
+  // the previous results are kept, the next call continues with the current basis
+  if (!converged)
+    return false;
+
+  // eigenvalues with negligible imaginary part are real
+  const D scale = std::abs(w.vals[w.order[0]]);
+  const D realtol = 1000 * std::numeric_limits<D>::epsilon() * scale;
+  vals_real.set(k, 1);
+  vals_imag.set(k, 1);
+  for (I j = 0; j < k; ++j) {
+    const Complex lambda = w.vals[w.order[j]];
+    vals_real.val(j, 0) = lambda.real();
+    vals_imag.val(j, 0) = std::abs(lambda.imag()) > realtol ? lambda.imag() : 0;
+  }
+  if (vectors) { // Ritz vectors Q y, rotated such that the largest entry is real and positive
+    vecs_real.set(n, k);
+    vecs_imag.set(n, k);
+    w.x.resize(n);
+    for (I j = 0; j < k; ++j) {
+      const I c = w.order[j];
+      I imax = 0;
+      for (I i = 0; i < n; ++i) {
+        Complex v = 0;
+        for (I l = 0; l < p; ++l)
+          v += q[i * p + l] * w.vecs[l * p + c];
+        w.x[i] = v;
+        if (std::abs(v) > std::abs(w.x[imax]))
+          imax = i;
+      }
+      const D len = std::abs(w.x[imax]);
+      const Complex phase = len > 0 ? std::conj(w.x[imax]) / len : Complex(1);
+      for (I i = 0; i < n; ++i) {
+        const Complex v = w.x[i] * phase;
+        vecs_real.val(i, j) = v.real();
+        vecs_imag.val(i, j) = vals_imag.val(j, 0) == 0 ? 0 : v.imag();
+      }
+    }
+  }
+  return true;
+}
+
+/**************** EigenSolverThread ****************/
+
+EigenSolverThread::EigenSolverThread(I topK, bool vectors)
+  : solver(topK)
+  , vectors(vectors) {}
+
+EigenSolverThread::~EigenSolverThread() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wakeup.notify_one();
+  if (thread.joinable())
+    thread.join();
+}
+
+void
+EigenSolverThread::submit(const Matrix& m) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.copy(m);
+    hasPending = true;
+    if (!thread.joinable())
+      thread = std::thread(&EigenSolverThread::run, this);
+  }
+  wakeup.notify_one();
+}
+
+bool
+EigenSolverThread::fetch(Matrix& vals_real, Matrix& vals_imag, Matrix& vecs_real, Matrix& vecs_imag) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!hasResult)
+    return false;
+  vals_real.copy(results[0]);
+  vals_imag.copy(results[1]);
+  vecs_real.copy(results[2]);
+  vecs_imag.copy(results[3]);
+  hasResult = false;
+  return true;
+}
+
+void
+EigenSolverThread::run() {
+  Matrix m;
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    wakeup.wait(lock, [this] { return stopping || hasPending; });
+    if (stopping)
+      return;
+    m.copy(pending);
+    hasPending = false;
+    lock.unlock();
+    const bool ok = solver.compute(m, vectors);
+    lock.lock();
+    if (ok) {
+      results[0].copy(solver.getValuesReal());
+      results[1].copy(solver.getValuesImag());
+      results[2].copy(solver.getVectorsReal());
+      results[3].copy(solver.getVectorsImag());
+      hasResult = true;
+    }
+  }
+}
+
+} // namespace matrix
+
+namespace matrix {
+
+/**************** Cholesky ****************/
+
+bool
+Cholesky::compute(const Matrix& A, D lambda) {
+  assert(A.getM() == A.getN());
+  const I n = A.getM();
+  L.set(n, n);
+  D* l = L.unsafeGetData();
+  const D* a = A.unsafeGetData();
+  valid = false;
+  for (I j = 0; j < n; ++j) {
+    D* lj = l + j * n;
+    D d = a[j * n + j] + lambda;
+    for (I k = 0; k < j; ++k)
+      d -= lj[k] * lj[k];
+    if (!(d > 0)) // also catches NaN
+      return false;
+    const D ljj = sqrt(d);
+    lj[j] = ljj;
+    for (I i = j + 1; i < n; ++i) {
+      const D* li = l + i * n;
+      D s = a[i * n + j];
+      for (I k = 0; k < j; ++k)
+        s -= li[k] * lj[k];
+      l[i * n + j] = s / ljj;
+    }
+  }
+  valid = true;
+  return true;
+}
+
+void
+Cholesky::solveInPlace(Matrix& B) const {
+  assert(valid && B.getM() == L.getM());
+  const I n = L.getM();
+  const I k = B.getN();
+  const D* l = L.unsafeGetData();
+  D* b = B.unsafeGetData();
+  // forward substitution L Y = B (row operations on B)
+  for (I i = 0; i < n; ++i) {
+    D* bi = b + i * k;
+    for (I j = 0; j < i; ++j) {
+      const D f = l[i * n + j];
+      if (f == 0)
+        continue;
+      const D* bj = b + j * k;
+      for (I c = 0; c < k; ++c)
+        bi[c] -= f * bj[c];
+    }
+    const D inv = 1.0 / l[i * n + i];
+    for (I c = 0; c < k; ++c)
+      bi[c] *= inv;
+  }
+  // backward substitution L^T X = Y
+  for (I i = n; i-- > 0;) {
+    D* bi = b + i * k;
+    for (I j = i + 1; j < n; ++j) {
+      const D f = l[j * n + i];
+      if (f == 0)
+        continue;
+      const D* bj = b + j * k;
+      for (I c = 0; c < k; ++c)
+        bi[c] -= f * bj[c];
+    }
+    const D inv = 1.0 / l[i * n + i];
+    for (I c = 0; c < k; ++c)
+      bi[c] *= inv;
+  }
+}
+
+Matrix
+Cholesky::solve(const Matrix& B) const {
+  Matrix X(B);
+  solveInPlace(X);
+  return X;
+}
+
+Matrix
+Cholesky::inverse() const {
+  Matrix X(L.getM(), L.getM());
+  X.toId();
+  solveInPlace(X);
+  return X;
+}
+
+D
+Cholesky::logDet() const {
+  assert(valid);
+  D s = 0;
+  for (I i = 0; i < L.getM(); ++i)
+    s += log(L.val(i, i));
+  return 2 * s;
+}
+
+bool
+Cholesky::update(Matrix& x) {
+  assert(valid && x.getM() == L.getM() && x.getN() == 1);
+  const I n = L.getM();
+  D* l = L.unsafeGetData();
+  D* v = x.unsafeGetData();
+  for (I k = 0; k < n; ++k) {
+    const D lkk = l[k * n + k];
+    const D r = sqrt(lkk * lkk + v[k] * v[k]);
+    const D c = r / lkk;
+    const D s = v[k] / lkk;
+    l[k * n + k] = r;
+    for (I i = k + 1; i < n; ++i) {
+      D& lik = l[i * n + k];
+      lik = (lik + s * v[i]) / c;
+      v[i] = c * v[i] - s * lik;
+    }
+  }
+  return true;
+}
+
+bool
+Cholesky::downdate(Matrix& x) {
+  assert(valid && x.getM() == L.getM() && x.getN() == 1);
+  const I n = L.getM();
+  D* l = L.unsafeGetData();
+  D* v = x.unsafeGetData();
+  for (I k = 0; k < n; ++k) {
+    const D lkk = l[k * n + k];
+    const D d = lkk * lkk - v[k] * v[k];
+    if (!(d > 0)) {
+      valid = false;
+      return false;
+    }
+    const D r = sqrt(d);
+    const D c = r / lkk;
+    const D s = v[k] / lkk;
+    l[k * n + k] = r;
+    for (I i = k + 1; i < n; ++i) {
+      D& lik = l[i * n + k];
+      lik = (lik - s * v[i]) / c;
+      v[i] = c * v[i] - s * lik;
+    }
+  }
+  return true;
+}
+
+bool
+Cholesky::updateLowRank(const Matrix& X, int sign) {
+  assert(sign == 1 || sign == -1);
+  for (I j = 0; j < X.getN(); ++j) {
+    Matrix x = X.column(j);
+    if (!(sign > 0 ? update(x) : downdate(x)))
+      return false;
+  }
+  return true;
+}
+
+/**************** LU ****************/
+
+bool
+LU::compute(const Matrix& A) {
+  assert(A.getM() == A.getN());
+  const I n = A.getM();
+  LUdata = A;
+  D* a = LUdata.unsafeGetData();
+  perm.resize(n);
+  for (I i = 0; i < n; ++i)
+    perm[i] = i;
+  permsign = 1;
+  singular = false;
+  for (I k = 0; k < n; ++k) {
+    // partial pivoting: largest element of column k
+    I p = k;
+    D maxval = fabs(a[k * n + k]);
+    for (I i = k + 1; i < n; ++i) {
+      if (fabs(a[i * n + k]) > maxval) {
+        maxval = fabs(a[i * n + k]);
+        p = i;
+      }
+    }
+    if (!(maxval > 0)) {
+      singular = true;
+      continue;
+    }
+    if (p != k) {
+      for (I c = 0; c < n; ++c)
+        std::swap(a[k * n + c], a[p * n + c]);
+      std::swap(perm[k], perm[p]);
+      permsign = -permsign;
+    }
+    const D* ak = a + k * n;
+    const D inv = 1.0 / ak[k];
+    for (I i = k + 1; i < n; ++i) {
+      D* ai = a + i * n;
+      const D f = (ai[k] *= inv);
+      if (f == 0)
+        continue;
+      for (I c = k + 1; c < n; ++c)
+        ai[c] -= f * ak[c];
+    }
+  }
+  return !singular;
+}
+
+void
+LU::solveInPlace(Matrix& B) const {
+  assert(!singular && B.getM() == LUdata.getM());
+  const I n = LUdata.getM();
+  const I k = B.getN();
+  const D* a = LUdata.unsafeGetData();
+  // apply the permutation
+  Matrix PB(n, k);
+  for (I i = 0; i < n; ++i)
+    memcpy(PB.unsafeGetData() + i * k, B.unsafeGetData() + perm[i] * k, k * sizeof(D));
+  B = std::move(PB);
+  D* b = B.unsafeGetData();
+  // forward substitution with the unit lower triangle
+  for (I i = 0; i < n; ++i) {
+    D* bi = b + i * k;
+    for (I j = 0; j < i; ++j) {
+      const D f = a[i * n + j];
+      if (f == 0)
+        continue;
+      const D* bj = b + j * k;
+      for (I c = 0; c < k; ++c)
+        bi[c] -= f * bj[c];
+    }
+  }
+  // backward substitution with the upper triangle
+  for (I i = n; i-- > 0;) {
+    D* bi = b + i * k;
+    for (I j = i + 1; j < n; ++j) {
+      const D f = a[i * n + j];
+      if (f == 0)
+        continue;
+      const D* bj = b + j * k;
+      for (I c = 0; c < k; ++c)
+        bi[c] -= f * bj[c];
+    }
+    const D inv = 1.0 / a[i * n + i];
+    for (I c = 0; c < k; ++c)
+      bi[c] *= inv;
+  }
+}
+
+Matrix
+LU::solve(const Matrix& B) const {
+  Matrix X(B);
+  solveInPlace(X);
+  return X;
+}
+
+Matrix
+LU::inverse() const {
+  Matrix X(LUdata.getM(), LUdata.getM());
+  X.toId();
+  solveInPlace(X);
+  return X;
+}
+
+D
+LU::determinant() const {
+  D d = permsign;
+  for (I i = 0; i < LUdata.getM(); ++i)
+    d *= LUdata.val(i, i);
+  return d;
+}
+
+/**************** QR ****************/
+
+bool
+QR::compute(const Matrix& A) {
+  assert(A.getM() >= A.getN());
+  const I m = A.getM();
+  const I n = A.getN();
+  QRdata = A;
+  D* a = QRdata.unsafeGetData();
+  tau.assign(n, 0);
+  fullrank = true;
+  for (I k = 0; k < n; ++k) {
+    // Householder vector for column k below the diagonal: v = (1, a[k+1..m-1,k])
+    D norm = 0;
+    for (I i = k; i < m; ++i)
+      norm += a[i * n + k] * a[i * n + k];
+    norm = sqrt(norm);
+    if (norm == 0) {
+      fullrank = false;
+      continue;
+    }
+    const D alpha = a[k * n + k] > 0 ? -norm : norm;
+    const D v0 = a[k * n + k] - alpha;
+    for (I i = k + 1; i < m; ++i)
+      a[i * n + k] /= v0;
+    tau[k] = -v0 / alpha;
+    a[k * n + k] = alpha;
+    // apply H = I - tau v v^T to the remaining columns
+    for (I c = k + 1; c < n; ++c) {
+      D s = a[k * n + c];
+      for (I i = k + 1; i < m; ++i)
+        s += a[i * n + k] * a[i * n + c];
+      s *= tau[k];
+      a[k * n + c] -= s;
+      for (I i = k + 1; i < m; ++i)
+        a[i * n + c] -= s * a[i * n + k];
+    }
+  }
+  return fullrank;
+}
+
+void
+QR::applyQT(Matrix& B) const {
+  const I m = QRdata.getM();
+  const I n = QRdata.getN();
+  const I k = B.getN();
+  const D* a = QRdata.unsafeGetData();
+  D* b = B.unsafeGetData();
+  std::vector<D> s(k);
+  for (I j = 0; j < n; ++j) {
+    if (tau[j] == 0)
+      continue;
+    // s = v^T B (row vector)
+    for (I c = 0; c < k; ++c)
+      s[c] = b[j * k + c];
+    for (I i = j + 1; i < m; ++i) {
+      const D vi = a[i * n + j];
+      for (I c = 0; c < k; ++c)
+        s[c] += vi * b[i * k + c];
+    }
+    for (I c = 0; c < k; ++c) {
+      s[c] *= tau[j];
+      b[j * k + c] -= s[c];
+    }
+    for (I i = j + 1; i < m; ++i) {
+      const D vi = a[i * n + j];
+      for (I c = 0; c < k; ++c)
+        b[i * k + c] -= s[c] * vi;
+    }
+  }
+}
+
+void
+QR::solveInPlace(Matrix& B) const {
+  assert(fullrank && B.getM() == QRdata.getM());
+  const I n = QRdata.getN();
+  const I k = B.getN();
+  const D* a = QRdata.unsafeGetData();
+  applyQT(B);
+  // only the first n rows are needed (they are at the beginning of the buffer)
+  B.reshape(n, k);
+  D* b = B.unsafeGetData();
+  for (I i = n; i-- > 0;) {
+    D* bi = b + i * k;
+    for (I j = i + 1; j < n; ++j) {
+      const D f = a[i * n + j];
+      const D* bj = b + j * k;
+      for (I c = 0; c < k; ++c)
+        bi[c] -= f * bj[c];
+    }
+    const D inv = 1.0 / a[i * n + i];
+    for (I c = 0; c < k; ++c)
+      bi[c] *= inv;
+  }
+}
+
+Matrix
+QR::solve(const Matrix& B) const {
+  Matrix X(B);
+  solveInPlace(X);
+  return X;
+}
+
+Matrix
+QR::getR() const {
+  const I n = QRdata.getN();
+  Matrix R(n, n);
+  for (I i = 0; i < n; ++i)
+    for (I j = i; j < n; ++j)
+      R.val(i, j) = QRdata.val(i, j);
+  return R;
+}
+
+Matrix
+QR::getQ() const {
+  const I m = QRdata.getM();
+  const I n = QRdata.getN();
+  // Q = H_0 ... H_{n-1} applied to the first n columns of the identity
+  Matrix Q(m, n);
+  for (I i = 0; i < n; ++i)
+    Q.val(i, i) = 1;
+  const D* a = QRdata.unsafeGetData();
+  for (I j = n; j-- > 0;) {
+    if (tau[j] == 0)
+      continue;
+    for (I c = 0; c < n; ++c) {
+      D s = Q.val(j, c);
+      for (I i = j + 1; i < m; ++i)
+        s += a[i * n + j] * Q.val(i, c);
+      s *= tau[j];
+      Q.val(j, c) -= s;
+      for (I i = j + 1; i < m; ++i)
+        Q.val(i, c) -= s * a[i * n + j];
+    }
+  }
+  return Q;
+}
+
+/**************** helpers ****************/
+
+Matrix
+pseudoInverseSolve(const Matrix& A, const Matrix& B, D lambda) {
+  if (A.getM() > A.getN()) { // (A^T A)^-1 A^T B
+    assert(B.getM() == A.getM());
+    const Matrix R = A.multTM();
+    Cholesky chol(R);
+    if (!chol.isValid() && !chol.compute(R, lambda))
+      return A.pseudoInverse(lambda) * B;
+    Matrix X = (A ^ T) * B;
+    chol.solveInPlace(X);
+    return X;
+  } else { // A^T (A A^T)^-1 B
+    assert(B.getM() == A.getM());
+    const Matrix R = A.multMT();
+    Cholesky chol(R);
+    if (!chol.isValid() && !chol.compute(R, lambda))
+      return A.pseudoInverse(lambda) * B;
+    Matrix X(B);
+    chol.solveInPlace(X);
+    return (A ^ T) * X;
+  }
+}
+
+} // namespace matrix
@@ -10,6 +10,12 @@
 
 #include "matrix.h"
 
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 /**
  * namespace for the matrix library
  */
@@ -66,6 +72,238 @@ Matrix scaleEigenVectorsWithValue(const Matrix& vals_real,
                                   Matrix& vecs_real,
                                   Matrix& vecs_imag);
 
+/** Eigenvalues and eigenvectors of a real square matrix with persistent workspaces,
+    such that repeated decompositions (e.g. for monitoring) do not allocate.
+
+    With topK == 0 the full spectrum is calculated by the dense solver (GSL).
+    With topK > 0 only the topK eigenvalues with the largest absolute value are calculated
+    by subspace iteration with Rayleigh-Ritz extraction. The iteration is warm-started
+    with the subspace of the last call, so only a few iterations are needed
+    if the matrix changes slowly. This mode does not need the GSL.
+
+    The results are ordered like in eigenValuesVectors() (descending absolute value),
+    the eigenvectors are stored in the columns and have unit length.
+ */
+class EigenSolver {
+public:
+  explicit EigenSolver(I topK = 0);
+  ~EigenSolver();
+  EigenSolver(const EigenSolver&) = delete;
+  EigenSolver& operator=(const EigenSolver&) = delete;
+
+  /// number of eigenpairs to calculate (0: all)
+  void setTopK(I k);
+  I getTopK() const {
+    return topK;
+  }
+  /// the subspace iteration stops if the residuals are below tol * |largest eigenvalue|
+  void setTolerance(D tol) {
+    tolerance = tol;
+  }
+  /// maximal number of subspace iterations per call
+  void setMaxIterations(int iterations) {
+    maxIterations = iterations;
+  }
+  /// number of subspace iterations of the last call
+  int getIterations() const {
+    return iterations;
+  }
+
+  /** calculates the eigenvalues (and eigenvectors if vectors is true) of m.
+      @return false if the decomposition failed or the subspace iteration did not
+      converge within the maximal number of iterations (the results of the previous
+      call are kept in this case) */
+  bool compute(const Matrix& m, bool vectors = true);
+
+  const Matrix& getValuesReal() const {
+    return vals_real;
+  }
+  const Matrix& getValuesImag() const {
+    return vals_imag;
+  }
+  const Matrix& getVectorsReal() const {
+    return vecs_real;
+  }
+  const Matrix& getVectorsImag() const {
+    return vecs_imag;
+  }
+
+private:
+  bool computeFull(const Matrix& m, bool vectors);
+  bool computeTopK(const Matrix& m, bool vectors);
+
+  I topK;
+  D tolerance = 1e-8;
+  int maxIterations = 100;
+  int iterations = 0;
+  Matrix vals_real;
+  Matrix vals_imag;
+  Matrix vecs_real;
+  Matrix vecs_imag;
+  Matrix Q, Z, T; // basis of the subspace, M*Q and the projection Q^T*M*Q
+  struct Workspace; // GSL workspaces and the complex Schur decomposition
+  std::unique_ptr<Workspace> ws;
+};
+
+/** runs an EigenSolver in a background thread.
+    submit() hands a copy of the matrix to the thread (replacing a matrix that was not
+    started yet) and fetch() returns the newest result in the calling thread.
+    The thread is started with the first submit().
+ */
+class EigenSolverThread {
+public:
+  explicit EigenSolverThread(I topK = 0, bool vectors = true);
+  ~EigenSolverThread();
+  EigenSolverThread(const EigenSolverThread&) = delete;
+  EigenSolverThread& operator=(const EigenSolverThread&) = delete;
+
+  /// schedules the decomposition of m
+  void submit(const Matrix& m);
+  /** copies the newest result into the given matrices.
+      @return false if there is no new result since the last call */
+  bool fetch(Matrix& vals_real, Matrix& vals_imag, Matrix& vecs_real, Matrix& vecs_imag);
+
+private:
+  void run();
+
+  EigenSolver solver; // only used by the thread
+  bool vectors;
+  std::thread thread;
+  std::mutex mutex;
+  std::condition_variable wakeup;
+  Matrix pending;
+  bool hasPending = false;
+  bool stopping = false;
+  Matrix results[4];
+  bool hasResult = false;
+};
+
+/** Cholesky factorization \f$ A + \lambda I = L L^T \f$ of a symmetric positive
+    definite matrix. Use it to solve linear systems instead of forming the inverse.
+    The factorization can be kept over time and updated with rank-1 terms
+    in \f$ O(n^2) \f$ instead of refactorizing in \f$ O(n^3) \f$.
+ */
+class Cholesky {
+public:
+  Cholesky() = default;
+  /// factorizes A + lambda*I (only the lower triangle of A is used)
+  explicit Cholesky(const Matrix& A, D lambda = 0) {
+    compute(A, lambda);
+  }
+  /** factorizes A + lambda*I (only the lower triangle of A is used)
+      @return false if the matrix is not (numerically) positive definite */
+  bool compute(const Matrix& A, D lambda = 0);
+  /// true if the last compute/update was successful
+  bool isValid() const {
+    return valid;
+  }
+  I size() const {
+    return L.getM();
+  }
+  /// the lower triangular factor L
+  const Matrix& getL() const {
+    return L;
+  }
+
+  /// solves A X = B and stores X in B (B has size() rows and any number of columns)
+  void solveInPlace(Matrix& B) const;
+  /// @return X with A X = B
+  Matrix solve(const Matrix& B) const;
+  /// @return A^-1
+  Matrix inverse() const;
+  /// @return log(det(A))
+  D logDet() const;
+
+  /** rank-1 update: factorization of A + x x^T (x is a column vector).
+      x is used as workspace and is destroyed. */
+  bool update(Matrix& x);
+  /** rank-1 downdate: factorization of A - x x^T (x is a column vector).
+      x is used as workspace and is destroyed.
+      @return false if the result is not positive definite;
+      the factorization is invalid then and has to be recomputed */
+  bool downdate(Matrix& x);
+  /** low rank update with the columns of X: A + sign * X X^T
+      (sign is either 1 or -1) */
+  bool updateLowRank(const Matrix& X, int sign = 1);
+
+private:
+  Matrix L;
+  bool valid = false;
+};
+
+/** LU factorization with partial pivoting \f$ P A = L U \f$ of a square matrix.
+    L (unit diagonal) and U are stored together in one matrix.
+ */
+class LU {
+public:
+  LU() = default;
+  explicit LU(const Matrix& A) {
+    compute(A);
+  }
+  /// @return false if A is singular (a pivot is exactly zero)
+  bool compute(const Matrix& A);
+  bool isSingular() const {
+    return singular;
+  }
+  I size() const {
+    return LUdata.getM();
+  }
+
+  /// solves A X = B and stores X in B
+  void solveInPlace(Matrix& B) const;
+  /// @return X with A X = B
+  Matrix solve(const Matrix& B) const;
+  /// @return A^-1
+  Matrix inverse() const;
+  /// @return det(A)
+  D determinant() const;
+
+private:
+  Matrix LUdata;
+  std::vector<I> perm; // row i of PA is row perm[i] of A
+  int permsign = 1;
+  bool singular = true;
+};
+
+/** QR factorization \f$ A = Q R \f$ of a matrix with at least as many rows
+    as columns by Householder reflections. Used for least squares problems.
+ */
+class QR {
+public:
+  QR() = default;
+  explicit QR(const Matrix& A) {
+    compute(A);
+  }
+  /// @return false if R has a zero on the diagonal (rank deficient)
+  bool compute(const Matrix& A);
+  bool isFullRank() const {
+    return fullrank;
+  }
+
+  /** solves the least squares problem min |A X - B| and stores X in B.
+      B has getM() rows on input and getN() rows on output. */
+  void solveInPlace(Matrix& B) const;
+  /// @return least squares solution X of A X = B
+  Matrix solve(const Matrix& B) const;
+  /// the upper triangular factor (n x n)
+  Matrix getR() const;
+  /// the orthogonal factor (thin version: m x n)
+  Matrix getQ() const;
+
+private:
+  void applyQT(Matrix& B) const; // B = Q^T B
+  Matrix QRdata;                 // R in the upper triangle, Householder vectors below
+  std::vector<D> tau;
+  bool fullrank = false;
+};
+
+/** calculates A^+ B with the pseudoinverse of A (see Matrix::pseudoInverse)
+    without forming the pseudoinverse itself.
+    The Cholesky factorization of A^T A (or A A^T) is regularized with lambda
+    only if it is not positive definite.
+ */
+Matrix pseudoInverseSolve(const Matrix& A, const Matrix& B, D lambda = 1e-8);
+
 } // namespace matrix
 
 #endif
@@ -0,0 +1,304 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2011 LpzRobots development team                    *
+ *    Georg Martius  <georg dot martius at web dot de>                     *
+ *    Frank Guettler <guettler at informatik dot uni-leipzig dot de        *
+ *    Frank Hesse    <frank at nld dot ds dot mpg dot de>                  *
+ *    Ralf Der       <ralfder at mis dot mpg dot de>                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "sparsematrix.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace matrix {
+
+SparseMatrix::SparseMatrix()
+  : m(0)
+  , n(0)
+  , rowStart(1, 0) {}
+
+SparseMatrix::SparseMatrix(I _m, I _n)
+  : m(_m)
+  , n(_n)
+  , rowStart(_m + 1, 0) {}
+
+SparseMatrix::SparseMatrix(I _m, I _n, const std::vector<Triplet>& elements)
+  : m(_m)
+  , n(_n)
+  , rowStart(_m + 1, 0) {
+  // distribute the elements to the rows, keeping their order (counting sort)
+  for (const Triplet& t : elements) {
+    assert(t.row < m && t.col < n);
+    rowStart[t.row + 1]++;
+  }
+  for (I i = 0; i < m; ++i)
+    rowStart[i + 1] += rowStart[i];
+  std::vector<I> next(rowStart.begin(), rowStart.end() - 1);
+  std::vector<Triplet> sorted(elements.size());
+  for (const Triplet& t : elements)
+    sorted[next[t.row]++] = t;
+
+  // sort each row by column, the last of equal positions wins
+  colIndex.reserve(elements.size());
+  values.reserve(elements.size());
+  const auto byColumn = [](const Triplet& a, const Triplet& b) { return a.col < b.col; };
+  I begin = 0;
+  for (I i = 0; i < m; ++i) {
+    const I end = rowStart[i + 1];
+    std::stable_sort(sorted.begin() + begin, sorted.begin() + end, byColumn);
+    rowStart[i] = static_cast<I>(values.size());
+    for (I p = begin; p < end; ++p) {
+      if (p + 1 < end && sorted[p + 1].col == sorted[p].col)
+        continue;
+      if (sorted[p].value != 0) {
+        colIndex.push_back(sorted[p].col);
+        values.push_back(sorted[p].value);
+      }
+    }
+    begin = end;
+  }
+  rowStart[m] = static_cast<I>(values.size());
+}
+
+SparseMatrix::SparseMatrix(const Matrix& dense, D eps)
+  : m(dense.getM())
+  , n(dense.getN())
+  , rowStart(dense.getM() + 1, 0) {
+  const D* d = dense.unsafeGetData();
+  for (I i = 0; i < m; ++i) {
+    for (I j = 0; j < n; ++j) {
+      const D v = d[i * n + j];
+      if (v != 0 && std::fabs(v) > eps) {
+        colIndex.push_back(j);
+        values.push_back(v);
+      }
+    }
+    rowStart[i + 1] = static_cast<I>(values.size());
+  }
+}
+
+D
+SparseMatrix::val(I i, I j) const {
+  assert(i < m && j < n);
+  const auto begin = colIndex.begin() + rowStart[i];
+  const auto end = colIndex.begin() + rowStart[i + 1];
+  const auto it = std::lower_bound(begin, end, j);
+  if (it != end && *it == j)
+    return values[it - colIndex.begin()];
+  return 0;
+}
+
+Matrix
+SparseMatrix::toDense() const {
+  Matrix dense(m, n);
+  D* d = dense.unsafeGetData();
+  for (I i = 0; i < m; ++i)
+    for (I p = rowStart[i]; p < rowStart[i + 1]; ++p)
+      d[i * n + colIndex[p]] = values[p];
+  return dense;
+}
+
+SparseMatrix
+SparseMatrix::transposed() const {
+  SparseMatrix t(n, m);
+  t.colIndex.resize(values.size());
+  t.values.resize(values.size());
+  for (I c : colIndex)
+    t.rowStart[c + 1]++;
+  for (I j = 0; j < n; ++j)
+    t.rowStart[j + 1] += t.rowStart[j];
+  std::vector<I> next(t.rowStart.begin(), t.rowStart.end() - 1);
+  for (I i = 0; i < m; ++i) {
+    for (I p = rowStart[i]; p < rowStart[i + 1]; ++p) {
+      const I q = next[colIndex[p]]++;
+      t.colIndex[q] = i;
+      t.values[q] = values[p];
+    }
+  }
+  return t;
+}
+
+SparseMatrix&
+SparseMatrix::operator*=(D f) {
+  for (D& v : values)
+    v *= f;
+  return *this;
+}
+
+/// prepares y = beta * y for the products, sets the size if beta == 0
+static void
+prepareResult(Matrix& y, I m, I k, D beta) {
+  if (beta == 0) {
+    if (y.getM() != m || y.getN() != k)
+      y.set(m, k);
+    else
+      y.toZero();
+  } else {
+    assert(y.getM() == m && y.getN() == k);
+    if (beta != 1)
+      y *= beta;
+  }
+}
+
+void
+SparseMatrix::mult(const Matrix& x, Matrix& y, D alpha, D beta) const {
+  assert(x.getM() == n && &x != &y);
+  const I k = x.getN();
+  prepareResult(y, m, k, beta);
+  const D* xd = x.unsafeGetData();
+  D* yd = y.unsafeGetData();
+  if (k == 1) { // SpMV: one dot product per row
+    for (I i = 0; i < m; ++i) {
+      D sum = 0;
+      for (I p = rowStart[i]; p < rowStart[i + 1]; ++p)
+        sum += values[p] * xd[colIndex[p]];
+      yd[i] += alpha * sum;
+    }
+  } else { // SpMM: scaled rows of x are added to the rows of y
+    for (I i = 0; i < m; ++i) {
+      D* yrow = yd + i * k;
+      for (I p = rowStart[i]; p < rowStart[i + 1]; ++p) {
+        const D a = alpha * values[p];
+        const D* xrow = xd + colIndex[p] * k;
+        for (I c = 0; c < k; ++c)
+          yrow[c] += a * xrow[c];
+      }
+    }
+  }
+}
+
+void
+SparseMatrix::multTransposed(const Matrix& x, Matrix& y, D alpha, D beta) const {
+  assert(x.getM() == m && &x != &y);
+  const I k = x.getN();
+  prepareResult(y, n, k, beta);
+  const D* xd = x.unsafeGetData();
+  D* yd = y.unsafeGetData();
+  for (I i = 0; i < m; ++i) {
+    const D* xrow = xd + i * k;
+    for (I p = rowStart[i]; p < rowStart[i + 1]; ++p) {
+      const D a = alpha * values[p];
+      D* yrow = yd + colIndex[p] * k;
+      for (I c = 0; c < k; ++c)
+        yrow[c] += a * xrow[c];
+    }
+  }
+}
+
+Matrix
+SparseMatrix::operator*(const Matrix& x) const {
+  Matrix y;
+  mult(x, y);
+  return y;
+}
+
+Matrix
+operator*(const Matrix& a, const SparseMatrix& b) {
+  assert(a.getN() == b.getM());
+  const I r = a.getM();
+  const I n = b.getN();
+  const std::vector<I>& rowStart = b.getRowStarts();
+  const std::vector<I>& colIndex = b.getColIndices();
+  const std::vector<D>& values = b.getValues();
+  Matrix c(r, n);
+  const D* ad = a.unsafeGetData();
+  D* cd = c.unsafeGetData();
+  for (I k = 0; k < r; ++k) {
+    const D* arow = ad + k * b.getM();
+    D* crow = cd + k * n;
+    for (I i = 0; i < b.getM(); ++i) {
+      const D f = arow[i];
+      if (f == 0)
+        continue;
+      for (I p = rowStart[i]; p < rowStart[i + 1]; ++p)
+        crow[colIndex[p]] += f * values[p];
+    }
+  }
+  return c;
+}
+
+bool
+SparseMatrix::store(FILE* f) const {
+  fprintf(f, "SPARSEMATRIX %u %u %u\n", m, n, nonZeros());
+  for (I i = 0; i < m; ++i)
+    for (I p = rowStart[i]; p < rowStart[i + 1]; ++p)
+      fprintf(f, "%u %u %.17g\n", i, colIndex[p], values[p]);
+  return true;
+}
+
+bool
+SparseMatrix::restore(FILE* f) {
+  char identifier[32];
+  if (fscanf(f, "%31s", identifier) != 1)
+    return false;
+  if (strcmp(identifier, "MATRIX") == 0) {
+    Matrix dense;
+    if (!dense.read(f, true))
+      return false;
+    *this = SparseMatrix(dense);
+    return true;
+  }
+  if (strcmp(identifier, "SPARSEMATRIX") != 0)
+    return false;
+  I _m, _n, nnz;
+  if (fscanf(f, "%u %u %u\n", &_m, &_n, &nnz) != 3)
+    return false;
+  std::vector<Triplet> elements(nnz);
+  for (Triplet& t : elements) {
+    if (fscanf(f, "%u %u %lf\n", &t.row, &t.col, &t.value) != 3)
+      return false;
+    if (t.row >= _m || t.col >= _n)
+      return false;
+  }
+  *this = SparseMatrix(_m, _n, elements);
+  return true;
+}
+
+D
+spectralRadius(const SparseMatrix& a, int iterations) {
+  assert(a.getM() == a.getN());
+  const I n = a.getM();
+  if (n == 0 || a.nonZeros() == 0 || iterations < 2)
+    return 0;
+  // deterministic start vector with components in all directions
+  Matrix x(n, 1);
+  for (I i = 0; i < n; ++i)
+    x.val(i, 0) = 1.0 + 0.5 * sin(i + 1.0);
+  x *= 1.0 / sqrt(x.norm_sqr());
+  Matrix y;
+  D logGrowth = 0;
+  int counted = 0;
+  for (int t = 0; t < iterations; ++t) {
+    a.mult(x, y);
+    const D norm = sqrt(y.norm_sqr());
+    if (norm == 0) // nilpotent part only
+      return 0;
+    if (t >= iterations / 2) {
+      logGrowth += log(norm);
+      counted++;
+    }
+    y *= 1.0 / norm;
+    std::swap(x, y);
+  }
+  return exp(logGrowth / counted);
+}
+
+} // namespace matrix
@@ -24,49 +24,119 @@
 #ifndef __SPARSEMATRIX_H_
 #define __SPARSEMATRIX_H_
 
-#include "sparsearray.h"
+#include "matrix.h"
+#include <vector>
 
 namespace matrix {
 
 /**
- * sparse matrix which uses an HashTable
- * first (fast implemented) version
- * @author guettler
+ * Sparse matrix in compressed row storage (CSR): the nonzero elements are
+ * stored row by row together with their column indices.
+ * The matrix is build once (from a list of elements or from a dense matrix)
+ * and is then used in products with dense matrices:
+ * mult() (sparse times dense vector or matrix) traverses the rows,
+ * multTransposed() traverses the same storage column-wise, i.e. as the
+ * compressed column storage (CSC) of the transposed matrix.
+ * The costs of the products are proportional to the number of nonzero elements.
  */
-template<typename I, typename D>
-class SparseMatrix{
+class SparseMatrix : public Storeable {
 public:
-  SparseMatrix(I m, I n)
-    : SparseArray<I, D>(m * n)
-    , m(m)
-    , n(n) {}
+  /// element at position (row, col)
+  struct Triplet {
+    I row;
+    I col;
+    D value;
+  };
 
-  virtual ~SparseMatrix() {}
+  /// default constructor: zero matrix (0x0)
+  SparseMatrix();
+  /// zero matrix of the given size (no nonzero elements)
+  SparseMatrix(I m, I n);
+  /** constructs the matrix from the given elements (in any order).
+      An element at an already given position replaces the earlier one
+      (like repeated assignments to the same element of a dense matrix).
+      Elements with value zero are not stored.
+   */
+  SparseMatrix(I m, I n, const std::vector<Triplet>& elements);
+  /// converts a dense matrix, elements with absolute value <= eps are dropped
+  explicit SparseMatrix(const Matrix& dense, D eps = 0);
 
-  virtual inline D val(I row, I column) const  override {
-    return (*this)[row * m + column];
+  /** @return number of rows */
+  I getM() const {
+    return m;
   }
-
-  virtual inline D& val(I row, I column) {
-    return (*this)[row * m + column];
+  /** @return number of columns */
+  I getN() const {
+    return n;
+  }
+  /** @return number of stored (nonzero) elements */
+  I nonZeros() const {
+    return static_cast<I>(values.size());
   }
 
-  virtual inline I getM() {
-    return m;
+  /** @return element at position i,j (row, column index) */
+  D val(I i, I j) const;
+
+  /// index of the first element of each row in getColIndices() and getValues() (size m+1)
+  const std::vector<I>& getRowStarts() const {
+    return rowStart;
   }
-  virtual inline I getN() {
-    return n;
+  /// column indices of the elements (sorted within each row)
+  const std::vector<I>& getColIndices() const {
+    return colIndex;
+  }
+  /// values of the elements (row by row)
+  const std::vector<D>& getValues() const {
+    return values;
   }
 
-protected:
+  /// @return the dense version of this matrix
+  Matrix toDense() const;
+  /// @return the transposed matrix
+  SparseMatrix transposed() const;
+  /// multiplies all elements with the given factor
+  SparseMatrix& operator*=(D f);
+
+  /** y = alpha * this * x + beta * y (SpMV for a vector x, otherwise SpMM).
+      x must be a NxK matrix. For beta == 0 y is set to a MxK matrix and its
+      content is ignored, otherwise it must have this size already.
+   */
+  void mult(const Matrix& x, Matrix& y, D alpha = 1, D beta = 0) const;
+  /** y = alpha * this^T * x + beta * y.
+      x must be a MxK matrix, y is NxK (see mult() for beta)
+   */
+  void multTransposed(const Matrix& x, Matrix& y, D alpha = 1, D beta = 0) const;
+  /// @return this * x
+  Matrix operator*(const Matrix& x) const;
+
+  /** stores the matrix as a list of its elements (ascii):
+      "SPARSEMATRIX m n nnz" and one line "row col value" for each element
+   */
+  virtual bool store(FILE* f) const override;
+  /** reads a matrix stored with store(), a dense matrix (Matrix::store())
+      is accepted as well and converted
+   */
+  virtual bool restore(FILE* f) override;
+
+private:
   I m;
   I n;
+  std::vector<I> rowStart;
+  std::vector<I> colIndex;
+  std::vector<D> values;
 };
 
-} // namespace matrix
+/// @return a * b (dense times sparse)
+Matrix operator*(const Matrix& a, const SparseMatrix& b);
 
-#ifdef UNITTEST
-#include "sparsematrix.tests.hpp"
-#endif
+/** estimates the spectral radius (largest absolute eigenvalue) of the square
+    matrix a with the power iteration. The growth rate of the vector is averaged
+    over the second half of the iterations, such that a pair of complex
+    eigenvalues (rotating vector) is handled as well.
+    The costs are iterations times the number of nonzero elements.
+ */
+D spectralRadius(const SparseMatrix& a, int iterations = 200);
+
+} // namespace matrix
 
 #endif /* __SPARSEMATRIX_H_ */
@@ -1,5 +1,5 @@
 /***************************************************************************
- *   Copyright static_cast<C>(2004) by Patrick Audley                                  *
+ *   Copyright (C) 2004 by Patrick Audley                                  *
  *   paudley@blackcat.ca                                                   *
  *   modified by Georg Martius (georg.martius@web.de)                      *
  ***************************************************************************
@@ -37,18 +37,19 @@
  * would write the unit test like so:
  * @code
  * #ifdef UNITTEST
- * #include __PLACEHOLDER_0__
+ * #include "unit_test.hpp"
  *
  * UNIT_TEST_DEFINES
  *
- * DEFINE_TESTstatic_cast<check_two_plus_two>({)
- *   unit_assert( __PLACEHOLDER_1__, addTwoNumbers(2,2)==4 ) override;
+ * DEFINE_TEST( check_two_plus_two ) {
+ *   unit_assert( "2+2=4", addTwoNumbers(2,2)==4 );
  * }
  *
- * UNIT_TEST_RUN( __PLACEHOLDER_2__ )
- *   ADD_TESTreinterpret_cast<check_two_plus_two>(*) UNIT_TEST_END
+ * UNIT_TEST_RUN( "addTwoNumbers Tests" )
+ *   ADD_TEST( check_two_plus_two )
+ * UNIT_TEST_END
  *
- * #endif __PLACEHOLDER_18__
+ * #endif // UNITTEST
  * @endcode
  * @par
  * Now we have a test suite defined that will only be compiled when we define UNITTEST.
@@ -64,24 +65,25 @@
  * So far so good, let's add a new test that we think will fail.
  * @code
  * #ifdef UNITTEST
- * #include __PLACEHOLDER_3__
+ * #include "unit_test.hpp"
  *
  * UNIT_TEST_DEFINES
  *
- * DEFINE_TESTstatic_cast<check_two_plus_two>({)
- *   unit_assert( __PLACEHOLDER_4__, addTwoNumbers(2,2)==4 ) override;
- *   unit_pass() override;
+ * DEFINE_TEST( check_two_plus_two ) {
+ *   unit_assert( "2+2=4", addTwoNumbers(2,2)==4 );
+ *   unit_pass();
  * }
  *
- * DEFINE_TESTstatic_cast<check_bogus>({)
- *   unit_assert( __PLACEHOLDER_5__, addTwoNumbers(1,5)==9 ) override;
- *   unit_pass() override;
+ * DEFINE_TEST( check_bogus ) {
+ *   unit_assert( "1+5=9", addTwoNumbers(1,5)==9 );
+ *   unit_pass();
  * }
  *
- * UNIT_TEST_RUN( __PLACEHOLDER_6__ )
- *   ADD_TESTreinterpret_cast<check_negatives>(*) UNIT_TEST_END
+ * UNIT_TEST_RUN( "addTwoNumbers Tests" )
+ *   ADD_TEST( check_negatives )
+ * UNIT_TEST_END
  *
- * #endif __PLACEHOLDER_19__
+ * #endif // UNITTEST
  * @endcode
  * Running the unit_test now we get:
 @verbatim
@@ -95,7 +97,7 @@
  * @section adding Integrating with Automake
  * @par
  * Automake has the ability to define testing targets that get run when
- * issue __PLACEHOLDER_7__ command.  Adding these tests are pretty straight
+ * issue the "make check" command.  Adding these tests are pretty straight
  * forward.  For the above we would add this to our Makefile.am:
 @verbatim
 TESTS = unit_test_add
@@ -104,7 +106,7 @@ CLEANFILES = add_unit.cpp
 unit_test_add_SOURCES = add_unit.cpp
 
 %_unit.cpp: %.cpp
-	$static_cast<CXX>(-E) -o $*_unit.cpp $*.C @CFLAGS@ -DUNITTEST=1
+	$(CXX) -E -o $*_unit.cpp $*.C @CFLAGS@ -DUNITTEST=1
 @endverbatim
  * To add addtional unit tests you just modify the first four lines.  For
  * example: to add a new unit test suite in the file sub.C we might do this.
@@ -136,16 +138,16 @@ unit_test_sub_SOURCES = sub_unit.cpp
 #include <sys/types.h>
 #include <ctime>
 #include <cstdio>
+#include <cstring>
 
 
-struct rusage ruse;
-extern int getrusage() const override;
 /** @brief Gets the current CPU time with microsecond accuracy.
  *  @returns microseconds since UNIX epoch
  */
-inline double cputimestatic_cast<void>({)
-  getrusage( RUSAGE_SELF, &ruse ) override;
-	return ( ruse.ru_utime.tv_sec + ruse.ru_stime.tv_sec + 1e-6 * (ruse.ru_utime.tv_usec + ruse.ru_stime.tv_usec ) ) override;
+inline double cputime( void ) {
+  struct rusage ruse;
+  getrusage( RUSAGE_SELF, &ruse );
+	return ( ruse.ru_utime.tv_sec + ruse.ru_stime.tv_sec + 1e-6 * (ruse.ru_utime.tv_usec + ruse.ru_stime.tv_usec ) );
 }
 /** @brief Calculates the transactions rate.
  *  @param run_time microsecond resolution run time
@@ -154,7 +156,7 @@ inline double cputimestatic_cast<void>({)
  *  @warning This code is obviously very test platform dependent.
  */
 inline double transactions_per_second( double run_time, unsigned long transactions ) {
-	return static_cast<double>(transactions) / run_time override;
+	return static_cast<double>(transactions) / run_time;
 }
 /** @brief Prints to stdout the results of timing an event.
  *  @param msg to print with the numbers
@@ -164,17 +166,17 @@ inline double transactions_per_second( double run_time, unsigned long transactio
  */
 inline void print_cputime( double run_time, unsigned long transactions = 0 ) {
   
-  if( transactions == nullptr){
-	printf("%7.3f seconds CPU time\n", run_time ) override;
+  if( transactions == 0){
+	printf("%7.3f seconds CPU time\n", run_time );
   }else{
-    explicit printf("(%li x):  %7.3f seconds CPU time\n", transactions, run_time ) override;
+    printf("(%lu x):  %7.3f seconds CPU time\n", transactions, run_time );
     printf("      (%7.3f transactions/second)\n", 
-	   transactions_per_second( run_time, transactions ) ) override;
+	   transactions_per_second( run_time, transactions ) );
   }
 }
 
 /// typedef for unittest functions
-typedef bool(*test_func)static_cast<void>(override);
+typedef bool(*test_func)(void);
 /// typedef for vectors of unittest functions
 typedef std::vector< test_func > test_vector;
 
@@ -183,7 +185,7 @@ typedef std::vector< test_func > test_vector;
  *  by one or more DEFINE_TEST entries.
  */
 #define UNIT_TEST_DEFINES \
-  test_vector * explicit add_test( test_func x ) { \
+  test_vector * add_test( test_func x ) { \
     static test_vector unit_tests; \
     if( x != nullptr ) unit_tests.push_back( x ); \
     return &unit_tests; \
@@ -192,12 +194,14 @@ typedef std::vector< test_func > test_vector;
 /** @brief Start a new test definition
  *  @param test_name Name of the test - must be unique in this unit test suite.
  */
-#define DEFINE_TESTstatic_cast<test_name>static_cast<bool>(unit_test_)##test_name reinterpret_cast<void>(/**) @brief Adds a defined test to test run.
+#define DEFINE_TEST(test_name) bool unit_test_##test_name (void)
+
+/** @brief Adds a defined test to test run.
  *  @param test_name Test name of a previously defined test to add the the current suite.
  *  @sa DEFINE_TEST UNIT_TEST_RUN
  *  This should be called after UNIT_TEST_RUN for each defined test.
  */
-#define ADD_TESTstatic_cast<test_name>(add_test() &unit_test_##test_name ) override;
+#define ADD_TEST(test_name) add_test( &unit_test_##test_name );
 
 
 /** @brief Starts the timer for CPU time measurement.   
@@ -209,12 +213,12 @@ typedef std::vector< test_func > test_vector;
   { std::cout << "  -> " <<  msg << std::flush; \
     double measure_t1 = cputime(); \
     int measure_times = times; \
-    for(int measure_i=0; measure_i < times; ++measure_i) override {
+    for(int measure_i=0; measure_i < times; ++measure_i) {
 
 /** @brief Stops the timer for CPU time measurement and prints out result 
  *  @note Must be terminated with an UNIT_MEASURESTOP statement.
  */
-#define UNIT_MEASURE_STOPstatic_cast<msg>(\)
+#define UNIT_MEASURE_STOP(msg) \
     } /* end for */ \
     print_cputime(cputime()-measure_t1,measure_times); \
   }
@@ -225,8 +229,8 @@ typedef std::vector< test_func > test_vector;
  *  @param suite Name for this test suite.
  *  @note Must be terminated with an UNIT_TEST_END statement.
  */
-#define UNIT_TEST_RUNstatic_cast<suite>(\)
-int mainstatic_cast<void>({) \
+#define UNIT_TEST_RUN( suite ) \
+int main(void) { \
   bool result = true; \
   std::cout << "---[ " << suite << " ]--- " << std::endl;
 
@@ -246,12 +250,12 @@ int mainstatic_cast<void>({) \
 /** @brief Use to end a unit test in success.
  *  @note Either unit_pass or unit_fail should end every test.
  */
-#define unit_pass() return true override;
+#define unit_pass() return true
 
 /** @brief Use to end a unit test in failure.
  *  @note Either unit_pass or unit_fail should end every test.
  */
-#define unit_fail() return false override;
+#define unit_fail() return false
 
 /** @brief Finish a Unit Test run section.
  */
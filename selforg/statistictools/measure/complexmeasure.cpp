@@ -25,31 +25,104 @@
 
 
 #include "discretisizer.h"
-#include "sparsearray.h"
+#include <algorithm>
 #include <cmath>
 #include "stl_adds.h"
 #include <cassert>
 #include <cstdlib>
 
 
-ComplexMeasure::ComplexMeasure( const char* measureName, ComplexMeasureMode mode, int numberBins ) 
-  : AbstractMeasure( measureName ), mode( mode ), numberBins( numberBins ), 
-    fSize(0), historySize(2), historyIndex(-1), 
-    historyIndexList(0), historyIndexNumber(0), historyInterval(1), F(0)
+/************************** EntropyCounter **************************/
+
+double EntropyCounter::nlogn(int n)
 {
-  binNumberHistory = static_cast< int* >(malloc( sizeof( int ) * historySize ));
+  static const int TABLESIZE = 4096;
+  static const std::vector<double> table = [](){
+    std::vector<double> t(TABLESIZE, 0.0);
+    for (int i = 2; i < TABLESIZE; ++i)
+      t[i] = i * log(static_cast<double>(i));
+    return t;
+  }();
+  if (n < TABLESIZE)
+    return table[n];
+  return n * log(static_cast<double>(n));
 }
 
+void EntropyCounter::add(long bin)
+{
+  int& n = counts[bin];
+  sumNLogN += nlogn(n + 1) - nlogn(n);
+  ++n;
+  ++samples;
+  // the running sum is recalculated from time to time to avoid a drift by rounding errors
+  if (++updates > (1 << 20))
+  {
+    sumNLogN = 0;
+    for (const auto& c : counts)
+      sumNLogN += nlogn(c.second);
+    updates = 0;
+  }
+}
 
-ComplexMeasure::~ComplexMeasure()
+void EntropyCounter::remove(long bin)
+{
+  HashMap<long, int>::iterator it = counts.find(bin);
+  assert(it != counts.end() && it->second > 0);
+  int n = it->second;
+  sumNLogN += nlogn(n - 1) - nlogn(n);
+  if (n == 1)
+    counts.erase(it);
+  else
+    it->second = n - 1;
+  --samples;
+  ++updates;
+}
+
+double EntropyCounter::entropy() const
+{
+  if (samples == 0)
+    return 0;
+  double t = static_cast<double>(samples);
+  return std::max(0.0, log(t) - sumNLogN / t);
+}
+
+double EntropyCounter::computeEntropy() const
+{
+  // calculate Entropy = - sum {from forall i in F} p_i log p_i
+  double val = 0.0;
+  double t = static_cast<double>(samples);
+  for (const auto& c : counts)
+  {
+    double p = static_cast<double>(c.second) / t;
+    val += p * log(p);
+  }
+  return -val;
+}
+
+void EntropyCounter::clear()
 {
+  counts.clear();
+  samples = 0;
+  sumNLogN = 0;
+  updates = 0;
+}
+
 
-  if (binNumberHistory)
-    free(binNumberHistory);
+/************************** ComplexMeasure **************************/
 
-  if (historyIndexList)
-    free(historyIndexList);
+ComplexMeasure::ComplexMeasure( const char* measureName, ComplexMeasureMode mode, int numberBins ) 
+  : AbstractMeasure( measureName ), mode( mode ), numberBins( numberBins ), 
+    fSize(0), historySize(1), historyIndex(-1), historyInterval(1), historyCount(0),
+    windowSize(0), windowIndex(0)
+{
+  binNumberHistory.assign(historySize, 0);
+}
 
+
+ComplexMeasure::~ComplexMeasure()
+{
+  FOREACH(std::list<Discretisizer*>, discretisizerList, d)
+    delete *d;
   observedValueList.erase(observedValueList.begin(), observedValueList.end());
   discretisizerList.erase(discretisizerList.begin(), discretisizerList.end());
 }
@@ -57,55 +130,41 @@ ComplexMeasure::~ComplexMeasure()
 
 void ComplexMeasure::step()
 {
-  /*if (actualStep%1000== nullptr)
-  {
-    std::cout << __PLACEHOLDER_4__ << static_cast<float>(F).getRealSize() /1024 << __PLACEHOLDER_5__;
-    std::cout << __PLACEHOLDER_6__ << sizeof(int) * F.size() / 1024 << __PLACEHOLDER_7__ << F.size() << __PLACEHOLDER_8__ << std::endl;
-  }*/
   if (observedValueList.size()== 0)
     return;
-  int valNumber = 0;
-  int binNumber=0;
+  // joint state of all values: first + binRange * (state of the others)
+  const long binRange = numberBins + 1;
+  long binNumber = 0;
+  long factor = 1;
   std::list<Discretisizer*>::iterator di = discretisizerList.begin();
-  std::list<int> binList;
-  switch (mode)
+  FOREACH( std::list<double*>, observedValueList, oValue )
   {
-  case MI:
-  case PINF:/*
-    binNumber = ( *di ) ->getBinNumber( *(*oValue));
-    binList.push_back(binNumber);
-    for (int i=0; i<historysize;++i)
-    {
-      binNumber += static_cast<int>(pow)( numberBins,i+1)* binNumberHistory[historyIndexList[i]];
-      binList.push_back(binNumberHistory[historyIndexList[i]]);
-    }*/
-    break;
-  default: // ENT, ENTSLOW
-    FOREACH( std::list<double*>, observedValueList, oValue )
-    {
-      binNumber += static_cast<int>(pow( numberBins,valNumber++))* ( *di ) ->getBinNumber( *(*oValue));
-      ++di;
-    }
-    break;
+    binNumber += factor * ( *di ) ->getBinNumber( *(*oValue));
+    factor *= binRange;
+    ++di;
   }
 
   ++actualStep;
   switch ( mode )
   {
   case ENT:
-    updateEntropy( binNumber );
-    // now make update of F
-    F[ binNumber ] = F[ binNumber ] +1;
+    addSample(binNumber, 0);
+    updateEntropy();
     break;
   case ENTSLOW:
-    //  case ENT:
-    F[ binNumber ] = F[binNumber]+1;
+    addSample(binNumber, 0);
     computeEntropy();
     break;
   case MI:
-  case PINF:/*
-    calculatePI(binList);
-    updateFforPI(binNumber, binList);*/
+    addSample(binNumber % binRange, binNumber / binRange);
+    calculatePInf();
+    break;
+  case PINF:
+    if (historyCount == historySize)
+    { // the oldest state in the history is historyInterval steps ago
+      addSample(binNumberHistory[(historyIndex + 1) % historySize], binNumber);
+      calculatePInf();
+    }
     break;
   default:
     break;
@@ -113,33 +172,66 @@ void ComplexMeasure::step()
   ++historyIndex;
   if (historyIndex==historySize)
     historyIndex=0;
-binNumberHistory[historyIndex]=binNumber;
+  binNumberHistory[historyIndex]=binNumber;
+  if (historyCount < historySize)
+    ++historyCount;
 }
 
-  /*
-void ComplexMeasure::updateFforPI(int binNumber, std::list<int> binList)
+
+void ComplexMeasure::addSample(long a, long b)
 {
-  F[binNumber]++;
-  int i=0;
-  FOREACH( std::list<int>, binList, bin )  {
-    F[numberBins*numberBins+i*numberBins+bin]++;
+  if (windowSize > 0)
+  {
+    if (static_cast<int>(window.size()) < windowSize)
+      window.push_back(std::make_pair(a, b));
+    else
+    {
+      count(window[windowIndex].first, window[windowIndex].second, false);
+      window[windowIndex] = std::make_pair(a, b);
+    }
+    windowIndex = (windowIndex + 1) % windowSize;
   }
-}*/
-
+  count(a, b, true);
+}
 
 
-void ComplexMeasure::calculatePInf()
+void ComplexMeasure::count(long a, long b, bool add)
 {
-  // calculate PI
-  double val = 0.0;
-  for ( int i = 0; i < fSize;++i )
+  switch (mode)
   {
-    if ( F[ i ] > 0 )
+  case MI:
+  case PINF:
+  {
+    // joint bin of (a,b): a has numberBins+1 (MI) or fSize (PINF) values
+    long joint = a + b * (mode == MI ? numberBins + 1 : fSize);
+    if (add)
     {
-      val += ((static_cast<double>(F[i]))/(static_cast<double>(actualStep))) * log(static_cast<double>(F[i]) /(static_cast<double>(actualStep)));
+      FA.add(a);
+      FB.add(b);
+      F.add(joint);
     }
+    else
+    {
+      FA.remove(a);
+      FB.remove(b);
+      F.remove(joint);
+    }
+    break;
+  }
+  default: // ENT, ENTSLOW
+    if (add)
+      F.add(a);
+    else
+      F.remove(a);
+    break;
   }
-  value = -val;
+}
+
+
+void ComplexMeasure::calculatePInf()
+{
+  // I(A;B) = H(A) + H(B) - H(A,B), all entropies are updated incrementally
+  value = std::max(0.0, FA.entropy() + FB.entropy() - F.entropy());
 }
 
 void ComplexMeasure::addObservable(double& observedValue,double minValue, double maxValue)
@@ -151,46 +243,48 @@ void ComplexMeasure::addObservable(double& observedValue,double minValue, double
 }
 
 
-void ComplexMeasure::updateEntropy( int binNumber )
+void ComplexMeasure::setWindowSize(int windowSize)
 {
-  // calculate dS
-  double dS = 0;
-  double val = F[ binNumber ];
-  double t = actualStep;
-  if ( val > 0 )
-  { // calculating log(0) is not smart ;)
-    dS = (- val * log(val)) + ((val+1) * log(val+1));
-  }
-  // update Entropy with old Entropy and dS
-  if (actualStep>1)
-  {
-    value= - ((1./t) * (((value - log(t-1.))*(t-1.)) + dS)) + log(t);
-  }
+  this->windowSize = std::max(0, windowSize);
+  initF();
+}
+
+
+void ComplexMeasure::setHistoryInterval(int historyInterval)
+{
+  this->historyInterval = std::max(1, historyInterval);
+  initF();
+}
+
+
+void ComplexMeasure::updateEntropy()
+{
+  value = F.entropy();
 }
 
 
 void ComplexMeasure::computeEntropy()
 {
-  // calculate Entropy = - sum {from forall i in F} log F[i]
-  double val = 0.0;
-  for ( int i = 0; i < fSize;++i )
-  {
-    if ( F[ i ] > 0 )
-    {
-      val += ((static_cast<double>(F[i]))/(static_cast<double>(actualStep))) * log(static_cast<double>(F[i]) /(static_cast<double>(actualStep)));
-    }
-  }
-  value = -val;
+  value = F.computeEntropy();
 }
 
 
 void ComplexMeasure::initF()
 {
-  // determine fSize
-  if (mode==MI)
-    fSize = static_cast<int>(pow( numberBins, observedValueList.size() )) + (historyIndexNumber+1) * numberBins;
-  else
-    fSize = static_cast<int>(pow( numberBins, observedValueList.size() ));
-  F.reallocate(fSize);
+  // determine fSize (the Discretisizer returns bin numbers in [0, numberBins])
+  fSize = 1;
+  for (unsigned int i = 0; i < observedValueList.size(); ++i)
+    fSize *= numberBins + 1;
+  // the joint states of PINF are indexed by past + fSize*current
+  assert(mode != PINF || fSize <= (1L << 31));
+  F.clear();
+  FA.clear();
+  FB.clear();
+  historySize = historyInterval;
+  binNumberHistory.assign(historySize, 0);
+  historyIndex = -1;
+  historyCount = 0;
+  window.clear();
+  windowIndex = 0;
+  value = 0;
 }
-
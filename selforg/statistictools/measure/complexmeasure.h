@@ -26,8 +26,10 @@
 
 #include "abstractmeasure.h"
 #include <list>
+#include <utility>
+#include <vector>
 
-#include "sparsearray.h"
+#include "stl_map.h"
 
 /** measure modes of complex measures.
  */
@@ -36,15 +38,48 @@ enum ComplexMeasureMode {
   ENT,
   /// returns the entropy of the value, uses normal formula, needs O(n) or O(m*n)
   ENTSLOW,
-  /// returns the mutual information of two values, uses update formula, needs O(1)
+  /** returns the mutual information of the first value and the (joint) other values,
+      uses update formula, needs O(1) */
   MI,
-  /// returns the predictive information of two or more values
+  /** returns the predictive information of the (joint) values, i.e. the mutual information
+      between the current state and the state historyInterval steps before, needs O(1) */
   PINF
 };
 
 // forward declaration
 class Discretisizer;
 
+/**
+ * Frequency table with a running sum of n*log(n) over all bins.
+ * The entropy log(N) - 1/N sum_i n_i log(n_i) is updated in O(1)
+ * whenever a single count changes, also for removals (sliding windows).
+ */
+class EntropyCounter {
+public:
+  EntropyCounter() {}
+
+  /// counts a sample in the given bin
+  void add(long bin);
+  /// removes a sample of the given bin (that was added before)
+  void remove(long bin);
+  /// entropy (in nats) of the samples counted so far
+  double entropy() const;
+  /// entropy computed from scratch by a loop over all occupied bins
+  double computeEntropy() const;
+  long getSamples() const { return samples; }
+  const HashMap<long, int>& getCounts() const { return counts; }
+  void clear();
+
+protected:
+  /// n*log(n), tabulated for small n
+  static double nlogn(int n);
+
+  HashMap<long, int> counts;
+  long samples = 0;
+  double sumNLogN = 0;
+  long updates = 0; // number of changes since the last exact recalculation
+};
+
 class ComplexMeasure : public AbstractMeasure {
 
   public:
@@ -82,36 +117,61 @@ ComplexMeasure( const char* measureName, ComplexMeasureMode mode, int numberBins
      */
     virtual void step() override;
 
+    /**
+     * restricts the statistics to the last windowSize samples (0: all samples).
+     * Resets the statistics gathered so far.
+     */
+    virtual void setWindowSize(int windowSize);
+    virtual int getWindowSize() const { return windowSize; }
+
+    /**
+     * sets the time lag between the two states of the predictive information (PINF).
+     * Resets the statistics gathered so far.
+     */
+    virtual void setHistoryInterval(int historyInterval);
+    virtual int getHistoryInterval() const { return historyInterval; }
+
 
   protected:
   std::list<double*> observedValueList; // stores the adresses of the observedValues
   std::list<Discretisizer*> discretisizerList; // stores the Discretisizer
   ComplexMeasureMode mode;
   int numberBins = 0;
-  long fSize = 0; // size of F
+  long fSize = 0; // number of joint states of all observables
   int historySize = 0; // size of binNumberHistory
-//  int *F; // stores the frequencies as a linear vector
-  int *binNumberHistory; // holds the binNumbers as an history, for predictive information 2 values are enough
+  std::vector<long> binNumberHistory; // holds the last states for the predictive information
   int historyIndex = 0; // index of last stored value
-  int *historyIndexList; // indexes of relevant stored values
-  int historyIndexNumber = 0; // number of indexes stored in historyIndexList
   int historyInterval = 0; // interval between two different histoy indexes
+  long historyCount = 0; // number of states in binNumberHistory
+
+  int windowSize = 0; // number of samples in the sliding window, 0: unlimited
+  std::vector<std::pair<long, long> > window; // samples (a,b) of the window as ring buffer
+  int windowIndex = 0; // next slot of the window
+
+  EntropyCounter F;  // frequencies of the (joint) states
+  EntropyCounter FA; // frequencies of the first variable (MI, PINF)
+  EntropyCounter FB; // frequencies of the second variable (MI, PINF)
 
-  // new: use SparseArray backed by HashMap instead of normal array
-  SparseArray<long, int> F;
     // calculation methods
 
-      /**
-     * calculates the Predictive Information
+    /** adds the sample (a,b) to the frequencies and removes the
+        one that falls out of the window */
+    void addSample(long a, long b);
+
+    /// counts a sample (a,b) (b is ignored for the entropy modes)
+    void count(long a, long b, bool add);
+
+    /**
+     * calculates the Predictive Information or the mutual information
+     * I(A;B) = H(A) + H(B) - H(A,B)
      */
     void calculatePInf();
 
 
     /**
-     * updates the entropy. uses update rule with Ostatic_cast<1>(costs)
-     * @param binNumber the bin number
+     * updates the entropy. uses update rule with O(1) costs
      */
-    void updateEntropy( int binNumber);
+    void updateEntropy();
 
     /**
      * computes the entropy. uses the normal rule with O(m*n*o) costs
@@ -24,6 +24,15 @@
 #include "inspectable.h"
 #include "controller_misc.h"
 #include "stl_adds.h"
+#include <atomic>
+
+namespace {
+  // global counter, such that every change gets a version larger than all previous ones
+  std::atomic<unsigned long> layoutVersionCounter(0);
+  unsigned long nextLayoutVersion() {
+    return ++layoutVersionCounter;
+  }
+}
 
 Inspectable::~Inspectable() {}
 
@@ -51,6 +60,7 @@ Inspectable::getInternalParamNames() const {
 
 Inspectable::iparamvallist
 Inspectable::getInternalParams() const {
+  defaultInternalParams = true;
   iparamvallist vallist;
   FOREACHC(imatrixpairlist, mapOfMatrices, m) {
     if (m->second.first && (m->second.first->isVector() || !m->second.second)) {
@@ -90,6 +100,7 @@ Inspectable::addInspectableValue(const iparamkey& key,
                                  iparamval const* val,
                                  const std::string& descr) {
   mapOfValues += iparampair(key, val);
+  layoutVersion = nextLayoutVersion();
   if (!descr.empty())
     addInspectableDescription(key, descr);
 }
@@ -100,6 +111,7 @@ Inspectable::addInspectableMatrix(const iparamkey& key,
                                   bool only4x4AndDiag,
                                   const std::string& descr) {
   mapOfMatrices += imatrixpair(key, std::pair<const matrix::Matrix*, bool>(m, only4x4AndDiag));
+  layoutVersion = nextLayoutVersion();
   if (!descr.empty())
     addInspectableDescription(key + "_", descr);
 }
@@ -135,12 +147,14 @@ void
 Inspectable::addInspectable(Inspectable* insp) {
   listOfInspectableChildren.push_back(insp);
   insp->parent = this;
+  layoutVersion = nextLayoutVersion();
 }
 
 void
 Inspectable::removeInspectable(Inspectable* insp) {
   removeElement(listOfInspectableChildren, insp);
   insp->parent = 0;
+  layoutVersion = nextLayoutVersion();
 }
 
 void
@@ -157,3 +171,14 @@ const Inspectable::inspectableList&
 Inspectable::getInspectables() const {
   return listOfInspectableChildren;
 }
+
+unsigned long
+Inspectable::getLayoutVersion() const {
+  // every change gets a new maximal version, so the maximum changes with every modification
+  unsigned long version = layoutVersion;
+  FOREACHC(inspectableList, listOfInspectableChildren, i) {
+    if (*i)
+      version = std::max(version, (*i)->getLayoutVersion());
+  }
+  return version;
+}
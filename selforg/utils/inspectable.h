@@ -43,6 +43,7 @@ class Matrix;
  */
 class Inspectable {
 public:
+  friend class PlotOptionEngine; // resolves the registered values into a gather table
   // TYPEDEFS BEGIN
 
   using iparamkey = std::string;
@@ -244,6 +245,12 @@ public:
    */
   virtual const inspectableList& getInspectables() const;
 
+  /** version of the layout of the internal parameters (including the children).
+      It changes whenever values, matrices or children are added or removed.
+      Note that a change of the dimension of a registered matrix is not covered.
+   */
+  unsigned long getLayoutVersion() const;
+
   /* added when needed
   virtual void removeInspectable(const Inspectable* insp);
 
@@ -258,6 +265,10 @@ protected:
 
   infoLinesList infoLineStringList;
 
+  unsigned long layoutVersion = 0;
+  /// set by the default implementation of getInternalParams() (to detect overloading)
+  mutable bool defaultInternalParams = false;
+
 private:
   inspectableList listOfInspectableChildren;
   // bool printParentName; // unused member
@@ -28,6 +28,7 @@
 #include <cmath>
 #include <cstdlib>
 #include <ctime>
+#include <vector>
 
 #include "randomgenerator.h"
 
@@ -66,6 +67,14 @@ public:
       this->randGen->init(rand());
       this->ownRandGen = true;
     }
+    // the key of the bulk generator is taken from a copy of randGen,
+    // such that the numbers drawn by others (e.g. the controller) do not change.
+    // Generators sharing a randGen get different streams.
+    RandGen keyGen = *this->randGen;
+    uint64_t key = static_cast<uint64_t>(keyGen.rand() * 4294967296.0) << 32;
+    key |= static_cast<uint64_t>(keyGen.rand() * 4294967296.0);
+    bulkGen.init(key, this->randGen->streams++);
+    buffer.resize(dimension);
   };
 
   /** generate somehow distributed random number parameterized with min and max.
@@ -109,6 +118,11 @@ protected:
   unsigned int dimension;
   RandGen* randGen;
   bool ownRandGen;
+  /** counter based generator for the bulk draws in add() (keyed by randGen in init()).
+      It belongs to this noise generator, so the sequence does not depend on the
+      scheduling of other agents */
+  CounterRandGen bulkGen;
+  std::vector<double> buffer; ///< random numbers of one add() call (size dimension)
 };
 
 /// generates no noise
@@ -143,6 +157,14 @@ public:
     double x2 = uniform01();
     return ((sqrt(-2 * log(x1)) * cos(2 * M_PI * x2)));
   };
+
+  /// adds normal noise to all channels, the numbers are drawn in one block
+  virtual void add(double* value, double noiseStrength) override {
+    bulkGen.fillNormal(buffer.data(), dimension);
+    for (unsigned int i = 0; i < dimension; ++i) {
+      value[i] += buffer[i] * noiseStrength;
+    }
+  }
   // original version
   //  virtual double generate(double mean, double stddev) {
   //    double x1=uniform(0, 1);
@@ -246,8 +268,9 @@ public:
   }
 
   virtual void add(double* value, double noiseStrength) override {
+    bulkGen.fillNormal(buffer.data(), dimension);
     for (unsigned int i = 0; i < dimension; ++i) {
-      mean[i] += sqrttau * WhiteNormalNoise::generate() * noiseStrength - tau * mean[i];
+      mean[i] += sqrttau * buffer[i] * noiseStrength - tau * mean[i];
       value[i] += mean[i];
     }
   }
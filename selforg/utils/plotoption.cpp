@@ -32,40 +32,71 @@
 #include <sstream>
 #include <cstdlib>
 #include <cstring>
+#include <cstdint>
+#include <cerrno>
+#if defined(__unix__) || defined(__APPLE__)
+#define PLOTOPTION_MMAP
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 using namespace std;
 
+namespace {
+  // byte order tag of the binary logs written on this machine
+  const char* hostByteOrder() {
+    const uint16_t one = 1;
+    return *reinterpret_cast<const unsigned char*>(&one) == 1 ? "le" : "be";
+  }
+
+  // reads a line without the newline, returns false at the end of the file
+  bool readLine(FILE* f, string& line) {
+    line.clear();
+    int c;
+    while ((c = getc(f)) != EOF && c != '\n')
+      line += static_cast<char>(c);
+    return c != EOF || !line.empty();
+  }
+}
+
 bool
 PlotOption::open() {
   QMP_CRITICAL(601);
   char cmd[255];
   bool returnCode = true;
+  acceptedChannels = 0;
+  numChannels = 0;
+  layoutWarned = false;
   std::cout << "open a stream " << std::endl;
   switch (mode) {
     case PlotMode::File:
+    case PlotMode::BinaryFile: {
       struct tm* t;
       time_t tnow;
       time(&tnow);
       t = localtime(&tnow);
+      const char* ext = mode == PlotMode::File ? "log" : "blog";
       char logfilename[255];
       if (!parameter.empty()) {
-        snprintf(logfilename, sizeof(logfilename), "%s%s.log", parameter.c_str(), name.c_str());
+        snprintf(logfilename, sizeof(logfilename), "%s%s.%s", parameter.c_str(), name.c_str(), ext);
       } else {
         snprintf(logfilename,
                  sizeof(logfilename),
-                 "%s_%02i-%02i-%02i_%02i-%02i-%02i.log",
+                 "%s_%02i-%02i-%02i_%02i-%02i-%02i.%s",
                  name.c_str(),
                  t->tm_year % 100,
                  t->tm_mon + 1,
                  t->tm_mday,
                  t->tm_hour,
                  t->tm_min,
-                 t->tm_sec);
+                 t->tm_sec,
+                 ext);
       }
-      pipe = fopen(logfilename, "w");
+      pipe = fopen(logfilename, mode == PlotMode::File ? "w" : "w+b");
       if (pipe)
         std::cout << "Now logging to file \"" << logfilename << "\"." << std::endl;
       break;
+    }
     case PlotMode::GuiLogger_File:
       pipe = popen("guilogger -m pipe -l", "w");
       break;
@@ -183,6 +214,11 @@ PlotOption::close() {
         std::cout << "logfile closing...SUCCESSFUL" << std::endl;
         fclose(pipe);
         break;
+      case PlotMode::BinaryFile:
+        closeMapping();
+        std::cout << "binary logfile closing...SUCCESSFUL" << std::endl;
+        fclose(pipe);
+        break;
       case PlotMode::GuiLogger:
       case PlotMode::GuiLogger_File:
         // std::cout << __PLACEHOLDER_42__
@@ -215,6 +251,7 @@ PlotOption::close() {
     }
     pipe = 0;
   }
+  numChannels = 0;
   QMP_END_CRITICAL(602);
 }
 
@@ -225,7 +262,8 @@ PlotOption::flush(long step) {
   if (pipe) {
     switch (mode) {
       case PlotMode::File:
-        if ((step % (interval * 1000)) == 0)
+      case PlotMode::BinaryFile:
+        if (!mapData && (step % (interval * 1000)) == 0)
           fflush(pipe);
         break;
       case PlotMode::GuiLogger:
@@ -312,11 +350,12 @@ PlotOption::printInspectableNames(const list<const Inspectable*>& inspectables,
         if (useChannel(str)) {
           fprintf(pipe, " %s", str.c_str());
           mask[cnt] = true;
+          ++acceptedChannels;
         } else
           mask[cnt] = false;
         ++cnt;
       }
-      cnt += printInspectableNames((*insp)->getInspectables(), cnt);
+      cnt = printInspectableNames((*insp)->getInspectables(), cnt);
     }
   }
   return cnt;
@@ -342,7 +381,7 @@ PlotOption::printInspectables(const std::list<const Inspectable*>& inspectables,
         }
         ++cnt;
       }
-      cnt += printInspectables((*insp)->getInspectables(), cnt);
+      cnt = printInspectables((*insp)->getInspectables(), cnt);
     }
   }
   return cnt;
@@ -411,3 +450,147 @@ PlotOption::printNetworkDescription(const string& name, const Inspectable* inspe
   }
   fprintf(pipe, "#N nn_end\n");
 }
+
+bool
+PlotOption::startBinaryRecords() {
+  if (!pipe || mode != PlotMode::BinaryFile)
+    return false;
+  numChannels = acceptedChannels + 1; // time + channels
+  record.reserve(numChannels);
+  // pad the line such that the records are aligned to doubles (for mmap based readers)
+  char line[64];
+  snprintf(line, sizeof(line), "#B float64 %s %i", hostByteOrder(), numChannels);
+  long pos = ftell(pipe) + static_cast<long>(strlen(line)) + 1;
+  int pad = pos < 0 ? 0 : static_cast<int>((8 - pos % 8) % 8);
+  fprintf(pipe, "%s%*s\n", line, pad, "");
+#ifdef PLOTOPTION_MMAP
+  if (memoryMapped) {
+    fflush(pipe);
+    mapUsed = ftell(pipe);
+    if (!growMapping(mapUsed + (1 << 20))) {
+      fprintf(stderr, "PlotOption: cannot map log file, using buffered output\n");
+    }
+  }
+#endif
+  return true;
+}
+
+void
+PlotOption::printValues(double time, const vector<double>& values) {
+  if (!pipe)
+    return;
+  // values without an entry in the mask are not in the header (#C line) and are skipped
+  const size_t n = min(values.size(), mask.size());
+  if (numChannels == 0) {
+    fprintf(pipe, "%f", time);
+    for (size_t i = 0; i < n; ++i) {
+      if (mask[i])
+        fprintf(pipe, " %f", values[i]);
+    }
+    fprintf(pipe, "\n");
+    return;
+  }
+
+  record.clear();
+  record.push_back(time);
+  for (size_t i = 0; i < n; ++i) {
+    if (mask[i])
+      record.push_back(values[i]);
+  }
+  if (static_cast<int>(record.size()) != numChannels) {
+    // records have a fixed size: the header cannot be changed anymore
+    if (!layoutWarned) {
+      fprintf(stderr,
+              "PlotOption: number of channels changed (%zu instead of %i), records are adjusted\n",
+              record.size(),
+              numChannels);
+      layoutWarned = true;
+    }
+    record.resize(numChannels, 0.0);
+  }
+  const size_t bytes = numChannels * sizeof(double);
+  if (mapData && mapUsed + bytes > mapSize && !growMapping(2 * mapSize + bytes)) {
+    fprintf(stderr, "PlotOption: cannot enlarge mapping of log file, using buffered output\n");
+    closeMapping();
+  }
+  if (mapData) {
+    memcpy(mapData + mapUsed, record.data(), bytes);
+    mapUsed += bytes;
+  } else {
+    fwrite(record.data(), sizeof(double), numChannels, pipe);
+  }
+}
+
+bool
+PlotOption::growMapping(size_t minSize) {
+#ifdef PLOTOPTION_MMAP
+  // the old mapping stays valid if anything fails
+  int fd = fileno(pipe);
+  if (ftruncate(fd, static_cast<off_t>(minSize)) != 0)
+    return false;
+  void* data = mmap(nullptr, minSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (data == MAP_FAILED)
+    return false;
+  if (mapData)
+    munmap(mapData, mapSize);
+  mapData = static_cast<char*>(data);
+  mapSize = minSize;
+  return true;
+#else
+  return false;
+#endif
+}
+
+void
+PlotOption::closeMapping() {
+#ifdef PLOTOPTION_MMAP
+  if (!mapData)
+    return;
+  munmap(mapData, mapSize);
+  mapData = nullptr;
+  mapSize = 0;
+  // cut the reserved space and continue behind the records (if the output is buffered now)
+  if (ftruncate(fileno(pipe), static_cast<off_t>(mapUsed)) != 0)
+    fprintf(stderr, "PlotOption: cannot truncate log file: %s\n", strerror(errno));
+  fseek(pipe, static_cast<long>(mapUsed), SEEK_SET);
+#endif
+}
+
+bool
+PlotOption::convertBinaryLog(FILE* in, FILE* out) {
+  if (!in || !out)
+    return false;
+  string line;
+  int channels = 0;
+  // comment lines are copied
+  while (readLine(in, line)) {
+    if (line.compare(0, 2, "#B") == 0) {
+      char type[16];
+      char order[4];
+      if (sscanf(line.c_str(), "#B %15s %3s %i", type, order, &channels) != 3 ||
+          strcmp(type, "float64") != 0 || channels < 1) {
+        fprintf(stderr, "PlotOption: invalid binary header: %s\n", line.c_str());
+        return false;
+      }
+      if (strcmp(order, hostByteOrder()) != 0) {
+        fprintf(stderr, "PlotOption: byte order %s of binary log is not supported\n", order);
+        return false;
+      }
+      break;
+    }
+    fprintf(out, "%s\n", line.c_str());
+  }
+  if (channels == 0) {
+    fprintf(stderr, "PlotOption: no binary records found\n");
+    return false;
+  }
+  // records (same number format as in printInspectables)
+  vector<double> rec(channels);
+  while (fread(rec.data(), sizeof(double), channels, in) == static_cast<size_t>(channels)) {
+    fprintf(out, "%f", rec[0]);
+    for (int i = 1; i < channels; ++i)
+      fprintf(out, " %f", rec[i]);
+    fprintf(out, "\n");
+  }
+  return true;
+}
@@ -53,6 +53,14 @@ enum PlotMode {
   /// gui for ECBRobots (see lpzrobots/ecbrobots), should be usable with OdeRobots, too
   ECBRobotGUI,
 
+  /** write into file in binary format (no formatting of the numbers).
+      The file starts with the same comment lines as a File log (including the #C line),
+      followed by a line "#B float64 le|be N" that is padded such that the data starts at
+      an offset divisible by 8. The data are records of N raw doubles (time and channels).
+      @see PlotOption::convertBinaryLog
+  */
+  BinaryFile,
+
   /// dummy used for upper bound of plotmode type
   LastPlot
 };
@@ -135,6 +143,16 @@ public:
   bool open();  ///< opens the connections to the plot tool
   void close(); ///< closes the connections to the plot tool
 
+  /** use a memory mapped file instead of buffered writes for the records (only BinaryFile).
+      Must be called before open(). Ignored on systems without mmap.
+   */
+  void setMemoryMapped(bool memoryMapped) {
+    this->memoryMapped = memoryMapped;
+  }
+  bool isMemoryMapped() const {
+    return memoryMapped;
+  }
+
   virtual bool useChannel(const std::string& name);
 
   virtual int printInspectables(const std::list<const Inspectable*>& inspectables, int cnt = 0);
@@ -165,6 +183,26 @@ public:
   */
   void printNetworkDescription(const std::string& name, const Inspectable* inspectable);
 
+  /** finishes the header of a BinaryFile log (to be called after the #C line).
+      All following output goes into binary records written by printValues().
+   */
+  bool startBinaryRecords();
+
+  /** writes one line (or binary record) with the time and the accepted channels.
+      @param values all channels in the order of printInspectableNames()
+   */
+  virtual void printValues(double time, const std::vector<double>& values);
+
+  /// true if the comment lines are finished and the stream contains binary records
+  bool isBinaryStream() const {
+    return numChannels > 0;
+  }
+
+  /** converts a log file written in the BinaryFile mode into the text format of a File log.
+      @return false if the input is not a valid binary log
+   */
+  static bool convertBinaryLog(FILE* in, FILE* out);
+
   FILE* pipe;
   long t;
   int interval;
@@ -176,6 +214,20 @@ private:
   std::list<std::string> accept; ///< channels to accept (use) (empty means all)
   std::list<std::string> ignore; ///< channels not ignore      (empty means ignore non)
   std::vector<bool> mask; ///< mask for accepting channels (calculated from accept and ignore)
+
+  // binary records (BinaryFile)
+  bool memoryMapped = false;
+  int acceptedChannels = 0;    ///< number of channels in the #C line (without time)
+  int numChannels = 0;         ///< number of doubles per record (0: no binary records yet)
+  std::vector<double> record;  ///< buffer for the current record
+  bool layoutWarned = false;
+  // memory mapped backend
+  char* mapData = nullptr;
+  size_t mapSize = 0;    ///< size of the mapping (and of the file while writing)
+  size_t mapUsed = 0;    ///< bytes used in the mapping (header and records)
+
+  bool growMapping(size_t minSize);
+  void closeMapping();
 };
 
 #endif /* PLOTOPTION_H_ */
@@ -23,8 +23,10 @@
  ***************************************************************************/
 
 #include "plotoptionengine.h"
+#include "controller_misc.h"
 #include "inspectable.h"
 #include "plotoption.h"
+#include <selforg/matrix.h>
 #include <algorithm>
 #include <cassert>
 #include <clocale> // need to set LC_NUMERIC to have a __PLACEHOLDER_22__ in the numbers written or piped to gnuplot
@@ -67,6 +69,7 @@ PlotOptionEngine::init(AbstractController* maybe_controller) {
   FOREACH(list<PlotOption>, plotOptions, po) {
     initPlotOption(*po);
   }
+  buildGatherTable();
   initialised = true;
   return true;
 }
@@ -102,6 +105,8 @@ PlotOptionEngine::initPlotOption(PlotOption& po) {
     fprintf(po.pipe, "#C t");
     po.printInspectableNames(inspectables, 0);
     fprintf(po.pipe, "\n"); // terminate line
+    if (po.mode == PlotMode::BinaryFile)
+      return po.startBinaryRecords();
     return true;
   } else {
     fprintf(stderr, "Opening of pipe for PlotOption failed!\n");
@@ -177,6 +182,7 @@ PlotOptionEngine::addInspectable(const Inspectable* inspectable, bool front) {
   if (front) inspectables.push_front(inspectable);
   else
     inspectables.push_back(inspectable);
+  gatherTableValid = false;
 }
 
 void
@@ -189,7 +195,8 @@ void
 PlotOptionEngine::writePlotComment(const char* cmt, bool addSpace) {
   assert(initialised);
   for (auto& po : plotOptions) {
-    if ((po.pipe) && (strlen(cmt) > 0)) { // for the guilogger pipe
+    // comments cannot be placed between the records of a binary log
+    if ((po.pipe) && !po.isBinaryStream() && (strlen(cmt) > 0)) { // for the guilogger pipe
       char last = cmt[strlen(cmt) - 1];
       if (addSpace) fprintf(po.pipe, "# %s", cmt);
       else
@@ -205,17 +212,132 @@ void
 PlotOptionEngine::plot(double time) {
   assert(initialised);
 
+  bool gathered = false;
   for (list<PlotOption>::iterator i = plotOptions.begin(); i != plotOptions.end(); ++i) {
     if (((*i).pipe) && ((*i).interval > 0) && (t % (*i).interval == 0)) {
-      fprintf((*i).pipe, "%f", time);
-      i->printInspectables(inspectables, 0);
-      fprintf((*i).pipe, "\n"); // terminate line
+      if (!gathered) { // the values are collected once for all plotoptions
+        if (!gatherTableValid || getLayoutVersion() != layoutVersion || !gather()) {
+          buildGatherTable();
+          gather();
+        }
+        gathered = true;
+      }
+      i->printValues(time, gatherValues);
       (*i).flush(t);
     }
   }
   ++t;
 }
 
+unsigned long
+PlotOptionEngine::getLayoutVersion() const {
+  unsigned long version = 0;
+  FOREACHC(list<const Inspectable*>, inspectables, i) {
+    if (*i)
+      version = max(version, (*i)->getLayoutVersion());
+  }
+  return version;
+}
+
+void
+PlotOptionEngine::buildGatherTable() {
+  layoutVersion = getLayoutVersion();
+  gatherTable.clear();
+  addToGatherTable(inspectables);
+  size_t size = 0;
+  for (const GatherEntry& e : gatherTable)
+    size += e.size;
+  gatherValues.resize(size);
+  gatherTableValid = true;
+}
+
+void
+PlotOptionEngine::addToGatherTable(const list<const Inspectable*>& inspectables) {
+  // same order as in Inspectable::getInternalParamNames(): matrices, values, children
+  FOREACHC(list<const Inspectable*>, inspectables, it) {
+    const Inspectable* insp = *it;
+    if (!insp)
+      continue;
+    const size_t first = gatherTable.size();
+    size_t size = 0;
+    FOREACHC(Inspectable::imatrixpairlist, insp->mapOfMatrices, m) {
+      const matrix::Matrix* mat = m->second.first;
+      if (!mat)
+        continue;
+      GatherEntry e;
+      e.matrix = mat;
+      e.only4x4AndDiag = m->second.second && !mat->isVector();
+      e.rows = mat->getM();
+      e.cols = mat->getN();
+      e.size = e.only4x4AndDiag ? get4x4AndDiagonalSize(*mat) : mat->size();
+      gatherTable.push_back(e);
+      size += e.size;
+    }
+    FOREACHC(Inspectable::iparampairlist, insp->mapOfValues, v) {
+      GatherEntry e;
+      e.value = v->second;
+      e.size = 1;
+      gatherTable.push_back(e);
+      size += 1;
+    }
+    // the table can only be used if getInternalParams() is not overloaded:
+    //  it must be called and give the same values
+    insp->defaultInternalParams = false;
+    const Inspectable::iparamvallist l = insp->getInternalParams();
+    bool useTable = insp->defaultInternalParams && l.size() == size;
+    if (useTable) {
+      vector<double> tableValues(size);
+      double* dst = tableValues.data();
+      for (size_t k = first; k < gatherTable.size(); ++k) {
+        gatherEntry(gatherTable[k], dst);
+        dst += gatherTable[k].size;
+      }
+      useTable = equal(l.begin(), l.end(), tableValues.begin(), [](double a, double b) {
+        return memcmp(&a, &b, sizeof(double)) == 0; // also for nan
+      });
+    }
+    if (!useTable) {
+      gatherTable.resize(first);
+      GatherEntry e;
+      e.inspectable = insp;
+      e.size = l.size();
+      gatherTable.push_back(e);
+    }
+    addToGatherTable(insp->getInspectables());
+  }
+}
+
+bool
+PlotOptionEngine::gatherEntry(const GatherEntry& e, double* dst) {
+  if (e.value) {
+    *dst = *e.value;
+  } else if (e.matrix) {
+    if (e.matrix->getM() != e.rows || e.matrix->getN() != e.cols)
+      return false;
+    if (e.only4x4AndDiag)
+      store4x4AndDiagonal(*e.matrix, dst, e.size);
+    else
+      e.matrix->convertToBuffer(dst, e.size);
+  } else if (e.inspectable) {
+    const Inspectable::iparamvallist l = e.inspectable->getInternalParams();
+    if (l.size() != e.size)
+      return false;
+    copy(l.begin(), l.end(), dst);
+  }
+  return true;
+}
+
+bool
+PlotOptionEngine::gather() {
+  double* dst = gatherValues.data();
+  for (const GatherEntry& e : gatherTable) {
+    if (!gatherEntry(e, dst))
+      return false;
+    dst += e.size;
+  }
+  return true;
+}
+
 // GEORG: it is better to plot it at initialization time!
 // void PlotOptionEngine::plotNames()
 // {
@@ -26,6 +26,7 @@
 #define PLOTOPTIONENGINE_H_
 
 #include <list>
+#include <vector>
 
 #include "plotoption.h"
 #include <selforg/abstractcontroller.h>
@@ -101,6 +102,34 @@ public:
 protected:
   bool initPlotOption(PlotOption& po);
 
+  /** entry of the gather table: one registered value, one registered matrix or
+      all values of an inspectable that overloads getInternalParams()
+   */
+  struct GatherEntry {
+    const Inspectable::iparamval* value = nullptr;
+    const matrix::Matrix* matrix = nullptr;
+    bool only4x4AndDiag = false;
+    const Inspectable* inspectable = nullptr;
+    unsigned int rows = 0; ///< dimension of the matrix when the table was built
+    unsigned int cols = 0;
+    size_t size = 0;    ///< number of values
+  };
+
+  /// resolves the internal parameters of all inspectables into the gather table
+  void buildGatherTable();
+  void addToGatherTable(const std::list<const Inspectable*>& inspectables);
+  /// copies all values into gatherValues, @return false if the layout has changed
+  bool gather();
+  /// copies the values of one entry to dst, @return false if the layout has changed
+  static bool gatherEntry(const GatherEntry& e, double* dst);
+  /// maximal layout version of the inspectables
+  unsigned long getLayoutVersion() const;
+
+  std::vector<GatherEntry> gatherTable;
+  std::vector<double> gatherValues;  ///< values of all channels (order as in the #C line)
+  unsigned long layoutVersion = 0;   ///< version of the inspectables used for the table
+  bool gatherTableValid = false;
+
   std::list<PlotOption> plotOptions;
   std::list<const Inspectable*> inspectables;
   std::list<const Configurable*> configureables;
@@ -0,0 +1,310 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2011 LpzRobots development team                    *
+ *    Georg Martius  <georg dot martius at web dot de>                     *
+ *    Frank Guettler <guettler at informatik dot uni-leipzig dot de        *
+ *    Frank Hesse    <frank at nld dot ds dot mpg dot de>                  *
+ *    Ralf Der       <ralfder at mis dot mpg dot de>                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "prototypeset.h"
+
+#include <algorithm>
+#include <cassert>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PROTOTYPESET_X86
+#include <immintrin.h>
+#endif
+
+using namespace matrix;
+
+namespace {
+
+/* squared distances of x to the count prototypes in W (dim x count, row-wise).
+   All kernels perform the same operations per prototype in the same order
+   (no fused multiply-add), thus they give identical results. */
+using DistanceKernel = void (*)(const double* W, unsigned int count, unsigned int dim,
+                                const double* x, double* d);
+
+void
+distances_scalar(const double* W, unsigned int count, unsigned int dim, const double* x,
+                 double* d) {
+  std::fill(d, d + count, 0.0);
+  for (unsigned int j = 0; j < dim; ++j) {
+    const double xj = x[j];
+    const double* w = W + j * count;
+    for (unsigned int i = 0; i < count; ++i) {
+      const double diff = xj - w[i];
+      d[i] += diff * diff;
+    }
+  }
+}
+
+#ifdef PROTOTYPESET_X86
+
+__attribute__((target("sse2"))) void
+distances_sse2(const double* W, unsigned int count, unsigned int dim, const double* x,
+               double* d) {
+  unsigned int i = 0;
+  for (; i + 2 <= count; i += 2) {
+    __m128d acc = _mm_setzero_pd();
+    for (unsigned int j = 0; j < dim; ++j) {
+      const __m128d diff = _mm_sub_pd(_mm_set1_pd(x[j]), _mm_loadu_pd(W + j * count + i));
+      acc = _mm_add_pd(acc, _mm_mul_pd(diff, diff));
+    }
+    _mm_storeu_pd(d + i, acc);
+  }
+  for (; i < count; ++i) {
+    double acc = 0;
+    for (unsigned int j = 0; j < dim; ++j) {
+      const double diff = x[j] - W[j * count + i];
+      acc += diff * diff;
+    }
+    d[i] = acc;
+  }
+}
+
+__attribute__((target("avx2"))) void
+distances_avx2(const double* W, unsigned int count, unsigned int dim, const double* x,
+               double* d) {
+  unsigned int i = 0;
+  for (; i + 8 <= count; i += 8) { // two registers to hide the latency of the adds
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    for (unsigned int j = 0; j < dim; ++j) {
+      const __m256d xj = _mm256_set1_pd(x[j]);
+      const double* w = W + j * count + i;
+      const __m256d diff0 = _mm256_sub_pd(xj, _mm256_loadu_pd(w));
+      const __m256d diff1 = _mm256_sub_pd(xj, _mm256_loadu_pd(w + 4));
+      acc0 = _mm256_add_pd(acc0, _mm256_mul_pd(diff0, diff0));
+      acc1 = _mm256_add_pd(acc1, _mm256_mul_pd(diff1, diff1));
+    }
+    _mm256_storeu_pd(d + i, acc0);
+    _mm256_storeu_pd(d + i + 4, acc1);
+  }
+  for (; i < count; ++i) {
+    double acc = 0;
+    for (unsigned int j = 0; j < dim; ++j) {
+      const double diff = x[j] - W[j * count + i];
+      acc += diff * diff;
+    }
+    d[i] = acc;
+  }
+}
+
+#endif
+
+DistanceKernel
+selectKernel() {
+#ifdef PROTOTYPESET_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return distances_avx2;
+  if (__builtin_cpu_supports("sse2"))
+    return distances_sse2;
+#endif
+  return distances_scalar;
+}
+
+inline double
+squaredDistance(const double* x, const double* p, unsigned int dim) {
+  double acc = 0;
+  for (unsigned int j = 0; j < dim; ++j) {
+    const double diff = x[j] - p[j];
+    acc += diff * diff;
+  }
+  return acc;
+}
+
+// points per leaf of the k-d tree
+constexpr unsigned int LEAFSIZE = 8;
+
+} // namespace
+
+PrototypeSet::PrototypeSet()
+  : useTree(false)
+  , treeValid(false) {}
+
+void
+PrototypeSet::init(unsigned int dim, unsigned int count) {
+  protos.set(dim, count);
+  treeValid = false;
+}
+
+Matrix
+PrototypeSet::getPrototype(unsigned int i) const {
+  return protos.column(i);
+}
+
+void
+PrototypeSet::setPrototype(unsigned int i, const Matrix& p) {
+  assert(p.getM() == getDim() && i < size());
+  for (unsigned int j = 0; j < getDim(); ++j)
+    protos.val(j, i) = p.val(j, 0);
+  treeValid = false;
+}
+
+void
+PrototypeSet::moveTowards(unsigned int i, const double* x, double factor) {
+  assert(i < size());
+  for (unsigned int j = 0; j < getDim(); ++j) {
+    double& w = protos.val(j, i);
+    w = w + (x[j] - w) * factor;
+  }
+  treeValid = false;
+}
+
+void
+PrototypeSet::distances(const double* x, double* d) const {
+  static const DistanceKernel kernel = selectKernel();
+  kernel(protos.unsafeGetData(), size(), getDim(), x, d);
+}
+
+void
+PrototypeSet::distances(const Matrix& x, Matrix& d) const {
+  assert(x.size() == getDim());
+  if (d.getM() != size() || d.getN() != 1)
+    d.set(size(), 1);
+  distances(x.unsafeGetData(), d.unsafeGetData());
+}
+
+void
+PrototypeSet::rank(const double* d, unsigned int count, unsigned int k, Ranking& ranking) {
+  ranking.resize(count);
+  for (unsigned int i = 0; i < count; ++i)
+    ranking[i] = std::make_pair(d[i], i);
+  if (k >= count)
+    std::sort(ranking.begin(), ranking.end());
+  else
+    std::partial_sort(ranking.begin(), ranking.begin() + k, ranking.end());
+}
+
+void
+PrototypeSet::kNearest(const double* x, unsigned int k, Ranking& result) const {
+  k = std::min(k, size());
+  if (!useTree) {
+    scratch.resize(size());
+    distances(x, scratch.data());
+    rank(scratch.data(), size(), k, result);
+    result.resize(k);
+    return;
+  }
+  if (!treeValid)
+    buildTree();
+  result.clear();
+  if (k > 0 && !tree.empty())
+    searchNode(0, x, k, result);
+  std::sort_heap(result.begin(), result.end());
+}
+
+void
+PrototypeSet::setUseTree(bool _useTree) {
+  useTree = _useTree;
+  if (!useTree) {
+    tree.clear();
+    treeIndex.clear();
+    treePoints.clear();
+    treeValid = false;
+  }
+}
+
+void
+PrototypeSet::buildTree() const {
+  const unsigned int count = size();
+  const unsigned int dim = getDim();
+  tree.clear();
+  treeIndex.resize(count);
+  for (unsigned int i = 0; i < count; ++i)
+    treeIndex[i] = i;
+  if (count > 0)
+    buildNode(0, count);
+  // copy the points in tree order for a linear access in the leafs
+  treePoints.resize(count * dim);
+  for (unsigned int p = 0; p < count; ++p)
+    for (unsigned int j = 0; j < dim; ++j)
+      treePoints[p * dim + j] = protos.val(j, treeIndex[p]);
+  treeValid = true;
+}
+
+int
+PrototypeSet::buildNode(unsigned int begin, unsigned int end) const {
+  const int node = static_cast<int>(tree.size());
+  tree.push_back(TreeNode{ begin, end, 0, 0.0, -1, -1 });
+  if (end - begin <= LEAFSIZE)
+    return node;
+  // split at the median of the dimension with the largest extent
+  unsigned int splitDim = 0;
+  double maxExtent = -1;
+  for (unsigned int j = 0; j < getDim(); ++j) {
+    double lo = protos.val(j, treeIndex[begin]);
+    double hi = lo;
+    for (unsigned int p = begin + 1; p < end; ++p) {
+      const double v = protos.val(j, treeIndex[p]);
+      lo = std::min(lo, v);
+      hi = std::max(hi, v);
+    }
+    if (hi - lo > maxExtent) {
+      maxExtent = hi - lo;
+      splitDim = j;
+    }
+  }
+  const unsigned int mid = (begin + end) / 2;
+  std::nth_element(treeIndex.begin() + begin, treeIndex.begin() + mid, treeIndex.begin() + end,
+                   [this, splitDim](unsigned int a, unsigned int b) {
+                     const double va = protos.val(splitDim, a);
+                     const double vb = protos.val(splitDim, b);
+                     return va < vb || (va == vb && a < b);
+                   });
+  const double splitValue = protos.val(splitDim, treeIndex[mid]);
+  const int left = buildNode(begin, mid);
+  const int right = buildNode(mid, end);
+  tree[node].splitDim = splitDim;
+  tree[node].splitValue = splitValue;
+  tree[node].left = left;
+  tree[node].right = right;
+  return node;
+}
+
+void
+PrototypeSet::searchNode(int node, const double* x, unsigned int k, Ranking& heap) const {
+  const TreeNode& n = tree[node];
+  if (n.left < 0) { // leaf: the heap keeps the k best candidates, worst on top
+    const unsigned int dim = getDim();
+    for (unsigned int p = n.begin; p < n.end; ++p) {
+      const std::pair<double, unsigned int> c(
+        squaredDistance(x, treePoints.data() + p * dim, dim), treeIndex[p]);
+      if (heap.size() < k) {
+        heap.push_back(c);
+        std::push_heap(heap.begin(), heap.end());
+      } else if (c < heap.front()) {
+        std::pop_heap(heap.begin(), heap.end());
+        heap.back() = c;
+        std::push_heap(heap.begin(), heap.end());
+      }
+    }
+    return;
+  }
+  // points left of the split are <= splitValue, right of it >= splitValue
+  const double diff = x[n.splitDim] - n.splitValue;
+  const int nearChild = diff < 0 ? n.left : n.right;
+  const int farChild = diff < 0 ? n.right : n.left;
+  searchNode(nearChild, x, k, heap);
+  if (heap.size() < k || diff * diff <= heap.front().first)
+    searchNode(farChild, x, k, heap);
+}
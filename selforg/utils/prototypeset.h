@@ -0,0 +1,125 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2011 LpzRobots development team                    *
+ *    Georg Martius  <georg dot martius at web dot de>                     *
+ *    Frank Guettler <guettler at informatik dot uni-leipzig dot de        *
+ *    Frank Hesse    <frank at nld dot ds dot mpg dot de>                  *
+ *    Ralf Der       <ralfder at mis dot mpg dot de>                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __PROTOTYPESET_H
+#define __PROTOTYPESET_H
+
+#include <selforg/matrix.h>
+
+#include <utility>
+#include <vector>
+
+/**
+ * Set of prototype vectors (codebook) for vector quantisers like NeuralGas and SOM.
+ *
+ * All prototypes are stored in one contiguous matrix with one prototype per
+ * column, such that the squared distances of an input to all prototypes are
+ * computed in one batched loop that runs over the prototypes in the innermost
+ * loop (SSE2/AVX2 kernels are chosen at runtime). The results of all kernels
+ * are identical.
+ *
+ * For large numbers of prototypes an optional k-d tree answers nearest
+ * neighbour queries (kNearest()) without looking at all prototypes.
+ * The tree is rebuild lazily after the prototypes were changed.
+ */
+class PrototypeSet {
+public:
+  /// pairs of (squared distance, index of prototype)
+  using Ranking = std::vector<std::pair<double, unsigned int>>;
+
+  PrototypeSet();
+
+  /// sets the dimension and the number of prototypes (all zero)
+  void init(unsigned int dim, unsigned int count);
+
+  /// dimension of the prototypes
+  unsigned int getDim() const {
+    return protos.getM();
+  }
+  /// number of prototypes
+  unsigned int size() const {
+    return protos.getN();
+  }
+
+  /// @return element j of prototype i
+  double val(unsigned int i, unsigned int j) const {
+    return protos.val(j, i);
+  }
+  /// @return the prototype i as column vector
+  matrix::Matrix getPrototype(unsigned int i) const;
+  /// sets the prototype i (column vector)
+  void setPrototype(unsigned int i, const matrix::Matrix& p);
+  /// moves prototype i towards x: \f$ w_i += factor (x - w_i) \f$
+  void moveTowards(unsigned int i, const double* x, double factor);
+  /// all prototypes (one per column)
+  const matrix::Matrix& getPrototypes() const {
+    return protos;
+  }
+
+  /// computes the squared distances of x (getDim() elements) to all prototypes into d
+  void distances(const double* x, double* d) const;
+  /// squared distances of the column vector x to all prototypes, d is resized to size()x1
+  void distances(const matrix::Matrix& x, matrix::Matrix& d) const;
+
+  /** ranks the prototypes by the given distances (size() elements):
+      the k closest ones are sorted to the front of ranking (partial sort).
+      Equal distances are ordered by index.
+   */
+  static void rank(const double* d, unsigned int count, unsigned int k, Ranking& ranking);
+
+  /** finds the k closest prototypes to x (sorted, equal distances by index).
+      Uses the k-d tree if it is switched on, otherwise all distances.
+   */
+  void kNearest(const double* x, unsigned int k, Ranking& result) const;
+
+  /// switches the k-d tree for kNearest() on or off
+  void setUseTree(bool useTree);
+  bool getUseTree() const {
+    return useTree;
+  }
+
+private:
+  struct TreeNode {
+    unsigned int begin; ///< first point of the node (in tree order)
+    unsigned int end;   ///< behind the last point
+    unsigned int splitDim;
+    double splitValue;
+    int left; ///< child indices, -1 for leafs
+    int right;
+  };
+
+  void buildTree() const;
+  int buildNode(unsigned int begin, unsigned int end) const;
+  void searchNode(int node, const double* x, unsigned int k, Ranking& heap) const;
+
+  matrix::Matrix protos; ///< dim x count, one prototype per column
+
+  bool useTree;
+  mutable bool treeValid;
+  mutable std::vector<TreeNode> tree;
+  mutable std::vector<unsigned int> treeIndex; ///< prototype index of the points in tree order
+  mutable std::vector<double> treePoints;      ///< points in tree order, row-wise
+  mutable std::vector<double> scratch;         ///< distances for the brute force search
+};
+
+#endif
@@ -23,6 +23,10 @@
  ***************************************************************************/
 #include "randomgenerator.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
 #ifndef _GNU_SOURCE
 #ifdef WIN32
 #include <inttypes.h>
@@ -104,3 +108,140 @@ drand48_r(struct drand48_data* buffer, double* result) {
 }
 
 #endif
+
+/*********************** CounterRandGen ***********************/
+
+namespace {
+  // Philox4x32 constants (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3")
+  const uint32_t PHILOX_M0 = 0xD2511F53;
+  const uint32_t PHILOX_M1 = 0xCD9E8D57;
+  const uint32_t PHILOX_W0 = 0x9E3779B9;
+  const uint32_t PHILOX_W1 = 0xBB67AE85;
+  /// number of blocks (of 2 doubles) computed side by side
+  const int BATCH = 8;
+  const int BATCHSIZE = 2 * BATCH;
+
+  /* the blocks of one batch are independent, the loops over b have a fixed
+     length so that they are vectorized (32x32->64 bit multiplies) */
+  inline __attribute__((always_inline)) void philoxBatch(const uint32_t key[2], uint64_t counter,
+                                                         uint64_t stream, double* out) {
+    uint32_t c0[BATCH], c1[BATCH], c2[BATCH], c3[BATCH];
+    for (int b = 0; b < BATCH; ++b) {
+      c0[b] = static_cast<uint32_t>(counter + b);
+      c1[b] = static_cast<uint32_t>((counter + b) >> 32);
+      c2[b] = static_cast<uint32_t>(stream);
+      c3[b] = static_cast<uint32_t>(stream >> 32);
+    }
+    uint32_t k0 = key[0];
+    uint32_t k1 = key[1];
+    for (int r = 0; r < 10; ++r) {
+      for (int b = 0; b < BATCH; ++b) {
+        const uint64_t p0 = static_cast<uint64_t>(PHILOX_M0) * c0[b];
+        const uint64_t p1 = static_cast<uint64_t>(PHILOX_M1) * c2[b];
+        const uint32_t n0 = static_cast<uint32_t>(p1 >> 32) ^ c1[b] ^ k0;
+        const uint32_t n2 = static_cast<uint32_t>(p0 >> 32) ^ c3[b] ^ k1;
+        c1[b] = static_cast<uint32_t>(p1);
+        c3[b] = static_cast<uint32_t>(p0);
+        c0[b] = n0;
+        c2[b] = n2;
+      }
+      k0 += PHILOX_W0;
+      k1 += PHILOX_W1;
+    }
+    // 53 bits of each 64 bit word give a double in [0,1)
+    for (int b = 0; b < BATCH; ++b) {
+      out[2 * b] = static_cast<double>(((static_cast<uint64_t>(c0[b]) << 32) | c1[b]) >> 11) * 0x1p-53;
+      out[2 * b + 1] = static_cast<double>(((static_cast<uint64_t>(c2[b]) << 32) | c3[b]) >> 11) * 0x1p-53;
+    }
+  }
+
+  void philoxBatches(const uint32_t key[2], uint64_t counter, uint64_t stream, double* out,
+                     size_t batches) {
+    for (size_t i = 0; i < batches; ++i)
+      philoxBatch(key, counter + i * BATCH, stream, out + i * BATCHSIZE);
+  }
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  __attribute__((target("avx2"))) void philoxBatches_avx2(const uint32_t key[2], uint64_t counter,
+                                                          uint64_t stream, double* out,
+                                                          size_t batches) {
+    for (size_t i = 0; i < batches; ++i)
+      philoxBatch(key, counter + i * BATCH, stream, out + i * BATCHSIZE);
+  }
+  const bool haveAVX2 = [] {
+    __builtin_cpu_init(); // we run in a static initializer
+    return __builtin_cpu_supports("avx2") != 0;
+  }();
+#endif
+
+  // the integer arithmetic gives identical numbers for both kernels
+  void fillBatches(const uint32_t key[2], uint64_t counter, uint64_t stream, double* out,
+                   size_t batches) {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    if (haveAVX2) {
+      philoxBatches_avx2(key, counter, stream, out, batches);
+      return;
+    }
+#endif
+    philoxBatches(key, counter, stream, out, batches);
+  }
+}
+
+void CounterRandGen::init(uint64_t seed, uint64_t stream) {
+  key[0] = static_cast<uint32_t>(seed);
+  key[1] = static_cast<uint32_t>(seed >> 32);
+  this->stream = stream;
+  counter = 0;
+  cached = 0;
+}
+
+void CounterRandGen::fill(double* out, size_t n) {
+  const size_t batches = n / BATCHSIZE;
+  fillBatches(key, counter, stream, out, batches);
+  counter += batches * BATCH;
+  const size_t rest = n - batches * BATCHSIZE;
+  if (rest > 0) {
+    double tmp[BATCHSIZE];
+    philoxBatch(key, counter, stream, tmp);
+    memcpy(out + batches * BATCHSIZE, tmp, rest * sizeof(double));
+    counter += (rest + 1) / 2;
+  }
+}
+
+void CounterRandGen::fillUniform(double* out, size_t n, double min, double max) {
+  fill(out, n);
+  const double range = max - min;
+  for (size_t i = 0; i < n; ++i)
+    out[i] = out[i] * range + min;
+}
+
+void CounterRandGen::fillNormal(double* out, size_t n) {
+  // the uniforms are drawn in chunks and transformed in a separate loop
+  // (vectorizable with a vector math library, e.g. with -ffast-math and glibc's libmvec)
+  const size_t CHUNK = 8 * BATCHSIZE;
+  double u[CHUNK];
+  size_t i = 0;
+  while (i < n) {
+    const size_t m = std::min(CHUNK, (n - i + 1) & ~size_t(1)); // even
+    fill(u, m);
+    const size_t pairs = m / 2;
+    double* o = out + i;
+    if (n - i >= m) {
+      for (size_t k = 0; k < pairs; ++k) {
+        const double r = sqrt(-2.0 * log(1.0 - u[2 * k])); // 1-u in (0,1]
+        const double phi = 2.0 * M_PI * u[2 * k + 1];
+        o[2 * k] = r * cos(phi);
+        o[2 * k + 1] = r * sin(phi);
+      }
+    } else { // odd number left: the last sine value is dropped
+      for (size_t k = 0; k < pairs; ++k) {
+        const double r = sqrt(-2.0 * log(1.0 - u[2 * k]));
+        const double phi = 2.0 * M_PI * u[2 * k + 1];
+        o[2 * k] = r * cos(phi);
+        if (2 * k + 1 < n - i)
+          o[2 * k + 1] = r * sin(phi);
+      }
+    }
+    i += m;
+  }
+}
@@ -24,6 +24,8 @@
 #ifndef __RANDOMGENERATOR_H
 #define __RANDOMGENERATOR_H
 
+#include <cstddef>
+#include <cstdint>
 #include <cstdlib>
 #ifndef _GNU_SOURCE
 #include "mac_drand48r.h"
@@ -43,6 +45,9 @@ struct _RandGen {
     drand48_r(&buffer, &r);
     return r;
   }
+  /** number of CounterRandGen streams keyed from this generator (see NoiseGenerator::init).
+      It does not influence the numbers of rand(). */
+  uint64_t streams = 0;
   // See drand48_data structure:
   //  struct drand48_data
   //  {
@@ -70,4 +75,53 @@ struct _RandGen {
 
 using RandGen = _RandGen;
 
+/** counter based random generator (Philox4x32-10, Salmon et al. 2011).
+    The i-th number of a stream is a function of the seed, the stream id and i only
+    (no sequential state), so streams are reproducible independent of the
+    order in which they are used by different threads and large blocks can be
+    generated in one go (fill(), fillNormal()).
+*/
+class CounterRandGen {
+public:
+  explicit CounterRandGen(uint64_t seed = 0, uint64_t stream = 0) {
+    init(seed, stream);
+  }
+  /// sets the key and the stream and resets the position to the start of the stream
+  void init(uint64_t seed, uint64_t stream = 0);
+
+  /// returns a value in [0,1)
+  double rand() {
+    if (cached == 0) {
+      fill(cache, 2);
+      cached = 2;
+    }
+    return cache[2 - cached--];
+  }
+
+  /// fills out with n uniform numbers in [0,1)
+  void fill(double* out, size_t n);
+  /// fills out with n uniform numbers in [min,max)
+  void fillUniform(double* out, size_t n, double min, double max);
+  /// fills out with n standard normal distributed numbers (Box-Muller)
+  void fillNormal(double* out, size_t n);
+
+  /** position in the stream in blocks of 2 numbers.
+      fill() always starts at a new block, rand() takes 2 numbers from one block */
+  uint64_t getCounter() const {
+    return counter;
+  }
+  /// jumps to the given block in the stream (discards cached numbers of rand())
+  void setCounter(uint64_t c) {
+    counter = c;
+    cached = 0;
+  }
+
+private:
+  uint32_t key[2];
+  uint64_t stream = 0;
+  uint64_t counter = 0;
+  double cache[2];
+  int cached = 0;
+};
+
 #endif
@@ -0,0 +1,189 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2011 LpzRobots development team                    *
+ *    Georg Martius  <georg dot martius at web dot de>                     *
+ *    Frank Guettler <guettler at informatik dot uni-leipzig dot de        *
+ *    Frank Hesse    <frank at nld dot ds dot mpg dot de>                  *
+ *    Ralf Der       <ralfder at mis dot mpg dot de>                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "workstealingpool.h"
+
+namespace {
+// set while a thread executes tasks of a pool (prevents nested parallel loops)
+thread_local bool insideTask = false;
+} // namespace
+
+WorkStealingPool::WorkStealingPool(unsigned int numThreads)
+  : numThreads(0) {
+  setNumThreads(numThreads);
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  stop();
+}
+
+void
+WorkStealingPool::setNumThreads(unsigned int n) {
+  std::lock_guard<std::mutex> loopLock(loopMutex);
+  if (n == 0)
+    n = std::max(1u, std::thread::hardware_concurrency());
+  if (n == numThreads)
+    return;
+  stop();
+  numThreads = n;
+  start();
+}
+
+bool
+WorkStealingPool::inParallelRegion() {
+  return insideTask;
+}
+
+void
+WorkStealingPool::start() {
+  queues.reset(new Queue[numThreads]);
+  stopping = false;
+  // thread 0 is the caller of parallelFor
+  for (unsigned int id = 1; id < numThreads; ++id)
+    workers.emplace_back(&WorkStealingPool::workerLoop, this, id);
+}
+
+void
+WorkStealingPool::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wakeup.notify_all();
+  for (std::thread& w : workers)
+    w.join();
+  workers.clear();
+}
+
+void
+WorkStealingPool::workerLoop(unsigned int id) {
+  unsigned long seen = 0;
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    wakeup.wait(lock, [&] { return stopping || generation != seen; });
+    if (stopping)
+      return;
+    seen = generation;
+    lock.unlock();
+    work(id);
+    lock.lock();
+  }
+}
+
+void
+WorkStealingPool::parallelFor(std::size_t begin, std::size_t end,
+                              const std::function<void(std::size_t)>& f, std::size_t grain) {
+  if (end <= begin)
+    return;
+  if (grain == 0)
+    grain = 1;
+  const std::size_t count = end - begin;
+  if (numThreads == 1 || count <= grain || insideTask) {
+    for (std::size_t i = begin; i < end; ++i)
+      f(i);
+    return;
+  }
+
+  std::lock_guard<std::mutex> loopLock(loopMutex);
+  fun = &f;
+  error = nullptr;
+  remaining = count;
+  // distribute the chunks in contiguous blocks over the queues
+  const std::size_t chunks = (count + grain - 1) / grain;
+  for (unsigned int id = 0; id < numThreads; ++id) {
+    Queue& q = queues[id];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    q.ranges.clear();
+    q.head = 0;
+    for (std::size_t c = chunks * id / numThreads; c < chunks * (id + 1) / numThreads; ++c) {
+      const std::size_t b = begin + c * grain;
+      q.ranges.push_back(Range{ b, std::min(b + grain, end) });
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    ++generation;
+  }
+  wakeup.notify_all();
+
+  work(0);
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&] { return remaining.load() == 0; });
+  }
+  fun = nullptr;
+  if (error)
+    std::rethrow_exception(error);
+}
+
+void
+WorkStealingPool::work(unsigned int id) {
+  Range r;
+  while (pop(id, r) || steal(id, r)) {
+    run(r);
+    const std::size_t n = r.end - r.begin;
+    if (remaining.fetch_sub(n) == n) {
+      std::lock_guard<std::mutex> lock(mutex);
+      done.notify_all();
+    }
+  }
+}
+
+bool
+WorkStealingPool::pop(unsigned int id, Range& r) {
+  Queue& q = queues[id];
+  std::lock_guard<std::mutex> lock(q.mutex);
+  if (q.head == q.ranges.size())
+    return false;
+  r = q.ranges[q.head++];
+  return true;
+}
+
+bool
+WorkStealingPool::steal(unsigned int id, Range& r) {
+  for (unsigned int k = 1; k < numThreads; ++k) {
+    Queue& q = queues[(id + k) % numThreads];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (q.head < q.ranges.size()) {
+      r = q.ranges.back();
+      q.ranges.pop_back();
+      return true;
+    }
+  }
+  return false;
+}
+
+void
+WorkStealingPool::run(const Range& r) {
+  insideTask = true;
+  try {
+    for (std::size_t i = r.begin; i < r.end; ++i)
+      (*fun)(i);
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(errorMutex);
+    if (!error)
+      error = std::current_exception();
+  }
+  insideTask = false;
+}
@@ -0,0 +1,113 @@
+/***************************************************************************
+ *   Copyright (C) 2005-2011 LpzRobots development team                    *
+ *    Georg Martius  <georg dot martius at web dot de>                     *
+ *    Frank Guettler <guettler at informatik dot uni-leipzig dot de        *
+ *    Frank Hesse    <frank at nld dot ds dot mpg dot de>                  *
+ *    Ralf Der       <ralfder at mis dot mpg dot de>                       *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef __WORKSTEALINGPOOL_H
+#define __WORKSTEALINGPOOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Persistent thread pool for data parallel loops.
+ *
+ * parallelFor() splits the index range into chunks which are distributed over
+ * per-thread queues. Every thread works on its own queue from the front and
+ * steals from the back of the other queues when it runs out of work, so
+ * unevenly expensive iterations (e.g. controllers of different size) are balanced.
+ * The calling thread takes part in the work, the worker threads sleep between loops.
+ *
+ * A parallelFor() called from within a running loop is executed serially
+ * by the calling thread.
+ */
+class WorkStealingPool {
+public:
+  /// @param numThreads number of threads including the caller (0: number of processors)
+  explicit WorkStealingPool(unsigned int numThreads = 1);
+  ~WorkStealingPool();
+
+  WorkStealingPool(const WorkStealingPool&) = delete;
+  WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+  /// restarts the pool with the given number of threads (0: number of processors)
+  void setNumThreads(unsigned int numThreads);
+  /// number of threads including the calling thread
+  unsigned int getNumThreads() const {
+    return numThreads;
+  }
+
+  /** calls fun(i) for all i in [begin, end) in parallel and returns when all are done.
+      @param grain number of consecutive indices that form one task
+      An exception thrown by fun is rethrown in the calling thread.
+   */
+  void parallelFor(std::size_t begin, std::size_t end,
+                   const std::function<void(std::size_t)>& fun, std::size_t grain = 1);
+
+  /// @return true if the calling thread executes a task of a pool
+  static bool inParallelRegion();
+
+private:
+  struct Range {
+    std::size_t begin;
+    std::size_t end;
+  };
+  struct alignas(64) Queue {
+    std::mutex mutex;
+    std::vector<Range> ranges; // owner takes from head, thieves from the back
+    std::size_t head = 0;
+  };
+
+  void start();
+  void stop();
+  void workerLoop(unsigned int id);
+  void work(unsigned int id);
+  bool pop(unsigned int id, Range& r);
+  bool steal(unsigned int id, Range& r);
+  void run(const Range& r);
+
+  unsigned int numThreads;
+  std::vector<std::thread> workers;
+  std::unique_ptr<Queue[]> queues;
+
+  std::mutex loopMutex; // serializes parallelFor calls of different threads
+
+  std::mutex mutex; // guards generation, stopping and the done notification
+  std::condition_variable wakeup;
+  std::condition_variable done;
+  unsigned long generation = 0;
+  bool stopping = false;
+
+  const std::function<void(std::size_t)>* fun = nullptr;
+  std::atomic<std::size_t> remaining{ 0 };
+  std::mutex errorMutex;
+  std::exception_ptr error;
+};
+
+#endif
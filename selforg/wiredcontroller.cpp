@@ -38,6 +38,8 @@
 
 #include "callbackable.h"
 
+#include "matrixpool.h"
+
 using namespace std;
 
 WiredController::WiredController(const PlotOption& plotOption, double noisefactor, const iparamkey& name, const iparamkey& revision)
@@ -110,6 +112,13 @@ bool WiredController::init(AbstractController* controller, AbstractWiring* wirin
   wiring->addSensorMotorInfosToInspectable(robotSensorInfos, robotMotorInfos,
                                            controllerSensorInfos, controllerMotorInfos);
 
+  if(matrix::MatrixPool::isEnabled()){
+    addInspectableValue("matrixRequests", &matrixRequests,
+                        "number of matrix buffer requests in the last step");
+    addInspectableValue("matrixMallocs", &matrixMallocs,
+                        "number of matrix buffers that were not served by the pool");
+  }
+
   plotEngine.addInspectable(this, true);
   plotEngine.addConfigurable(this);
   addInspectable(wiring);
@@ -170,6 +179,13 @@ void WiredController::plot(double time){
 void WiredController::step(const sensor* sensors, int sensornumber,
                            motor* motors, int motornumber,
                            double noise, double time){
+  computeStep(sensors, sensornumber, motors, motornumber, noise);
+  publishStep(time);
+}
+
+void WiredController::computeStep(const sensor* sensors, int sensornumber,
+                                  motor* motors, int motornumber,
+                                  double noise){
   assert(controller && wiring && sensors && csensors && cmotors && motors);
 
   if(sensornumber != rsensornumber){
@@ -177,16 +193,25 @@ void WiredController::step(const sensor* sensors, int sensornumber,
             rsensornumber, sensornumber);
   }
 
-  wiring->wireSensors(sensors, rsensornumber, csensors, csensornumber, noise * noisefactor);
-  if(motorBabblingSteps>0){
-    motorBabbler->step(csensors, csensornumber, cmotors, cmotornumber);
-    controller->motorBabblingStep(csensors, csensornumber, cmotors, cmotornumber);
-    --motorBabblingSteps;
-    if(motorBabblingSteps == 0) stopMotorBabblingMode();
-  }else{
-    controller->step(csensors, csensornumber, cmotors, cmotornumber);
+  { // temporary matrices of this step go back to the pool (if enabled)
+    matrix::MatrixPool::StepScope stepScope;
+    wiring->wireSensors(sensors, rsensornumber, csensors, csensornumber, noise * noisefactor);
+    if(motorBabblingSteps>0){
+      motorBabbler->step(csensors, csensornumber, cmotors, cmotornumber);
+      controller->motorBabblingStep(csensors, csensornumber, cmotors, cmotornumber);
+      --motorBabblingSteps;
+      if(motorBabblingSteps == 0) stopMotorBabblingMode();
+    }else{
+      controller->step(csensors, csensornumber, cmotors, cmotornumber);
+    }
+    wiring->wireMotors(motors, rmotornumber, cmotors, cmotornumber);
   }
-  wiring->wireMotors(motors, rmotornumber, cmotors, cmotornumber);
+  const matrix::MatrixPool::Stats stepStats = matrix::MatrixPool::lastStep();
+  matrixRequests = static_cast<double>(stepStats.requests);
+  matrixMallocs  = static_cast<double>(stepStats.mallocs);
+}
+
+void WiredController::publishStep(double time){
   plot(time);
   // do a callback for all registered Callbackable classes
   callBack();
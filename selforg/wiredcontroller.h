@@ -89,6 +89,19 @@ public:
                     motor* motors, int motornumber,
                     double noise, double time=-1);
 
+  /** First part of step(): wiring and controller step without plotting and callbacks.
+      Different instances can do this in parallel. publishStep() has to be called afterwards.
+      Parameters like step() (the time is only needed for publishStep()).
+   */
+  virtual void computeStep(const sensor* sensors, int sensornumber,
+                           motor* motors, int motornumber,
+                           double noise);
+
+  /** Second part of step(): plotting and callbacks (not thread safe,
+      call it for all instances in a fixed order)
+   */
+  virtual void publishStep(double time=-1);
+
   /** Enables the motor babbling mode for given number of steps (typically 1000).
       Optionally a controller can be
       given that is used for the babbling (default is MotorBabbler) (deleted automatically).
@@ -171,6 +184,10 @@ protected:
 
   std::list<Callbackable* > callbackables;
 
+  /// matrix buffer requests and mallocs in the last step (see matrix::MatrixPool)
+  double matrixRequests = 0;
+  double matrixMallocs = 0;
+
   long int t;
 };
 